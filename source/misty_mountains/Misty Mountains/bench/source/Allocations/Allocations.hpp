@@ -0,0 +1,227 @@
+#ifndef ALLOCATIONS_HPP
+#define ALLOCATIONS_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// gcc inlines the replaced deletes, sees free() on what operator new returned and warns that
+// they don't match. Out of line it only sees the operator delete that belongs to the new
+#ifdef __GNUC__
+#define ALLOCATIONS_OUT_OF_LINE __attribute__((noinline))
+#else
+#define ALLOCATIONS_OUT_OF_LINE
+#endif
+
+/// <summary>
+/// Counts the heap allocations the calling thread makes between Start() and Stop(), through
+/// the replaced global operator new below. Other threads (the stand-in proxies, the resolver)
+/// aren't counted. The replacements may only be defined once, include this from the main file
+/// </summary>
+class Allocations
+{
+public:
+	static auto Start(void) -> void
+	{
+		count_ = 0;
+		bytes_ = 0;
+		counting_ = true;
+	}
+
+	static auto Stop(void) -> void
+	{
+		counting_ = false;
+	}
+
+	static auto Count(void) -> std::uint64_t
+	{
+		return count_;
+	}
+
+	static auto Bytes(void) -> std::uint64_t
+	{
+		return bytes_;
+	}
+
+	static auto Record(const std::size_t size) -> void
+	{
+		if (!counting_)
+			return;
+
+		++count_;
+		bytes_ += size;
+	}
+
+	/// <summary>
+	/// Memory for the replaced operator new, counted, nullptr if there is none
+	/// </summary>
+	static auto Allocate(const std::size_t size) -> void*
+	{
+		Record(size);
+		return std::malloc(size ? size : 1);
+	}
+
+	/// <summary>
+	/// Memory for the over-aligned forms of operator new, which FreeAligned() has to give back
+	/// </summary>
+	static auto Allocate(const std::size_t size, const std::align_val_t alignment) -> void*
+	{
+		Record(size);
+		const auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+		return _aligned_malloc(size ? size : 1, align);
+#else
+		// aligned_alloc wants a whole number of alignments
+		const auto rounded = (size ? size + align - 1 : align) / align * align;
+		return std::aligned_alloc(align, rounded);
+#endif
+	}
+
+	/// <summary>
+	/// Gives back what Allocate(size) returned
+	/// </summary>
+	ALLOCATIONS_OUT_OF_LINE static auto Free(void* memory) -> void
+	{
+		std::free(memory);
+	}
+
+	/// <summary>
+	/// Gives back what Allocate(size, alignment) returned
+	/// </summary>
+	ALLOCATIONS_OUT_OF_LINE static auto FreeAligned(void* memory) -> void
+	{
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+
+private:
+	static inline thread_local bool counting_ = false;
+	static inline thread_local std::uint64_t count_ = 0;
+	static inline thread_local std::uint64_t bytes_ = 0;
+};
+
+// every form of new is replaced along with the delete that matches it, so each allocation is
+// counted and freed the way it was made
+auto operator new(const std::size_t size) -> void*
+{
+	if (auto* memory = Allocations::Allocate(size))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+auto operator new[](const std::size_t size) -> void*
+{
+	if (auto* memory = Allocations::Allocate(size))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+auto operator new(const std::size_t size, const std::nothrow_t&) noexcept -> void*
+{
+	return Allocations::Allocate(size);
+}
+
+auto operator new[](const std::size_t size, const std::nothrow_t&) noexcept -> void*
+{
+	return Allocations::Allocate(size);
+}
+
+auto operator new(const std::size_t size, const std::align_val_t alignment) -> void*
+{
+	if (auto* memory = Allocations::Allocate(size, alignment))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+auto operator new[](const std::size_t size, const std::align_val_t alignment) -> void*
+{
+	if (auto* memory = Allocations::Allocate(size, alignment))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+auto operator new(const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept -> void*
+{
+	return Allocations::Allocate(size, alignment);
+}
+
+auto operator new[](const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept -> void*
+{
+	return Allocations::Allocate(size, alignment);
+}
+
+auto operator delete(void* memory) noexcept -> void
+{
+	Allocations::Free(memory);
+}
+
+auto operator delete[](void* memory) noexcept -> void
+{
+	Allocations::Free(memory);
+}
+
+auto operator delete(void* memory, std::size_t) noexcept -> void
+{
+	Allocations::Free(memory);
+}
+
+auto operator delete[](void* memory, std::size_t) noexcept -> void
+{
+	Allocations::Free(memory);
+}
+
+auto operator delete(void* memory, const std::nothrow_t&) noexcept -> void
+{
+	Allocations::Free(memory);
+}
+
+auto operator delete[](void* memory, const std::nothrow_t&) noexcept -> void
+{
+	Allocations::Free(memory);
+}
+
+auto operator delete(void* memory, std::align_val_t) noexcept -> void
+{
+	Allocations::FreeAligned(memory);
+}
+
+auto operator delete[](void* memory, std::align_val_t) noexcept -> void
+{
+	Allocations::FreeAligned(memory);
+}
+
+auto operator delete(void* memory, std::size_t, std::align_val_t) noexcept -> void
+{
+	Allocations::FreeAligned(memory);
+}
+
+auto operator delete[](void* memory, std::size_t, std::align_val_t) noexcept -> void
+{
+	Allocations::FreeAligned(memory);
+}
+
+auto operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept -> void
+{
+	Allocations::FreeAligned(memory);
+}
+
+auto operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept -> void
+{
+	Allocations::FreeAligned(memory);
+}
+
+#endif // !ALLOCATIONS_HPP
@@ -0,0 +1,102 @@
+#ifndef ARGS_HPP
+#define ARGS_HPP
+
+#pragma once
+
+#include <args.hpp>
+#include <iostream>
+
+class Args
+{
+public:
+	/// <summary>
+	/// Parsing Arguments from cmdline
+	/// </summary>
+	auto Initialize(const int argc, char* argv[]) -> void
+	{
+		args::ArgumentParser m_parser("## Misty Mountains ##", "Proxy handshake benchmarks against in-process stand-in proxies.");
+
+		args::HelpFlag m_help(m_parser, "help", "Display this help menu", { "help" });
+
+		args::Group m_g_arguments(m_parser, "Arguments", args::Group::Validators::DontCare, args::Options::Global);
+
+		args::ValueFlag<std::string> m_sz_iterations(m_g_arguments, "count", "Measured handshakes per round. By default 2000.", { 'n', "iterations" });
+		args::ValueFlag<std::string> m_sz_warmup(m_g_arguments, "count", "Handshakes before the first round that aren't measured. By default 200.", { 'w', "warmup" });
+		args::ValueFlag<std::string> m_sz_rounds(m_g_arguments, "count", "Rounds per benchmark, the median round's rate is reported. By default 5.", { 'r', "rounds" });
+		args::ValueFlag<std::string> m_sz_filter(m_g_arguments, "text", "Only benchmarks whose name contains it, like socks5 or loopback. By default all.", { 'f', "filter" });
+		args::ValueFlag<std::string> m_sz_output(m_g_arguments, "format", "Output format: text or csv. By default text.", { 'o', "output" });
+		args::ValueFlag<std::string> m_sz_baseline(m_g_arguments, "path", "CSV of an earlier run: fails if a benchmark allocates more or got slower than the tolerance. By default none.", { 'b', "baseline" });
+		args::ValueFlag<std::string> m_sz_tolerance(m_g_arguments, "percent", "How much slower than the baseline a benchmark may get. By default 10.", { 't', "tolerance" });
+		///
+
+		try
+		{
+			m_parser.ParseCLI(argc, argv);
+
+			this->m_sz_iterations_ = m_sz_iterations.Get();
+			this->m_sz_warmup_ = m_sz_warmup.Get();
+			this->m_sz_rounds_ = m_sz_rounds.Get();
+			this->m_sz_filter_ = m_sz_filter.Get();
+			this->m_sz_output_ = m_sz_output.Get();
+			this->m_sz_baseline_ = m_sz_baseline.Get();
+			this->m_sz_tolerance_ = m_sz_tolerance.Get();
+		}
+		catch (const args::Help&)
+		{
+			std::cout << m_parser;
+			std::exit(EXIT_SUCCESS);
+		}
+		catch (const args::ParseError& e)
+		{
+			std::cerr << e.what() << '\n';
+			std::cerr << m_parser;
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	auto Iterations(void) -> std::string&
+	{
+		return m_sz_iterations_;
+	}
+
+	auto Warmup(void) -> std::string&
+	{
+		return m_sz_warmup_;
+	}
+
+	auto Rounds(void) -> std::string&
+	{
+		return m_sz_rounds_;
+	}
+
+	auto Filter(void) -> std::string&
+	{
+		return m_sz_filter_;
+	}
+
+	auto Output(void) -> std::string&
+	{
+		return m_sz_output_;
+	}
+
+	auto Baseline(void) -> std::string&
+	{
+		return m_sz_baseline_;
+	}
+
+	auto Tolerance(void) -> std::string&
+	{
+		return m_sz_tolerance_;
+	}
+
+private:
+	std::string m_sz_iterations_;
+	std::string m_sz_warmup_;
+	std::string m_sz_rounds_;
+	std::string m_sz_filter_;
+	std::string m_sz_output_;
+	std::string m_sz_baseline_;
+	std::string m_sz_tolerance_;
+};
+
+#endif // !ARGS_HPP
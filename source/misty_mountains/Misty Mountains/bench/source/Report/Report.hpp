@@ -0,0 +1,141 @@
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../Suite/Suite.hpp"
+
+/// <summary>
+/// Prints results as a table or as CSV, and holds them against the CSV of an earlier run.
+/// Allocations per handshake are exact and may not grow at all, the rate is noisy and may
+/// drop by tolerance percent
+/// </summary>
+class Report
+{
+public:
+	static auto Header(std::ostream& out, const bool csv) -> void
+	{
+		if (csv) {
+			out << "benchmark,handshakes,handshakes_per_s,p50_us,p90_us,p99_us,max_us,allocations,bytes" << '\n';
+			return;
+		}
+
+		out << Row("benchmark", "handshakes/s", "p50 us", "p90 us", "p99 us", "max us", "allocs", "bytes") << '\n';
+	}
+
+	static auto Print(std::ostream& out, const Result& result, const bool csv) -> void
+	{
+		if (csv) {
+			out << result.name << ',' << result.handshakes << ',' << Fixed(result.rate, 0) << ',' << Micros(result.p50) << ',' << Micros(result.p90)
+				<< ',' << Micros(result.p99) << ',' << Micros(result.max) << ',' << Fixed(result.allocations, 2) << ',' << Fixed(result.bytes, 0) << '\n';
+			return;
+		}
+
+		out << Row(result.name, Fixed(result.rate, 0), Micros(result.p50), Micros(result.p90), Micros(result.p99), Micros(result.max),
+			Fixed(result.allocations, 2), Fixed(result.bytes, 0)) << '\n';
+	}
+
+	/// <summary>
+	/// Reads the results of an earlier run written with --output csv, false if there are none
+	/// </summary>
+	static auto Load(const std::string& path, std::vector<Result>& results) -> bool
+	{
+		std::ifstream file(path);
+		if (!file) {
+			std::cerr << "Can't open baseline " << path << '\n';
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.empty() || line.compare(0, 10, "benchmark,") == 0)
+				continue;
+
+			std::vector<std::string> fields;
+			std::istringstream stream(line);
+			for (std::string field; std::getline(stream, field, ',');)
+				fields.push_back(field);
+
+			if (fields.size() != 9) {
+				std::cerr << "Baseline " << path << " has a line that isn't a result: " << line << '\n';
+				return false;
+			}
+
+			try
+			{
+				Result result;
+				result.name = fields[0];
+				result.handshakes = std::stoull(fields[1]);
+				result.rate = std::stod(fields[2]);
+				result.allocations = std::stod(fields[7]);
+				result.bytes = std::stod(fields[8]);
+				results.push_back(result);
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << '\n';
+				std::cerr << "Baseline " << path << " has a line that isn't a result: " << line << '\n';
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Whether result is no worse than the same benchmark in baseline, the regressions go to stderr.
+	/// Benchmarks the baseline doesn't have pass
+	/// </summary>
+	static auto Compare(const Result& result, const std::vector<Result>& baseline, const double tolerance) -> bool
+	{
+		for (const auto& before : baseline) {
+			if (before.name != result.name)
+				continue;
+
+			auto fine = true;
+			// counts are printed rounded to hundredths
+			if (result.allocations > before.allocations + 0.005) {
+				std::cerr << result.name << ": " << Fixed(result.allocations, 2) << " allocations per handshake, " << Fixed(before.allocations, 2) << " before" << '\n';
+				fine = false;
+			}
+			if (result.rate < before.rate * (1.0 - tolerance / 100.0)) {
+				std::cerr << result.name << ": " << Fixed(result.rate, 0) << " handshakes/s, " << Fixed(before.rate, 0) << " before" << '\n';
+				fine = false;
+			}
+			return fine;
+		}
+
+		return true;
+	}
+
+private:
+	static auto Fixed(const double value, const int decimals) -> std::string
+	{
+		char text[64];
+		std::snprintf(text, sizeof text, "%.*f", decimals, value);
+		return text;
+	}
+
+	static auto Micros(const std::chrono::nanoseconds elapsed) -> std::string
+	{
+		return Fixed(static_cast<double>(elapsed.count()) / 1000.0, 1);
+	}
+
+	static auto Row(const std::string& name, const std::string& rate, const std::string& p50, const std::string& p90,
+		const std::string& p99, const std::string& max, const std::string& allocations, const std::string& bytes) -> std::string
+	{
+		char text[256];
+		std::snprintf(text, sizeof text, "%-26s %12s %8s %8s %8s %9s %7s %7s", name.c_str(), rate.c_str(), p50.c_str(), p90.c_str(),
+			p99.c_str(), max.c_str(), allocations.c_str(), bytes.c_str());
+		return text;
+	}
+};
+
+#endif // !REPORT_HPP
@@ -0,0 +1,233 @@
+#ifndef STAND_IN_HPP
+#define STAND_IN_HPP
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include <kissnet.hpp>
+
+#include "../../../library/source/Handshake/Handshake.hpp"
+#include "../../../server/source/Socks/Socks.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/// <summary>
+/// What one benchmark asks of the proxy: the protocol, how, and the tunnel's destination
+/// </summary>
+struct Case
+{
+	std::string name;
+	Protocol protocol;
+	bool pipelined;
+	std::string host;
+	std::uint16_t port;
+	std::string username;
+	std::string password;
+};
+
+/// <summary>
+/// A proxy that grants every tunnel without dialing anything, so a benchmark only measures the
+/// client's side of the handshake. Its replies are fixed per case: on a socketpair they are
+/// queued before the client starts and what the client sent is checked afterwards. On loopback
+/// it listens on 127.0.0.1 and answers connection after connection from a thread of its own,
+/// SOCKS through the server's parser. It hangs up once it granted the tunnel, so the TIME_WAIT
+/// of the many short connections stays on its side and not on the client's ephemeral ports
+/// </summary>
+class StandIn
+{
+public:
+	explicit StandIn(const Case& test) :
+		case_(test)
+	{
+	}
+
+	~StandIn(void)
+	{
+		this->Stop();
+	}
+
+	StandIn(const StandIn&) = delete;
+	StandIn& operator=(const StandIn&) = delete;
+
+	/// <summary>
+	/// Everything the proxy answers to the case's handshake when it grants the tunnel, in order.
+	/// The SOCKS bound address is 0.0.0.0:0
+	/// </summary>
+	static auto Replies(const Case& test) -> std::string
+	{
+		using namespace std::string_literals;
+
+		switch (test.protocol) {
+		case Protocol::kHttp:
+			return "HTTP/1.1 200 Connection established\r\n\r\n";
+		case Protocol::kSocks4:
+			return "\x00\x5a\x00\x00\x00\x00\x00\x00"s;
+		case Protocol::kSocks5:
+		default:
+			return (test.username.empty() ? "\x05\x00"s : "\x05\x02\x01\x00"s) + "\x05\x00\x00\x01\x00\x00\x00\x00\x00\x00"s;
+		}
+	}
+
+	/// <summary>
+	/// Whether requests is the whole handshake the case's client had to send, nothing more
+	/// </summary>
+	static auto Check(const Case& test, std::string requests) -> bool
+	{
+		if (test.protocol == Protocol::kHttp) {
+			const auto line = "CONNECT " + test.host + ':' + std::to_string(test.port) + " HTTP/1.1\r\n";
+			const auto authorized = requests.find("\r\nProxy-Authorization: Basic ") != std::string::npos;
+			return requests.compare(0, line.size(), line) == 0 && authorized == !test.username.empty() &&
+				requests.find("\r\n\r\n") + 4 == requests.size();
+		}
+
+		std::string replies;
+		Socks socks(test.username, test.password);
+		if (socks.Parse(requests, replies) != SocksStep::kConnect || !requests.empty())
+			return false;
+
+		replies += socks.Granted(Unbound());
+		return socks.Host() == test.host && socks.Port() == test.port && replies == Replies(test);
+	}
+
+	/// <summary>
+	/// Listens on a free loopback port, 0 if it can't
+	/// </summary>
+	auto Listen(void) -> std::uint16_t
+	{
+		try
+		{
+			listener_ = kissnet::tcp_socket(kissnet::endpoint("127.0.0.1", 0));
+			listener_.bind();
+			listener_.listen();
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return 0;
+		}
+
+		sockaddr_in bound{};
+		socklen_t length = sizeof bound;
+		if (::getsockname(listener_.get_handle(), reinterpret_cast<sockaddr*>(&bound), &length) != 0)
+			return 0;
+
+		port_ = ntohs(bound.sin_port);
+		return port_;
+	}
+
+	/// <summary>
+	/// Answers connections handshakes on a thread of its own
+	/// </summary>
+	auto Serve(const std::uint64_t connections) -> void
+	{
+		thread_ = std::thread([this, connections] {
+			for (std::uint64_t i = 0; i < connections && !stopping_; ++i) {
+				try
+				{
+					auto client = listener_.accept();
+					if (!stopping_ && !this->Answer(client.get_handle()))
+						++failures_;
+				}
+				catch (const std::exception&) {
+					++failures_;
+				}
+			}
+			});
+	}
+
+	/// <summary>
+	/// Handshakes the stand-in couldn't answer as the case expects
+	/// </summary>
+	auto Failures(void) const -> std::uint64_t
+	{
+		return failures_;
+	}
+
+	/// <summary>
+	/// Waits for the serving thread, waking it if it still waits for connections
+	/// </summary>
+	auto Stop(void) -> void
+	{
+		if (!thread_.joinable())
+			return;
+
+		stopping_ = true;
+		try
+		{
+			kissnet::tcp_socket wake(kissnet::endpoint("127.0.0.1", port_));
+			wake.connect();
+		}
+		catch (const std::exception&) {
+			// the thread was done already
+		}
+		thread_.join();
+	}
+
+private:
+	static auto Unbound(void) -> sockaddr_storage
+	{
+		sockaddr_storage bound{};
+		reinterpret_cast<sockaddr_in*>(&bound)->sin_family = AF_INET;
+		return bound;
+	}
+
+	static auto Send(SOCKET fd, const std::string& data) -> bool
+	{
+		std::size_t sent = 0;
+		while (sent < data.size()) {
+			const auto n = ::send(fd, data.data() + sent, static_cast<buffsize_t>(data.size() - sent), MSG_NOSIGNAL);
+			if (n <= 0)
+				return false;
+			sent += static_cast<std::size_t>(n);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// One client's handshake, from its first byte to the granted tunnel
+	/// </summary>
+	auto Answer(SOCKET fd) -> bool
+	{
+		std::string inbox;
+		std::string out;
+		char buffer[4096];
+		Socks socks(case_.username, case_.password);
+
+		for (;;) {
+			const auto received = ::recv(fd, buffer, sizeof buffer, 0);
+			if (received <= 0)
+				return false;
+			inbox.append(buffer, static_cast<std::size_t>(received));
+
+			if (case_.protocol == Protocol::kHttp) {
+				if (inbox.find("\r\n\r\n") == std::string::npos)
+					continue;
+				return Check(case_, std::move(inbox)) && Send(fd, Replies(case_));
+			}
+
+			const auto step = socks.Parse(inbox, out);
+			if (step == SocksStep::kFailed)
+				return false;
+			if (step == SocksStep::kConnect)
+				return Send(fd, out + socks.Granted(Unbound()));
+
+			if (!Send(fd, out))
+				return false;
+			out.clear();
+		}
+	}
+
+	const Case& case_;
+	kissnet::tcp_socket listener_;
+	std::uint16_t port_ = 0;
+	std::thread thread_;
+	std::atomic<bool> stopping_{ false };
+	std::atomic<std::uint64_t> failures_{ 0 };
+};
+
+#endif // !STAND_IN_HPP
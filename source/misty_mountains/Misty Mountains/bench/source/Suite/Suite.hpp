@@ -0,0 +1,262 @@
+#ifndef SUITE_HPP
+#define SUITE_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Allocations/Allocations.hpp"
+#include "../StandIn/StandIn.hpp"
+#include "../../../library/source/Proxy/Proxy.hpp"
+
+/// <summary>
+/// How a benchmark reaches its stand-in: a socketpair with the replies queued up front, which
+/// leaves only the handshake itself, or a TCP connection over loopback to a stand-in on a
+/// thread, which adds Initialize() (resolving, the socket, connect) and the round trips
+/// </summary>
+enum class Transport
+{
+	kSocketpair,
+	kLoopback
+};
+
+/// <summary>
+/// What a benchmark measured. The rate is the median round's, the latencies are percentiles of
+/// every measured handshake, allocations are counted on the client's thread only
+/// </summary>
+struct Result
+{
+	std::string name;
+	std::uint64_t handshakes = 0;
+	double rate = 0.0;
+	std::chrono::nanoseconds p50{};
+	std::chrono::nanoseconds p90{};
+	std::chrono::nanoseconds p99{};
+	std::chrono::nanoseconds max{};
+	double allocations = 0.0;
+	double bytes = 0.0;
+};
+
+/// <summary>
+/// How much of each benchmark runs. Everything else is fixed: the cases, the destinations and
+/// the stand-ins' replies, so two runs on the same machine only differ by its noise
+/// </summary>
+struct Plan
+{
+	std::uint64_t iterations = 2000;
+	std::uint64_t warmup = 200;
+	std::uint64_t rounds = 5;
+};
+
+/// <summary>
+/// Runs Proxy::Connect for every Protocol against stand-in proxies, handshake after
+/// handshake on one thread, and times each from the moment the Proxy is set up until the
+/// tunnel is granted
+/// </summary>
+class Suite
+{
+public:
+	explicit Suite(const Plan& plan) :
+		plan_(plan)
+	{
+	}
+
+	/// <summary>
+	/// The handshakes there are, with and without credentials, to an address and to a name
+	/// </summary>
+	static auto Cases(void) -> std::vector<Case>
+	{
+		return {
+			{ "http", Protocol::kHttp, false, "10.0.0.1", 1337, "", "" },
+			{ "http-auth", Protocol::kHttp, false, "10.0.0.1", 1337, "bench", "secret" },
+			{ "socks4", Protocol::kSocks4, false, "10.0.0.1", 1337, "", "" },
+			{ "socks4a", Protocol::kSocks4, false, "echo.example", 1337, "", "" },
+			{ "socks5", Protocol::kSocks5, true, "10.0.0.1", 1337, "", "" },
+			{ "socks5-strict", Protocol::kSocks5, false, "10.0.0.1", 1337, "", "" },
+			{ "socks5-name", Protocol::kSocks5, true, "echo.example", 1337, "", "" },
+			{ "socks5-auth", Protocol::kSocks5, false, "10.0.0.1", 1337, "bench", "secret" }
+		};
+	}
+
+	static auto Name(const Case& test, const Transport transport) -> std::string
+	{
+		return test.name + (transport == Transport::kSocketpair ? "/socketpair" : "/loopback");
+	}
+
+	/// <summary>
+	/// Runs one benchmark, false (with the reason on stderr) if a handshake didn't go through
+	/// </summary>
+	auto Run(const Case& test, const Transport transport, Result& result) -> bool
+	{
+		result = {};
+		result.name = Name(test, transport);
+
+		StandIn stand_in(test);
+		if (transport == Transport::kLoopback) {
+			port_ = stand_in.Listen();
+			if (!port_) {
+				std::cerr << result.name << ": can't listen on loopback" << '\n';
+				return false;
+			}
+			stand_in.Serve(plan_.warmup + plan_.iterations * plan_.rounds);
+		}
+
+		const auto replies = StandIn::Replies(test);
+		std::vector<std::chrono::nanoseconds> samples;
+		samples.reserve(static_cast<std::size_t>(plan_.iterations * plan_.rounds));
+		std::vector<double> rates;
+		std::uint64_t allocations = 0;
+		std::uint64_t bytes = 0;
+
+		for (std::uint64_t i = 0; i < plan_.warmup; ++i) {
+			Sample sample;
+			if (!this->Once(test, transport, replies, sample))
+				return this->Failed(result, stand_in);
+		}
+
+		for (std::uint64_t round = 0; round < plan_.rounds; ++round) {
+			std::chrono::nanoseconds elapsed{};
+			for (std::uint64_t i = 0; i < plan_.iterations; ++i) {
+				Sample sample;
+				if (!this->Once(test, transport, replies, sample))
+					return this->Failed(result, stand_in);
+
+				samples.push_back(sample.elapsed);
+				elapsed += sample.elapsed;
+				allocations += sample.allocations;
+				bytes += sample.bytes;
+			}
+			rates.push_back(elapsed.count() ? static_cast<double>(plan_.iterations) * 1e9 / static_cast<double>(elapsed.count()) : 0.0);
+		}
+
+		stand_in.Stop();
+		if (stand_in.Failures()) {
+			std::cerr << result.name << ": the stand-in proxy got " << stand_in.Failures() << " handshakes it didn't expect" << '\n';
+			return false;
+		}
+
+		result.handshakes = samples.size();
+		if (samples.empty())
+			return true;
+
+		std::sort(rates.begin(), rates.end());
+		std::sort(samples.begin(), samples.end());
+		const auto percentile = [&samples](const double p) {
+			return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * static_cast<double>(samples.size())))];
+		};
+
+		result.rate = rates[rates.size() / 2];
+		result.p50 = percentile(0.50);
+		result.p90 = percentile(0.90);
+		result.p99 = percentile(0.99);
+		result.max = samples.back();
+		result.allocations = static_cast<double>(allocations) / static_cast<double>(samples.size());
+		result.bytes = static_cast<double>(bytes) / static_cast<double>(samples.size());
+		return true;
+	}
+
+private:
+	struct Sample
+	{
+		std::chrono::nanoseconds elapsed{};
+		std::uint64_t allocations = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	auto Failed(const Result& result, StandIn& stand_in) const -> bool
+	{
+		std::cerr << result.name << ": the handshake didn't go through" << '\n';
+		stand_in.Stop();
+		return false;
+	}
+
+	auto Once(const Case& test, const Transport transport, const std::string& replies, Sample& sample) -> bool
+	{
+		return transport == Transport::kSocketpair ? this->Paired(test, replies, sample) : this->Dialed(test, sample);
+	}
+
+	/// <summary>
+	/// One handshake on a socketpair: the stand-in's replies are in the socket before the client
+	/// sends anything, afterwards its requests are read from the other end and checked
+	/// </summary>
+	auto Paired([[maybe_unused]] const Case& test, [[maybe_unused]] const std::string& replies, [[maybe_unused]] Sample& sample) -> bool
+	{
+#ifdef _WIN32
+		std::cerr << "There are no socketpairs here, run the loopback benchmarks" << '\n';
+		return false;
+#else
+		int pair[2];
+		if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+			std::cerr << "Can't create a socketpair, error " << LastError() << '\n';
+			return false;
+		}
+		if (::send(pair[1], replies.data(), replies.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(replies.size())) {
+			::close(pair[0]);
+			::close(pair[1]);
+			return false;
+		}
+
+		kissnet::tcp_socket socket(pair[0], kissnet::endpoint{});
+		auto connected = false;
+		{
+			Allocations::Start();
+			const auto start = std::chrono::steady_clock::now();
+
+			Proxy proxy;
+			proxy.Pipelined(test.pipelined);
+			proxy.Attach(std::move(socket), "127.0.0.1", 1080, test.host, test.port, test.username, test.password);
+			connected = proxy.Connect(test.protocol);
+
+			sample.elapsed = std::chrono::steady_clock::now() - start;
+			Allocations::Stop();
+			sample.allocations = Allocations::Count();
+			sample.bytes = Allocations::Bytes();
+		}
+
+		// the client closed its end, everything it sent can be read now
+		std::string requests;
+		char buffer[4096];
+		for (;;) {
+			const auto received = ::recv(pair[1], buffer, sizeof buffer, 0);
+			if (received <= 0)
+				break;
+			requests.append(buffer, static_cast<std::size_t>(received));
+		}
+		::close(pair[1]);
+
+		return connected && StandIn::Check(test, std::move(requests));
+#endif
+	}
+
+	/// <summary>
+	/// One handshake with the stand-in listening on loopback, Initialize() included
+	/// </summary>
+	auto Dialed(const Case& test, Sample& sample) -> bool
+	{
+		Allocations::Start();
+		const auto start = std::chrono::steady_clock::now();
+
+		Proxy proxy;
+		proxy.Pipelined(test.pipelined);
+		const auto connected = proxy.Initialize("127.0.0.1", std::to_string(port_), std::string(test.host), test.port,
+			std::string(test.username), std::string(test.password)) && proxy.Connect(test.protocol);
+
+		sample.elapsed = std::chrono::steady_clock::now() - start;
+		Allocations::Stop();
+		sample.allocations = Allocations::Count();
+		sample.bytes = Allocations::Bytes();
+		return connected;
+	}
+
+	const Plan& plan_;
+	std::uint16_t port_ = 0;
+};
+
+#endif // !SUITE_HPP
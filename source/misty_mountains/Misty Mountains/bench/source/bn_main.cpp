@@ -0,0 +1,99 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Allocations/Allocations.hpp"
+#include "Args/Args.hpp"
+#include "Report/Report.hpp"
+#include "Suite/Suite.hpp"
+
+auto main(const int argc, char* argv[]) -> int
+{
+	auto args = std::make_unique<Args>();
+
+	args->Initialize(argc, argv);
+
+	//Configuration (by default)
+	Plan plan;
+	auto csv = false;
+	auto tolerance = 10.0;
+	std::vector<Result> baseline;
+
+	try
+	{
+		if (!args->Iterations().empty())
+			plan.iterations = std::stoull(args->Iterations(), nullptr, 10);
+		if (!args->Warmup().empty())
+			plan.warmup = std::stoull(args->Warmup(), nullptr, 10);
+		if (!args->Rounds().empty())
+			plan.rounds = std::stoull(args->Rounds(), nullptr, 10);
+		if (!args->Tolerance().empty())
+			tolerance = std::stod(args->Tolerance());
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong numeric variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!plan.iterations || !plan.rounds || tolerance < 0.0)
+	{
+		std::cerr << "Iterations and rounds must be positive, the tolerance can't be negative" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!args->Output().empty())
+	{
+		if (args->Output() != "text" && args->Output() != "csv")
+		{
+			std::cerr << "Unknown output format " << args->Output() << ", text or csv" << '\n';
+			std::exit(EXIT_FAILURE);
+		}
+		csv = args->Output() == "csv";
+	}
+
+	if (!args->Baseline().empty() && !Report::Load(args->Baseline(), baseline))
+		std::exit(EXIT_FAILURE);
+
+	Suite suite(plan);
+	auto ran = false;
+	auto fine = true;
+
+	for (const auto transport : { Transport::kSocketpair, Transport::kLoopback })
+	{
+#ifdef _WIN32
+		if (transport == Transport::kSocketpair)
+			continue;
+#endif
+		for (const auto& test : Suite::Cases())
+		{
+			if (Suite::Name(test, transport).find(args->Filter()) == std::string::npos)
+				continue;
+
+			Result result;
+			if (!suite.Run(test, transport, result))
+				std::exit(EXIT_FAILURE);
+
+			if (!ran)
+				Report::Header(std::cout, csv);
+			Report::Print(std::cout, result, csv);
+			fine = Report::Compare(result, baseline, tolerance) && fine;
+			ran = true;
+		}
+	}
+
+	if (!ran)
+	{
+		std::cerr << "No benchmark matches " << args->Filter() << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!fine)
+	{
+		std::cerr << "Slower or allocating more than the baseline" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
@@ -22,6 +22,32 @@ public:
 
 		args::ValueFlag<std::string> m_sz_hostname(m_g_arguments, "host", "Hostname to connect. By default 127.0.0.1.", { 'h', "host" });
 		args::ValueFlag<std::string> m_sz_port(m_g_arguments, "port", "Port to connect. By default 1337.", { 'p', "port" });
+		args::ValueFlag<std::string> m_sz_prefix(m_g_arguments, "prefix", "Prefix the server adds to the echo. By default none.", { 'f', "prefix" });
+		args::ValueFlag<std::string> m_sz_suffix(m_g_arguments, "suffix", "Suffix the server adds to the echo. By default none.", { 's', "suffix" });
+		args::ValueFlag<std::string> m_sz_timeout(m_g_arguments, "ms", "How long to wait for the echo. By default 1000ms.", { 't', "timeout" });
+		args::ValueFlag<std::string> m_sz_connect_timeout(m_g_arguments, "ms", "How long to try the server's addresses for, IPv4 and IPv6 race. By default 5000ms.", { "connect-timeout" });
+		args::ValueFlag<std::string> m_sz_framing(m_g_arguments, "framing", "Message framing, must match the server: raw, line or length. By default raw.", { "framing" });
+		args::ValueFlag<std::string> m_sz_window(m_g_arguments, "window", "Messages kept in flight on the connection, needs line or length framing. By default 1.", { 'w', "window" });
+		args::ValueFlag<std::string> m_sz_stream(m_g_arguments, "bytes", "Stream this many bytes (k/m/g suffixes) at the server and verify the echo instead of reading stdin.", { "stream" });
+		args::ValueFlag<std::string> m_sz_stream_file(m_g_arguments, "path", "Stream a memory-mapped file, repeated up to =stream bytes if that is larger.", { "stream-file" });
+		args::ValueFlag<std::string> m_sz_chunk(m_g_arguments, "bytes", "Frame size when streaming with length framing. By default 65536.", { "chunk" });
+		args::ValueFlag<std::string> m_sz_udp(m_g_arguments, "count", "Send this many datagrams (k/m suffixes) to the server's UDP echo and count the echoes, through a SOCKS5 =proxy's UDP relay if there is one.", { "udp" });
+		args::ValueFlag<std::string> m_sz_udp_size(m_g_arguments, "bytes", "Payload of every datagram. By default 1024.", { "udp-size" });
+		args::ValueFlag<std::string> m_sz_udp_batch(m_g_arguments, "count", "Datagrams sent and received per call. By default 32.", { "udp-batch" });
+		args::ValueFlag<std::string> m_sz_batch(m_g_arguments, "path", "Replay the messages of a memory-mapped file instead of reading stdin, needs line or length framing.", { "batch" });
+		args::ValueFlag<std::string> m_sz_batch_format(m_g_arguments, "format", "Batch file layout: lines, or length for 4 byte big endian length prefixed records. By default lines.", { "batch-format" });
+		args::ValueFlag<std::string> m_sz_rate(m_g_arguments, "rps", "Messages per second to replay the batch at, 0 for as fast as the window allows. By default 0.", { "rate" });
+		args::ValueFlag<std::string> m_sz_output(m_g_arguments, "format", "Summary format: text, json or csv. By default text.", { 'o', "output" });
+		args::ValueFlag<std::string> m_sz_output_file(m_g_arguments, "path", "Write the json/csv summary to a file instead of stdout.", { "output-file" });
+		args::ValueFlag<std::string> m_sz_hosts(m_g_arguments, "path", "Hosts file (address name...) answered before DNS, for offline runs.", { "hosts" });
+		args::ValueFlag<std::string> m_sz_proxy(m_g_arguments, "host:port", "Tunnel to the server through this proxy. By default none.", { "proxy" });
+		args::ValueFlag<std::string> m_sz_proxy_set(m_g_arguments, "host:port,...", "Interchangeable proxies, the better of two is used and a second one raced if it is slow. By default none.", { "proxy-set" });
+		args::ValueFlag<std::string> m_sz_proxy_protocol(m_g_arguments, "protocol", "Proxy protocol: socks5, socks4 or http. By default socks5.", { "proxy-protocol" });
+		args::ValueFlag<std::string> m_sz_proxy_username(m_g_arguments, "username", "Username for the proxy, SOCKS5 (RFC 1929), SOCKS4 user id or HTTP basic auth. By default none.", { "proxy-username" });
+		args::ValueFlag<std::string> m_sz_proxy_password(m_g_arguments, "password", "Password for the proxy. By default none.", { "proxy-password" });
+		args::ValueFlag<std::string> m_sz_proxy_spare(m_g_arguments, "tunnels", "Tunnels kept set up in the background, a lost one is replaced at once. By default 0.", { "proxy-spare" });
+		args::Flag m_b_proxy_strict(m_g_arguments, "proxy-strict", "Wait for the SOCKS5 method reply before sending the request, for proxies that can't take both at once.", { "proxy-strict" });
+		args::Flag m_b_fastopen(m_g_arguments, "fastopen", "Send the first message in the SYN with TCP Fast Open, linux only.", { "fastopen" });
 		///
 
 		try
@@ -30,6 +56,32 @@ public:
 
 			this->m_sz_hostname_ = m_sz_hostname.Get();
 			this->m_sz_port_ = m_sz_port.Get();
+			this->m_sz_prefix_ = m_sz_prefix.Get();
+			this->m_sz_suffix_ = m_sz_suffix.Get();
+			this->m_sz_timeout_ = m_sz_timeout.Get();
+			this->m_sz_connect_timeout_ = m_sz_connect_timeout.Get();
+			this->m_sz_framing_ = m_sz_framing.Get();
+			this->m_sz_window_ = m_sz_window.Get();
+			this->m_sz_stream_ = m_sz_stream.Get();
+			this->m_sz_stream_file_ = m_sz_stream_file.Get();
+			this->m_sz_chunk_ = m_sz_chunk.Get();
+			this->m_sz_udp_ = m_sz_udp.Get();
+			this->m_sz_udp_size_ = m_sz_udp_size.Get();
+			this->m_sz_udp_batch_ = m_sz_udp_batch.Get();
+			this->m_sz_batch_ = m_sz_batch.Get();
+			this->m_sz_batch_format_ = m_sz_batch_format.Get();
+			this->m_sz_rate_ = m_sz_rate.Get();
+			this->m_sz_output_ = m_sz_output.Get();
+			this->m_sz_output_file_ = m_sz_output_file.Get();
+			this->m_sz_hosts_ = m_sz_hosts.Get();
+			this->m_sz_proxy_ = m_sz_proxy.Get();
+			this->m_sz_proxy_set_ = m_sz_proxy_set.Get();
+			this->m_sz_proxy_protocol_ = m_sz_proxy_protocol.Get();
+			this->m_sz_proxy_username_ = m_sz_proxy_username.Get();
+			this->m_sz_proxy_password_ = m_sz_proxy_password.Get();
+			this->m_sz_proxy_spare_ = m_sz_proxy_spare.Get();
+			this->m_b_proxy_strict_ = m_b_proxy_strict.Get();
+			this->m_b_fastopen_ = m_b_fastopen.Get();
 		}
 		catch (const args::Help&)
 		{
@@ -53,10 +105,166 @@ public:
 	{
 		return m_sz_port_;
 	}
+
+	auto Prefix(void) -> std::string&
+	{
+		return m_sz_prefix_;
+	}
+
+	auto Suffix(void) -> std::string&
+	{
+		return m_sz_suffix_;
+	}
+
+	auto Timeout(void) -> std::string&
+	{
+		return m_sz_timeout_;
+	}
+
+	auto ConnectTimeout(void) -> std::string&
+	{
+		return m_sz_connect_timeout_;
+	}
+
+	auto Framing(void) -> std::string&
+	{
+		return m_sz_framing_;
+	}
+
+	auto Window(void) -> std::string&
+	{
+		return m_sz_window_;
+	}
+
+	auto Stream(void) -> std::string&
+	{
+		return m_sz_stream_;
+	}
+
+	auto StreamFile(void) -> std::string&
+	{
+		return m_sz_stream_file_;
+	}
+
+	auto Chunk(void) -> std::string&
+	{
+		return m_sz_chunk_;
+	}
+
+	auto Udp(void) -> std::string&
+	{
+		return m_sz_udp_;
+	}
+
+	auto UdpSize(void) -> std::string&
+	{
+		return m_sz_udp_size_;
+	}
+
+	auto UdpBatch(void) -> std::string&
+	{
+		return m_sz_udp_batch_;
+	}
+
+	auto Batch(void) -> std::string&
+	{
+		return m_sz_batch_;
+	}
+
+	auto BatchFormat(void) -> std::string&
+	{
+		return m_sz_batch_format_;
+	}
+
+	auto Rate(void) -> std::string&
+	{
+		return m_sz_rate_;
+	}
+
+	auto Output(void) -> std::string&
+	{
+		return m_sz_output_;
+	}
+
+	auto OutputFile(void) -> std::string&
+	{
+		return m_sz_output_file_;
+	}
+
+	auto Hosts(void) -> std::string&
+	{
+		return m_sz_hosts_;
+	}
+
+	auto Proxy(void) -> std::string&
+	{
+		return m_sz_proxy_;
+	}
+
+	auto ProxySet(void) -> std::string&
+	{
+		return m_sz_proxy_set_;
+	}
+
+	auto ProxyProtocol(void) -> std::string&
+	{
+		return m_sz_proxy_protocol_;
+	}
+
+	auto ProxyUsername(void) -> std::string&
+	{
+		return m_sz_proxy_username_;
+	}
+
+	auto ProxyPassword(void) -> std::string&
+	{
+		return m_sz_proxy_password_;
+	}
+
+	auto ProxySpare(void) -> std::string&
+	{
+		return m_sz_proxy_spare_;
+	}
+
+	auto ProxyStrict(void) const -> bool
+	{
+		return m_b_proxy_strict_;
+	}
+
+	auto FastOpen(void) const -> bool
+	{
+		return m_b_fastopen_;
+	}
 	
 private:
 	std::string m_sz_hostname_;
 	std::string m_sz_port_;
+	std::string m_sz_prefix_;
+	std::string m_sz_suffix_;
+	std::string m_sz_timeout_;
+	std::string m_sz_connect_timeout_;
+	std::string m_sz_framing_;
+	std::string m_sz_window_;
+	std::string m_sz_stream_;
+	std::string m_sz_stream_file_;
+	std::string m_sz_chunk_;
+	std::string m_sz_udp_;
+	std::string m_sz_udp_size_;
+	std::string m_sz_udp_batch_;
+	std::string m_sz_batch_;
+	std::string m_sz_batch_format_;
+	std::string m_sz_rate_;
+	std::string m_sz_output_;
+	std::string m_sz_output_file_;
+	std::string m_sz_hosts_;
+	std::string m_sz_proxy_;
+	std::string m_sz_proxy_set_;
+	std::string m_sz_proxy_protocol_;
+	std::string m_sz_proxy_username_;
+	std::string m_sz_proxy_password_;
+	std::string m_sz_proxy_spare_;
+	bool m_b_proxy_strict_ = false;
+	bool m_b_fastopen_ = false;
 };
 
 #endif // !ARGS_HPP
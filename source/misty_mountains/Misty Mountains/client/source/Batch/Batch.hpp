@@ -0,0 +1,88 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../../../library/source/Framing/Framing.hpp"
+#include "../Mapping/Mapping.hpp"
+
+enum class BatchFormat
+{
+	kLines,
+	kLength
+};
+
+/// <summary>
+/// Messages replayed from a memory-mapped file, handed out as views into the mapping
+/// so nothing is copied until the message is framed.
+/// lines : one message per line, a trailing \r is dropped
+/// length: 4 byte big endian length followed by the message, same as the length framing
+/// </summary>
+class Batch
+{
+public:
+	auto Open(const std::string& path, const BatchFormat format) -> bool
+	{
+		format_ = format;
+		if (!mapping_.Open(path))
+			return false;
+
+		rest_ = mapping_.View();
+		return true;
+	}
+
+	/// <summary>
+	/// Next message of the file, false at the end or at a broken record
+	/// </summary>
+	auto Next(std::string_view& message) -> bool
+	{
+		if (rest_.empty())
+			return false;
+
+		if (format_ == BatchFormat::kLines) {
+			const auto end = rest_.find('\n');
+			message = rest_.substr(0, end);
+			rest_.remove_prefix(end == std::string_view::npos ? rest_.size() : end + 1);
+
+			if (!message.empty() && message.back() == '\r')
+				message.remove_suffix(1);
+		}
+		else {
+			if (rest_.size() < Framer::kHeader) {
+				std::cerr << "Batch record #" << records_ << " has a truncated header" << '\n';
+				return false;
+			}
+
+			const auto* header = reinterpret_cast<const unsigned char*>(rest_.data());
+			const auto length = std::size_t{ header[0] } << 24 | std::size_t{ header[1] } << 16 | std::size_t{ header[2] } << 8 | header[3];
+			if (length > rest_.size() - Framer::kHeader) {
+				std::cerr << "Batch record #" << records_ << " claims " << length << " bytes, only " << rest_.size() - Framer::kHeader << " left" << '\n';
+				return false;
+			}
+
+			message = rest_.substr(Framer::kHeader, length);
+			rest_.remove_prefix(Framer::kHeader + length);
+		}
+
+		++records_;
+		return true;
+	}
+
+	auto Records(void) const -> std::uint64_t
+	{
+		return records_;
+	}
+
+private:
+	Mapping mapping_;
+	BatchFormat format_ = BatchFormat::kLines;
+	std::string_view rest_;
+	std::uint64_t records_ = 0;
+};
+
+#endif // !BATCH_HPP
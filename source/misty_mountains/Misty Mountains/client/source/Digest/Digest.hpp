@@ -0,0 +1,96 @@
+#ifndef DIGEST_HPP
+#define DIGEST_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/// <summary>
+/// Running 64 bit hash over a byte stream, eight bytes per step.
+/// The value only depends on the bytes, not on how they were split into updates,
+/// so the sent and the echoed stream can be hashed as they come.
+/// </summary>
+class Digest
+{
+public:
+	auto Update(std::string_view data) -> void
+	{
+		length_ += data.size();
+
+		// top up a word left over from the previous update first
+		if (pending_) {
+			const auto take = data.size() < 8 - pending_ ? data.size() : 8 - pending_;
+			std::memcpy(tail_ + pending_, data.data(), take);
+			pending_ += take;
+			data.remove_prefix(take);
+
+			if (pending_ < 8)
+				return;
+
+			this->Mix(Load(tail_));
+			pending_ = 0;
+		}
+
+		while (data.size() >= 8) {
+			this->Mix(Load(data.data()));
+			data.remove_prefix(8);
+		}
+
+		std::memcpy(tail_, data.data(), data.size());
+		pending_ = data.size();
+	}
+
+	auto Value(void) const -> std::uint64_t
+	{
+		auto state = state_;
+
+		if (pending_) {
+			unsigned char last[8]{};
+			std::memcpy(last, tail_, pending_);
+			state = Step(state, Load(last));
+		}
+
+		// finalizer from splitmix64, with the length so trailing zeroes count
+		state ^= length_;
+		state ^= state >> 30;
+		state *= 0xBF58476D1CE4E5B9ull;
+		state ^= state >> 27;
+		state *= 0x94D049BB133111EBull;
+		state ^= state >> 31;
+		return state;
+	}
+
+	auto Length(void) const -> std::uint64_t
+	{
+		return length_;
+	}
+
+private:
+	static auto Load(const void* data) -> std::uint64_t
+	{
+		std::uint64_t word;
+		std::memcpy(&word, data, sizeof word);
+		return word;
+	}
+
+	static auto Step(std::uint64_t state, const std::uint64_t word) -> std::uint64_t
+	{
+		state ^= word * 0x9E3779B97F4A7C15ull;
+		state = (state << 31) | (state >> 33);
+		return state * 0xC2B2AE3D27D4EB4Full;
+	}
+
+	auto Mix(const std::uint64_t word) -> void
+	{
+		state_ = Step(state_, word);
+	}
+
+	std::uint64_t state_ = 0x27D4EB2F165667C5ull;
+	std::uint64_t length_ = 0;
+	unsigned char tail_[8]{};
+	std::size_t pending_ = 0;
+};
+
+#endif // !DIGEST_HPP
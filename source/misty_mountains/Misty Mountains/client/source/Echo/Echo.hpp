@@ -0,0 +1,117 @@
+#ifndef ECHO_HPP
+#define ECHO_HPP
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#ifdef _WIN32
+#include <mstcpip.h>
+#endif
+
+/// <summary>
+/// Request/response helpers on a non-blocking socket, waiting for readiness instead of sleeping
+/// </summary>
+class Echo
+{
+public:
+	explicit Echo(kissnet::tcp_socket& socket) :
+		socket_(socket)
+	{
+	}
+
+	/// <summary>
+	/// Sends all of data, waiting for writability when the socket buffer is full
+	/// </summary>
+	auto Send(const std::string_view data, const std::chrono::milliseconds timeout) -> kissnet::socket_status
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		std::size_t offset = 0;
+
+		while (offset < data.size()) {
+			auto [size, status] = socket_.send(reinterpret_cast<const std::byte*>(data.data()) + offset, data.size() - offset);
+
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked) {
+				const auto wait = this->Wait(kissnet::fds_write, deadline);
+				if (wait.value != kissnet::socket_status::valid)
+					return wait;
+				continue;
+			}
+
+			if (!status)
+				return status;
+
+			offset += size;
+		}
+
+		return kissnet::socket_status::valid;
+	}
+
+	/// <summary>
+	/// Appends to out until it holds expected bytes, the peer hangs up or the timeout expires
+	/// </summary>
+	auto Receive(std::string& out, const std::size_t expected, const std::chrono::milliseconds timeout) -> kissnet::socket_status
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		while (out.size() < expected) {
+			auto [size, status] = socket_.recv(buffer_);
+
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked) {
+				const auto wait = this->Wait(kissnet::fds_read, deadline);
+				if (wait.value != kissnet::socket_status::valid)
+					return wait;
+				continue;
+			}
+
+			if (!status || status.value == kissnet::socket_status::cleanly_disconnected)
+				return status;
+
+			out.append(reinterpret_cast<const char*>(buffer_.data()), size);
+		}
+
+		return kissnet::socket_status::valid;
+	}
+
+	/// <summary>
+	/// Smoothed RTT the kernel keeps for the connection, if the platform reports it
+	/// </summary>
+	auto KernelRtt(void) const -> std::optional<std::chrono::microseconds>
+	{
+#if defined(__linux__)
+		tcp_info info{};
+		socklen_t length = sizeof info;
+		if (getsockopt(socket_.get_handle(), IPPROTO_TCP, TCP_INFO, &info, &length) == 0)
+			return std::chrono::microseconds(info.tcpi_rtt);
+#elif defined(SIO_TCP_INFO)
+		// windows 10 1703 and later
+		DWORD version = 0;
+		TCP_INFO_v0 info{};
+		DWORD length = 0;
+		if (WSAIoctl(socket_.get_handle(), SIO_TCP_INFO, &version, sizeof version, &info, sizeof info, &length, nullptr, nullptr) == 0)
+			return std::chrono::microseconds(info.RttUs);
+#endif
+		return std::nullopt;
+	}
+
+private:
+	auto Wait(const int fds, const std::chrono::steady_clock::time_point deadline) -> kissnet::socket_status
+	{
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (left.count() <= 0)
+			return kissnet::socket_status::timed_out;
+
+		return socket_.select(fds, left.count());
+	}
+
+private:
+	kissnet::tcp_socket& socket_;
+	kissnet::buffer<4096> buffer_;
+};
+
+#endif // !ECHO_HPP
@@ -0,0 +1,160 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// HDR-style latency histogram: values below 128ns are exact, above that every
+/// power of two is split in 64 linear sub-buckets, so any recorded value is
+/// reported with less than 1.6% error over the whole 64 bit range
+/// </summary>
+class Histogram
+{
+	static constexpr unsigned kSubBits = 7;
+	static constexpr std::uint64_t kSub = std::uint64_t{ 1 } << kSubBits;
+	static constexpr std::uint64_t kHalf = kSub / 2;
+
+public:
+	/// exact values, then one run of sub-buckets per remaining power of two
+	static constexpr std::size_t kBuckets = kSub + (64 - kSubBits) * kHalf;
+
+	Histogram(void) :
+		buckets_(kBuckets, 0)
+	{
+	}
+
+	auto Record(const std::chrono::nanoseconds value) -> void
+	{
+		const auto ns = static_cast<std::uint64_t>(value.count() < 0 ? 0 : value.count());
+
+		++buckets_[Index(ns)];
+		++count_;
+		sum_ += ns;
+
+		if (ns < min_)
+			min_ = ns;
+		if (ns > max_)
+			max_ = ns;
+	}
+
+	auto Count(void) const -> std::uint64_t
+	{
+		return count_;
+	}
+
+	auto Min(void) const -> std::chrono::nanoseconds
+	{
+		return std::chrono::nanoseconds(count_ ? min_ : 0);
+	}
+
+	auto Max(void) const -> std::chrono::nanoseconds
+	{
+		return std::chrono::nanoseconds(max_);
+	}
+
+	auto Mean(void) const -> std::chrono::nanoseconds
+	{
+		return std::chrono::nanoseconds(count_ ? sum_ / count_ : 0);
+	}
+
+	/// <summary>
+	/// Highest value equivalent to the one at the given percentile, clamped to the recorded max
+	/// </summary>
+	auto Percentile(const double percentile) const -> std::chrono::nanoseconds
+	{
+		if (!count_)
+			return std::chrono::nanoseconds(0);
+
+		auto target = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+		if (target < 1)
+			target = 1;
+
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < buckets_.size(); ++i) {
+			seen += buckets_[i];
+			if (seen >= target)
+				return std::chrono::nanoseconds(Highest(i) < max_ ? Highest(i) : max_);
+		}
+
+		return Max();
+	}
+
+	/// <summary>
+	/// Adds every value recorded in other
+	/// </summary>
+	auto Merge(const Histogram& other) -> void
+	{
+		this->Merge(other.buckets_.data(), other.count_, other.sum_, other.min_, other.max_);
+	}
+
+	/// <summary>
+	/// Adds raw histogram state, e.g. one aggregated in shared memory; buckets holds kBuckets counters
+	/// </summary>
+	auto Merge(const std::uint64_t* buckets, const std::uint64_t count, const std::uint64_t sum, const std::uint64_t min, const std::uint64_t max) -> void
+	{
+		for (std::size_t i = 0; i < kBuckets; ++i)
+			buckets_[i] += buckets[i];
+
+		count_ += count;
+		sum_ += sum;
+		if (min < min_)
+			min_ = min;
+		if (max > max_)
+			max_ = max;
+	}
+
+	auto Buckets(void) const -> const std::vector<std::uint64_t>&
+	{
+		return buckets_;
+	}
+
+	auto Sum(void) const -> std::uint64_t
+	{
+		return sum_;
+	}
+
+private:
+
+	static constexpr auto Width(std::uint64_t value) -> unsigned
+	{
+		unsigned width = 0;
+		while (value) {
+			value >>= 1;
+			++width;
+		}
+		return width;
+	}
+
+	static constexpr auto Index(const std::uint64_t value) -> std::size_t
+	{
+		if (value < kSub)
+			return static_cast<std::size_t>(value);
+
+		const auto shift = Width(value) - kSubBits;
+		const auto sub = value >> shift;
+		return static_cast<std::size_t>(kSub + (shift - 1) * kHalf + (sub - kHalf));
+	}
+
+	static constexpr auto Highest(const std::size_t index) -> std::uint64_t
+	{
+		if (index < kSub)
+			return index;
+
+		const auto shift = (index - kSub) / kHalf + 1;
+		const auto sub = (index - kSub) % kHalf + kHalf;
+		return ((sub + 1) << shift) - 1;
+	}
+
+	std::vector<std::uint64_t> buckets_;
+	std::uint64_t count_ = 0;
+	std::uint64_t sum_ = 0;
+	std::uint64_t min_ = UINT64_MAX;
+	std::uint64_t max_ = 0;
+};
+
+#endif // !HISTOGRAM_HPP
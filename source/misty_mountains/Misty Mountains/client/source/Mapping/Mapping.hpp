@@ -0,0 +1,93 @@
+#ifndef MAPPING_HPP
+#define MAPPING_HPP
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Read-only memory mapping of a whole file, pages are faulted in as they are sent
+/// </summary>
+class Mapping
+{
+public:
+	Mapping(void) = default;
+
+	~Mapping(void)
+	{
+#ifdef _WIN32
+		if (data_)
+			UnmapViewOfFile(data_);
+		if (mapping_)
+			CloseHandle(mapping_);
+		if (file_ != INVALID_HANDLE_VALUE)
+			CloseHandle(file_);
+#else
+		if (data_)
+			munmap(const_cast<char*>(data_), size_);
+#endif
+	}
+
+	Mapping(const Mapping&) = delete;
+	Mapping& operator=(const Mapping&) = delete;
+
+	auto Open(const std::string& path) -> bool
+	{
+#ifdef _WIN32
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		LARGE_INTEGER size{};
+		if (file_ != INVALID_HANDLE_VALUE && GetFileSizeEx(file_, &size)) {
+			size_ = static_cast<std::size_t>(size.QuadPart);
+			mapping_ = size_ ? CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+			if (mapping_)
+				data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+		}
+#else
+		const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat info {};
+		if (fd >= 0 && fstat(fd, &info) == 0) {
+			size_ = static_cast<std::size_t>(info.st_size);
+			auto* memory = size_ ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+			if (memory != MAP_FAILED) {
+				data_ = static_cast<const char*>(memory);
+				// read front to back, let the kernel read ahead aggressively
+				madvise(memory, size_, MADV_SEQUENTIAL);
+			}
+		}
+		if (fd >= 0)
+			::close(fd);
+#endif
+		if (!data_) {
+			std::cerr << "Can't map " << path << (size_ ? "" : ", is it empty?") << '\n';
+			return false;
+		}
+
+		return true;
+	}
+
+	auto View(void) const -> std::string_view
+	{
+		return std::string_view(data_, size_);
+	}
+
+private:
+	const char* data_ = nullptr;
+	std::size_t size_ = 0;
+#ifdef _WIN32
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	HANDLE mapping_ = nullptr;
+#endif
+};
+
+#endif // !MAPPING_HPP
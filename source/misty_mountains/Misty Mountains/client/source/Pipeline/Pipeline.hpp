@@ -0,0 +1,258 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <istream>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#include "../Echo/Echo.hpp"
+#include "../../../library/source/Framing/Framing.hpp"
+#include "../Report/Report.hpp"
+
+/// <summary>
+/// Keeps up to window framed messages outstanding on one connection.
+/// The server answers in order, so every echo is matched with the oldest send timestamp and message.
+/// </summary>
+class Pipeline
+{
+public:
+	Pipeline(kissnet::tcp_socket& socket, const Framing framing, const std::size_t window, Report& report) :
+		socket_(socket), echo_(socket), framing_(framing), window_(window ? window : 1), report_(report)
+	{
+	}
+
+	/// <summary>
+	/// Every echo is compared with prefix + message + suffix, mismatches are counted in the report
+	/// </summary>
+	auto Verify(const std::string& prefix, const std::string& suffix) -> void
+	{
+		prefix_ = prefix;
+		suffix_ = suffix;
+	}
+
+	/// <summary>
+	/// Sends at most rate messages per second, 0 sends as fast as the window allows
+	/// </summary>
+	auto Pace(const double rate) -> void
+	{
+		rate_ = rate;
+	}
+
+	/// <summary>
+	/// Sends every line of in and waits for all echoes, stops at an empty line or "quit"
+	/// </summary>
+	auto Run(std::istream& in, const std::chrono::milliseconds timeout) -> bool
+	{
+		return this->Run([this, &in](std::string_view& message) {
+			std::string line;
+			if (!std::getline(in, line) || line.empty() || line == "quit")
+				return false;
+
+			// deque elements never move, the view stays valid until the echo is matched
+			lines_.push_back(std::move(line));
+			message = lines_.back();
+			return true;
+			}, timeout);
+	}
+
+	/// <summary>
+	/// Sends every message next hands out and waits for all echoes. The views must stay valid
+	/// until the run is over. Returns false if the connection failed or nothing came back
+	/// within timeout, the requests still in flight count as timed out
+	/// </summary>
+	template <typename Next>
+	auto Run(Next&& next, const std::chrono::milliseconds timeout) -> bool
+	{
+		started_ = progress_ = std::chrono::steady_clock::now();
+
+		while (!eof_ || !in_flight_.empty()) {
+			const auto due = this->Fill(next);
+
+			if (!this->Flush() || !this->Read())
+				return this->Abort();
+
+			const auto now = std::chrono::steady_clock::now();
+
+			// the window is open and the next message is due, keep queueing before waiting
+			if (!eof_ && in_flight_.size() < window_ && due <= now)
+				continue;
+			if (eof_ && in_flight_.empty())
+				break;
+
+			if (!in_flight_.empty() && now - progress_ >= timeout) {
+				std::cerr << "No echo within " << timeout.count() << "ms, " << in_flight_.size() << " request(s) in flight" << '\n';
+				return this->Abort();
+			}
+
+			// echoes are waited for until the timeout, a paced message until it is due
+			std::chrono::steady_clock::duration wait = timeout - (now - progress_);
+			if (!eof_ && in_flight_.size() < window_)
+				wait = in_flight_.empty() ? due - now : std::min(wait, due - now);
+
+			const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait).count();
+
+			const auto fds = kissnet::fds_read | (sent_ < outbox_.size() ? kissnet::fds_write : 0);
+			const auto status = socket_.select(fds, ms > 0 ? ms : 0);
+			if (status.value == kissnet::socket_status::errored)
+				return this->Abort();
+		}
+
+		return true;
+	}
+
+private:
+	/// <summary>
+	/// Frames messages until the window is full, returns when the next paced message is due
+	/// </summary>
+	template <typename Next>
+	auto Fill(Next& next) -> std::chrono::steady_clock::time_point
+	{
+		while (!eof_ && in_flight_.size() < window_) {
+			const auto now = std::chrono::steady_clock::now();
+			if (rate_ > 0.0) {
+				const auto due = started_ + std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(queued_) * 1e9 / rate_));
+				if (due > now)
+					return due;
+			}
+
+			std::string_view message;
+			if (!next(message)) {
+				eof_ = true;
+				break;
+			}
+
+			// the echo timeout runs from the last echo, or from now if nothing was outstanding
+			if (in_flight_.empty())
+				progress_ = now;
+
+			Framer::Encode(outbox_, framing_, message);
+			in_flight_.push_back({ now, message });
+			report_.Begin(now);
+			++queued_;
+		}
+
+		return std::chrono::steady_clock::now();
+	}
+
+	auto Flush(void) -> bool
+	{
+		while (sent_ < outbox_.size()) {
+			auto [size, status] = socket_.send(reinterpret_cast<const std::byte*>(outbox_.data()) + sent_, outbox_.size() - sent_);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				break;
+			if (!status)
+				return false;
+
+			sent_ += size;
+		}
+
+		if (sent_ == outbox_.size()) {
+			outbox_.clear();
+			sent_ = 0;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Reads whatever arrived and matches complete echoes with their send timestamps
+	/// </summary>
+	auto Read(void) -> bool
+	{
+		auto received = false;
+		for (;;) {
+			auto [size, status] = socket_.recv(buffer_);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				break;
+			if (!status || status.value == kissnet::socket_status::cleanly_disconnected)
+				return false;
+
+			inbox_.append(reinterpret_cast<const char*>(buffer_.data()), size);
+			received = true;
+		}
+
+		if (!received)
+			return true;
+
+		const auto now = progress_ = std::chrono::steady_clock::now();
+		// one TCP_INFO sample per batch is plenty, the kernel only smooths it once per ack anyway
+		auto kernel_rtt = echo_.KernelRtt();
+		auto unexpected = false;
+
+		const auto framed = Framer::Extract(inbox_, framing_, [&](const std::string_view message) {
+			if (in_flight_.empty()) {
+				unexpected = true;
+				return;
+			}
+
+			const auto& request = in_flight_.front();
+			report_.Request(now - request.at, kernel_rtt, request.message.size() + message.size());
+			kernel_rtt.reset();
+
+			if (message.size() != prefix_.size() + request.message.size() + suffix_.size() ||
+				message.substr(0, prefix_.size()) != prefix_ ||
+				message.substr(prefix_.size(), request.message.size()) != request.message ||
+				message.substr(prefix_.size() + request.message.size()) != suffix_)
+				report_.Mismatch();
+
+			in_flight_.pop_front();
+			if (!lines_.empty())
+				lines_.pop_front();
+			});
+
+		if (!framed || unexpected) {
+			std::cerr << "Server sent an echo nobody asked for, check =framing" << '\n';
+			return false;
+		}
+
+		return true;
+	}
+
+	auto Abort(void) -> bool
+	{
+		for (std::size_t i = 0; i < in_flight_.size(); ++i)
+			report_.Timeout();
+
+		in_flight_.clear();
+		lines_.clear();
+		return false;
+	}
+
+	kissnet::tcp_socket& socket_;
+	Echo echo_;
+	Framing framing_;
+	std::size_t window_;
+	Report& report_;
+
+	std::string prefix_;
+	std::string suffix_;
+	double rate_ = 0.0;
+
+	struct Sent
+	{
+		std::chrono::steady_clock::time_point at;
+		std::string_view message;
+	};
+
+	std::deque<Sent> in_flight_;
+	std::deque<std::string> lines_;
+	std::uint64_t queued_ = 0;
+	std::chrono::steady_clock::time_point started_;
+	std::chrono::steady_clock::time_point progress_;
+	std::string outbox_;
+	std::size_t sent_ = 0;
+	std::string inbox_;
+	kissnet::buffer<4096> buffer_;
+	bool eof_ = false;
+};
+
+#endif // !PIPELINE_HPP
@@ -0,0 +1,167 @@
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+
+#include "../Histogram/Histogram.hpp"
+
+enum class Output
+{
+	kText,
+	kJson,
+	kCsv
+};
+
+/// <summary>
+/// Collects the outcome of every request of a run and prints the summary
+/// </summary>
+class Report
+{
+public:
+	/// <summary>
+	/// Called right before a request is sent, the first call starts the throughput clock
+	/// </summary>
+	auto Begin(const std::chrono::steady_clock::time_point at) -> void
+	{
+		if (!started_)
+			started_ = at;
+	}
+
+	auto Request(const std::chrono::nanoseconds rtt, const std::optional<std::chrono::microseconds> kernel_rtt, const std::size_t bytes) -> void
+	{
+		rtt_.Record(rtt);
+		if (kernel_rtt)
+			kernel_rtt_.Record(*kernel_rtt);
+
+		bytes_ += bytes;
+		finished_ = std::chrono::steady_clock::now();
+	}
+
+	auto Timeout(void) -> void
+	{
+		++timeouts_;
+		finished_ = std::chrono::steady_clock::now();
+	}
+
+	/// <summary>
+	/// An echo arrived but isn't prefix + message + suffix
+	/// </summary>
+	auto Mismatch(void) -> void
+	{
+		++mismatches_;
+	}
+
+	auto Print(std::ostream& out, const Output output) const -> void
+	{
+		if (output == Output::kJson)
+			this->Json(out);
+		else if (output == Output::kCsv)
+			this->Csv(out);
+		else
+			this->Text(out);
+	}
+
+private:
+	auto Elapsed(void) const -> double
+	{
+		return started_ ? std::chrono::duration<double>(finished_ - *started_).count() : 0.0;
+	}
+
+	auto Throughput(void) const -> double
+	{
+		const auto elapsed = Elapsed();
+		return elapsed > 0.0 ? static_cast<double>(rtt_.Count()) / elapsed : 0.0;
+	}
+
+	static auto Us(const std::chrono::nanoseconds value) -> double
+	{
+		return static_cast<double>(value.count()) / 1000.0;
+	}
+
+	auto Text(std::ostream& out) const -> void
+	{
+		out << "requests: " << rtt_.Count() << " timeouts: " << timeouts_ << " mismatches: " << mismatches_
+			<< " in " << Elapsed() << "s (" << Throughput() << " req/s, "
+			<< (Elapsed() > 0.0 ? static_cast<double>(bytes_) / Elapsed() : 0.0) << " bytes/s)" << '\n';
+
+		const auto line = [&out](const char* name, const Histogram& histogram) {
+			if (!histogram.Count())
+				return;
+
+			out << name << ":"
+				<< " min=" << Us(histogram.Min()) << "us"
+				<< " p50=" << Us(histogram.Percentile(50.0)) << "us"
+				<< " p90=" << Us(histogram.Percentile(90.0)) << "us"
+				<< " p99=" << Us(histogram.Percentile(99.0)) << "us"
+				<< " p99.9=" << Us(histogram.Percentile(99.9)) << "us"
+				<< " max=" << Us(histogram.Max()) << "us" << '\n';
+		};
+
+		line("rtt", rtt_);
+		line("kernel rtt", kernel_rtt_);
+	}
+
+	auto Json(std::ostream& out) const -> void
+	{
+		const auto object = [&out](const Histogram& histogram) {
+			out << "{\"count\":" << histogram.Count()
+				<< ",\"min_us\":" << Us(histogram.Min())
+				<< ",\"p50_us\":" << Us(histogram.Percentile(50.0))
+				<< ",\"p90_us\":" << Us(histogram.Percentile(90.0))
+				<< ",\"p99_us\":" << Us(histogram.Percentile(99.0))
+				<< ",\"p999_us\":" << Us(histogram.Percentile(99.9))
+				<< ",\"max_us\":" << Us(histogram.Max())
+				<< ",\"mean_us\":" << Us(histogram.Mean()) << "}";
+		};
+
+		out << "{\"requests\":" << rtt_.Count()
+			<< ",\"timeouts\":" << timeouts_
+			<< ",\"mismatches\":" << mismatches_
+			<< ",\"bytes\":" << bytes_
+			<< ",\"elapsed_s\":" << Elapsed()
+			<< ",\"throughput_rps\":" << Throughput()
+			<< ",\"rtt\":";
+		object(rtt_);
+		out << ",\"kernel_rtt\":";
+		object(kernel_rtt_);
+		out << "}" << '\n';
+	}
+
+	auto Csv(std::ostream& out) const -> void
+	{
+		out << "metric,count,min_us,p50_us,p90_us,p99_us,p999_us,max_us,mean_us,timeouts,mismatches,elapsed_s,throughput_rps" << '\n';
+
+		const auto row = [&out, this](const char* name, const Histogram& histogram) {
+			out << name << ',' << histogram.Count()
+				<< ',' << Us(histogram.Min())
+				<< ',' << Us(histogram.Percentile(50.0))
+				<< ',' << Us(histogram.Percentile(90.0))
+				<< ',' << Us(histogram.Percentile(99.0))
+				<< ',' << Us(histogram.Percentile(99.9))
+				<< ',' << Us(histogram.Max())
+				<< ',' << Us(histogram.Mean())
+				<< ',' << timeouts_
+				<< ',' << mismatches_
+				<< ',' << Elapsed()
+				<< ',' << Throughput() << '\n';
+		};
+
+		row("rtt", rtt_);
+		row("kernel_rtt", kernel_rtt_);
+	}
+
+	Histogram rtt_;
+	Histogram kernel_rtt_;
+	std::uint64_t timeouts_ = 0;
+	std::uint64_t mismatches_ = 0;
+	std::uint64_t bytes_ = 0;
+	std::optional<std::chrono::steady_clock::time_point> started_;
+	std::chrono::steady_clock::time_point finished_;
+};
+
+#endif // !REPORT_HPP
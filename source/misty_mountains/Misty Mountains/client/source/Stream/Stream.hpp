@@ -0,0 +1,233 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#include "../Digest/Digest.hpp"
+#include "../../../library/source/Framing/Framing.hpp"
+
+/// <summary>
+/// Streams total bytes at the server as fast as it takes them and reads the echo in the same loop.
+/// Nothing is buffered: both directions are hashed on the fly and compared at the end.
+/// raw   : the echo must be byte for byte the stream, so no prefix/suffix
+/// length: the stream is cut into frames of chunk bytes, the decoration of every echoed frame is checked and skipped
+/// </summary>
+class Stream
+{
+public:
+	Stream(kissnet::tcp_socket& socket, const Framing framing, const std::string& prefix, const std::string& suffix, const std::size_t chunk) :
+		socket_(socket), framing_(framing), prefix_(prefix), suffix_(suffix), chunk_(chunk ? chunk : 1)
+	{
+	}
+
+	/// <summary>
+	/// Sends total bytes, source is repeated as often as needed. False if the connection
+	/// failed, stalled for longer than timeout or the echo didn't match
+	/// </summary>
+	auto Run(const std::string_view source, const std::uint64_t total, const std::chrono::milliseconds timeout) -> bool
+	{
+		source_ = source;
+		total_ = total;
+		started_ = std::chrono::steady_clock::now();
+		sent_at_ = finished_ = started_;
+
+		// the last echoed frame's suffix may still be on its way once the payload is all in
+		while (received_ < total_ || body_left_ || header_got_) {
+			const auto fds = kissnet::fds_read | (sent_ < total_ ? kissnet::fds_write : 0);
+			const auto status = socket_.select(fds, timeout.count());
+			if (status.value == kissnet::socket_status::timed_out) {
+				std::cerr << "Stream stalled for " << timeout.count() << "ms after " << received_ << " of " << total_ << " bytes" << '\n';
+				return false;
+			}
+			if (status.value != kissnet::socket_status::valid)
+				return false;
+
+			if (sent_ < total_ && !this->Send())
+				return false;
+			if (!this->Receive())
+				return false;
+		}
+
+		finished_ = std::chrono::steady_clock::now();
+		return !corrupted_ && sent_digest_.Value() == echo_digest_.Value();
+	}
+
+	auto Report(std::ostream& out) const -> void
+	{
+		const auto gbits = [](const std::uint64_t bytes, const std::chrono::steady_clock::duration elapsed) {
+			const auto seconds = std::chrono::duration<double>(elapsed).count();
+			return seconds > 0.0 ? static_cast<double>(bytes) * 8.0 / seconds / 1e9 : 0.0;
+		};
+
+		out << "streamed " << sent_ << " bytes, echoed " << received_ << " in "
+			<< std::chrono::duration<double>(finished_ - started_).count() << "s" << '\n'
+			<< "send: " << gbits(sent_, sent_at_ - started_) << " Gbit/s"
+			<< " round trip: " << gbits(received_, finished_ - started_) << " Gbit/s" << '\n'
+			<< "digest sent " << std::hex << sent_digest_.Value() << " echoed " << echo_digest_.Value() << std::dec
+			<< (corrupted_ || sent_digest_.Value() != echo_digest_.Value() ? " MISMATCH" : " ok") << '\n';
+	}
+
+private:
+	auto Send(void) -> bool
+	{
+		while (sent_ < total_) {
+			if (!header_left_ && !frame_left_) {
+				frame_left_ = framing_ == Framing::kLength ? std::min<std::uint64_t>(chunk_, total_ - sent_) : total_ - sent_;
+				if (framing_ == Framing::kLength) {
+					const auto length = static_cast<std::uint32_t>(frame_left_);
+					header_[0] = static_cast<char>(length >> 24);
+					header_[1] = static_cast<char>(length >> 16);
+					header_[2] = static_cast<char>(length >> 8);
+					header_[3] = static_cast<char>(length);
+					header_left_ = Framer::kHeader;
+				}
+			}
+
+			const char* data;
+			std::size_t length;
+			if (header_left_) {
+				data = header_ + Framer::kHeader - header_left_;
+				length = header_left_;
+			}
+			else {
+				const auto position = static_cast<std::size_t>(sent_ % source_.size());
+				data = source_.data() + position;
+				length = static_cast<std::size_t>(std::min<std::uint64_t>({ frame_left_, source_.size() - position, chunk_ }));
+			}
+
+			const auto [size, status] = socket_.send(reinterpret_cast<const std::byte*>(data), length);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				return true;
+			if (!status)
+				return false;
+
+			if (header_left_) {
+				header_left_ -= size;
+				continue;
+			}
+
+			sent_digest_.Update(std::string_view(data, size));
+			sent_ += size;
+			frame_left_ -= size;
+		}
+
+		sent_at_ = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	auto Receive(void) -> bool
+	{
+		for (;;) {
+			const auto [size, status] = socket_.recv(buffer_);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				return true;
+			if (!status || status.value == kissnet::socket_status::cleanly_disconnected) {
+				std::cerr << "Server hung up after " << received_ << " of " << total_ << " bytes" << '\n';
+				return false;
+			}
+
+			auto data = std::string_view(reinterpret_cast<const char*>(buffer_.data()), size);
+			if (framing_ != Framing::kLength) {
+				echo_digest_.Update(data);
+				received_ += data.size();
+				continue;
+			}
+
+			while (!data.empty()) {
+				if (!body_left_) {
+					const auto take = std::min(data.size(), Framer::kHeader - header_got_);
+					std::memcpy(header_in_ + header_got_, data.data(), take);
+					header_got_ += take;
+					data.remove_prefix(take);
+
+					if (header_got_ < Framer::kHeader)
+						break;
+
+					const auto* header = reinterpret_cast<const unsigned char*>(header_in_);
+					body_left_ = body_size_ = std::size_t{ header[0] } << 24 | std::size_t{ header[1] } << 16 | std::size_t{ header[2] } << 8 | header[3];
+					header_got_ = 0;
+					if (body_size_ < prefix_.size() + suffix_.size()) {
+						std::cerr << "Echoed frame is shorter than =prefix + =suffix" << '\n';
+						return false;
+					}
+					continue;
+				}
+
+				const auto piece = data.substr(0, std::min<std::size_t>(data.size(), body_left_));
+				this->Body(body_size_ - body_left_, piece);
+				body_left_ -= piece.size();
+				data.remove_prefix(piece.size());
+			}
+		}
+	}
+
+	/// <summary>
+	/// Part of an echoed frame starting at offset: decoration is checked, the payload hashed
+	/// </summary>
+	auto Body(const std::size_t offset, const std::string_view piece) -> void
+	{
+		const auto payload_end = body_size_ - suffix_.size();
+
+		for (std::size_t i = 0; i < piece.size();) {
+			const auto at = offset + i;
+			if (at < prefix_.size()) {
+				const auto n = std::min(piece.size() - i, prefix_.size() - at);
+				corrupted_ |= piece.substr(i, n) != std::string_view(prefix_).substr(at, n);
+				i += n;
+			}
+			else if (at < payload_end) {
+				const auto n = std::min(piece.size() - i, payload_end - at);
+				echo_digest_.Update(piece.substr(i, n));
+				received_ += n;
+				i += n;
+			}
+			else {
+				const auto n = piece.size() - i;
+				corrupted_ |= piece.substr(i, n) != std::string_view(suffix_).substr(at - payload_end, n);
+				i += n;
+			}
+		}
+	}
+
+	kissnet::tcp_socket& socket_;
+	Framing framing_;
+	const std::string& prefix_;
+	const std::string& suffix_;
+	std::size_t chunk_;
+
+	std::string_view source_;
+	std::uint64_t total_ = 0;
+	std::uint64_t sent_ = 0;
+	std::uint64_t received_ = 0;
+	Digest sent_digest_;
+	Digest echo_digest_;
+	bool corrupted_ = false;
+
+	// sending side of the current frame
+	char header_[Framer::kHeader]{};
+	std::size_t header_left_ = 0;
+	std::uint64_t frame_left_ = 0;
+
+	// receiving side of the current echoed frame
+	char header_in_[Framer::kHeader]{};
+	std::size_t header_got_ = 0;
+	std::size_t body_size_ = 0;
+	std::size_t body_left_ = 0;
+	kissnet::buffer<65536> buffer_;
+
+	std::chrono::steady_clock::time_point started_;
+	std::chrono::steady_clock::time_point sent_at_;
+	std::chrono::steady_clock::time_point finished_;
+};
+
+#endif // !STREAM_HPP
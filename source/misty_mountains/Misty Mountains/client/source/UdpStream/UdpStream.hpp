@@ -0,0 +1,201 @@
+#ifndef UDP_STREAM_HPP
+#define UDP_STREAM_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include "../../../library/source/Datagram/Datagram.hpp"
+#include "../../../library/source/Proxy/Proxy.hpp"
+
+/// <summary>
+/// Sends datagrams at the server's UDP echo, batch by batch, and counts the echoes. Directly
+/// on a connected socket or through the UDP relay of a proxy, which wraps every datagram in
+/// the headroom kept in front of it. Each datagram starts with its sequence number; an echo
+/// of the wrong size or of one that wasn't sent is corrupt. UDP may drop anything: what is
+/// still in flight after timeout without an echo is given up as lost and echoes of it that
+/// come later are only counted as late. At most kWindow batches are in flight, so the echo
+/// is measured and not how fast the socket buffers overflow
+/// </summary>
+class UdpStream
+{
+public:
+	static constexpr std::size_t kWindow = 2;
+
+	UdpStream(SOCKET fd, Proxy* proxy, const std::size_t size, const std::size_t batch) :
+		fd_(fd), proxy_(proxy), size_(std::max(size, sizeof(std::uint64_t))), batch_(std::clamp<std::size_t>(batch, 1, Datagrams::kBatch)),
+		slot_(2 * Datagrams::kHeadroom + size_), buffer_(slot_ * batch_), datagrams_(batch_)
+	{
+	}
+
+	/// <summary>
+	/// Sends total datagrams and waits for their echoes. False if the socket failed or an echo was corrupt
+	/// </summary>
+	auto Run(const std::uint64_t total, const std::chrono::milliseconds timeout) -> bool
+	{
+		started_ = sent_at_ = finished_ = std::chrono::steady_clock::now();
+
+		while (this->Settled() < total) {
+			const auto sending = sent_ < total && sent_ - this->Settled() < batch_ * kWindow;
+
+			pollfd ready{};
+			ready.fd = fd_;
+			ready.events = POLLIN | (sending ? POLLOUT : 0);
+#ifdef _WIN32
+			const auto waited = WSAPoll(&ready, 1, static_cast<int>(timeout.count()));
+#else
+			const auto waited = ::poll(&ready, 1, static_cast<int>(timeout.count()));
+#endif
+			if (waited < 0) {
+				std::cerr << "Can't wait for the datagram socket, error " << LastError() << '\n';
+				return false;
+			}
+
+			if (!waited) {
+				// whatever is in flight isn't coming back anymore
+				lost_ += sent_ - this->Settled();
+				given_up_ = sent_;
+				continue;
+			}
+
+			if ((ready.revents & POLLOUT) && !this->Send(total))
+				return false;
+			if ((ready.revents & (POLLIN | POLLERR)) && !this->Receive())
+				return false;
+		}
+
+		return !corrupt_;
+	}
+
+	auto Report(std::ostream& out) const -> void
+	{
+		const auto rate = [](const std::uint64_t datagrams, const std::chrono::steady_clock::duration elapsed) {
+			const auto seconds = std::chrono::duration<double>(elapsed).count();
+			return seconds > 0.0 ? static_cast<double>(datagrams) / seconds : 0.0;
+		};
+
+		const auto bits = static_cast<double>(size_) * 8.0 / 1e9;
+		const auto sends = rate(sent_, sent_at_ - started_);
+		const auto echoes = rate(echoed_, finished_ - started_);
+
+		out << "sent " << sent_ << " datagrams of " << size_ << " bytes, echoed " << echoed_ << " lost " << lost_
+			<< " (" << late_ << " late) corrupt " << corrupt_ << " in " << std::chrono::duration<double>(finished_ - started_).count() << "s" << '\n'
+			<< "send: " << sends << " datagrams/s (" << sends * bits << " Gbit/s)"
+			<< " echo: " << echoes << " datagrams/s (" << echoes * bits << " Gbit/s)" << '\n'
+			<< "datagrams per call: send " << Per(sent_, send_calls_) << " receive " << Per(echoed_ + late_ + corrupt_, receive_calls_) << '\n';
+	}
+
+private:
+	/// <summary>
+	/// Datagrams that were echoed, given up or came back corrupt
+	/// </summary>
+	auto Settled(void) const -> std::uint64_t
+	{
+		return echoed_ + lost_ + corrupt_;
+	}
+
+	/// <summary>
+	/// One batch, as much of it as the window has room for
+	/// </summary>
+	auto Send(const std::uint64_t total) -> bool
+	{
+		const auto room = batch_ * kWindow - static_cast<std::size_t>(sent_ - this->Settled());
+		const auto count = static_cast<std::size_t>(std::min<std::uint64_t>({ batch_, total - sent_, room }));
+
+		for (std::size_t i = 0; i < count; ++i) {
+			auto& datagram = datagrams_[i];
+			datagram.data = buffer_.data() + i * slot_ + Datagrams::kHeadroom;
+			datagram.size = size_;
+			datagram.length = 0;
+
+			const auto sequence = sent_ + i;
+			std::memcpy(datagram.data, &sequence, sizeof sequence);
+		}
+
+		const auto sent = proxy_ ? proxy_->SendDatagrams(datagrams_.data(), count) : Datagrams::Send(fd_, datagrams_.data(), count);
+		++send_calls_;
+		if (!sent && !WouldBlock()) {
+			std::cerr << "Can't send datagrams, error " << LastError() << '\n';
+			return false;
+		}
+
+		sent_ += sent;
+		sent_at_ = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	auto Receive(void) -> bool
+	{
+		const auto received = proxy_ ? proxy_->ReceiveDatagrams(datagrams_.data(), batch_, buffer_.data(), slot_) :
+			Datagrams::Receive(fd_, datagrams_.data(), batch_, buffer_.data(), slot_);
+		if (received < 0) {
+			std::cerr << (LastError() == ECONNREFUSED ? "Nothing echoes datagrams there" : "Can't receive datagrams, error " + std::to_string(LastError())) << '\n';
+			return false;
+		}
+
+		receive_calls_ += received > 0;
+		for (std::int64_t i = 0; i < received; ++i) {
+			const auto& datagram = datagrams_[static_cast<std::size_t>(i)];
+
+			std::uint64_t sequence = 0;
+			std::memcpy(&sequence, datagram.data, std::min(datagram.size, sizeof sequence));
+
+			if (datagram.size != size_ || sequence >= sent_)
+				++corrupt_;
+			else if (sequence < given_up_)
+				++late_;
+			else
+				++echoed_;
+		}
+
+		finished_ = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	static auto Per(const std::uint64_t datagrams, const std::uint64_t calls) -> double
+	{
+		return calls ? static_cast<double>(datagrams) / static_cast<double>(calls) : 0.0;
+	}
+
+	static auto WouldBlock(void) -> bool
+	{
+		const auto error = LastError();
+		return error == EWOULDBLOCK || error == EAGAIN;
+	}
+
+	SOCKET fd_;
+	Proxy* proxy_;
+	std::size_t size_;
+	std::size_t batch_;
+	std::size_t slot_;
+	// a slot per datagram of a batch, headroom for the proxy's header in front of each
+	std::vector<std::byte> buffer_;
+	std::vector<Datagram> datagrams_;
+
+	std::uint64_t sent_ = 0;
+	std::uint64_t echoed_ = 0;
+	std::uint64_t lost_ = 0;
+	std::uint64_t late_ = 0;
+	std::uint64_t corrupt_ = 0;
+	// echoes of datagrams before this one were given up on already
+	std::uint64_t given_up_ = 0;
+	std::uint64_t send_calls_ = 0;
+	std::uint64_t receive_calls_ = 0;
+
+	std::chrono::steady_clock::time_point started_;
+	std::chrono::steady_clock::time_point sent_at_;
+	std::chrono::steady_clock::time_point finished_;
+};
+
+#endif // !UDP_STREAM_HPP
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <fstream>
+#include <cctype>
 #include <thread>
+#include <future>
 #include <cstddef>
 #include <csignal>
 
@@ -9,7 +12,18 @@ using namespace std::chrono_literals;
 namespace kn = kissnet;
 
 #include "Args/Args.hpp"
-#include "Proxy/Proxy.hpp"
+#include "../../library/source/Proxy/Proxy.hpp"
+#include "../../library/source/Resolver/Resolver.hpp"
+#include "../../library/source/HappyEyeballs/HappyEyeballs.hpp"
+#include "../../library/source/ProxySet/ProxySet.hpp"
+#include "../../library/source/Tunnels/Tunnels.hpp"
+#include "Echo/Echo.hpp"
+#include "Report/Report.hpp"
+#include "Pipeline/Pipeline.hpp"
+#include "Batch/Batch.hpp"
+#include "Mapping/Mapping.hpp"
+#include "Stream/Stream.hpp"
+#include "UdpStream/UdpStream.hpp"
 
 auto main(const int argc, char* argv[]) -> int
 {
@@ -21,6 +35,19 @@ auto main(const int argc, char* argv[]) -> int
 	//Configuration (by default)
 	kn::port_t port = 1337;
 	std::string hostname{ "127.0.0.1" };
+	auto timeout = std::chrono::milliseconds(1000);
+	auto connect_timeout = std::chrono::milliseconds(5000);
+	auto output = Output::kText;
+	auto framing = Framing::kRaw;
+	std::size_t window = 1;
+	std::uint64_t stream = 0;
+	std::size_t chunk = 65536;
+	std::uint64_t udp = 0;
+	std::size_t udp_size = 1024;
+	std::size_t udp_batch = 32;
+	auto batch_format = BatchFormat::kLines;
+	double rate = 0.0;
+	std::size_t proxy_spare = 0;
 
 	if (!args->Hostname().empty())
 	{
@@ -34,39 +61,402 @@ auto main(const int argc, char* argv[]) -> int
 			const auto p = std::stoi(args->Port(), nullptr, 10);
 			port = kn::port_t(p);
 		}
+
+		if (!args->Timeout().empty())
+		{
+			timeout = std::chrono::milliseconds(std::stoul(args->Timeout(), nullptr, 10));
+		}
+
+		if (!args->ConnectTimeout().empty())
+		{
+			connect_timeout = std::chrono::milliseconds(std::stoul(args->ConnectTimeout(), nullptr, 10));
+		}
+
+		if (!args->Window().empty())
+		{
+			window = std::stoul(args->Window(), nullptr, 10);
+		}
+
+		if (!args->Stream().empty())
+		{
+			std::size_t end = 0;
+			stream = std::stoull(args->Stream(), &end, 10);
+			switch (end < args->Stream().size() ? std::tolower(args->Stream()[end]) : 0) {
+			case 'g': stream <<= 10; [[fallthrough]];
+			case 'm': stream <<= 10; [[fallthrough]];
+			case 'k': stream <<= 10; break;
+			default: break;
+			}
+		}
+
+		if (!args->Chunk().empty())
+		{
+			chunk = std::stoul(args->Chunk(), nullptr, 10);
+		}
+
+		if (!args->Udp().empty())
+		{
+			std::size_t end = 0;
+			udp = std::stoull(args->Udp(), &end, 10);
+			switch (end < args->Udp().size() ? std::tolower(args->Udp()[end]) : 0) {
+			case 'm': udp *= 1000; [[fallthrough]];
+			case 'k': udp *= 1000; break;
+			default: break;
+			}
+		}
+
+		if (!args->UdpSize().empty())
+		{
+			udp_size = std::stoul(args->UdpSize(), nullptr, 10);
+		}
+
+		if (!args->UdpBatch().empty())
+		{
+			udp_batch = std::stoul(args->UdpBatch(), nullptr, 10);
+		}
+
+		if (!args->Rate().empty())
+		{
+			rate = std::stod(args->Rate());
+		}
+
+		if (!args->ProxySpare().empty())
+		{
+			proxy_spare = std::stoul(args->ProxySpare(), nullptr, 10);
+		}
 	}
 	catch (const std::exception& e) {
 		std::cerr << e.what() << '\n';
-		std::cerr << "Wrong port variable" << '\n';
+		std::cerr << "Wrong port, timeout, connect timeout, window, stream, chunk, udp, rate or proxy spare variable" << '\n';
 		std::exit(EXIT_FAILURE);
 	}
 
+	if (args->Framing() == "line")
+	{
+		framing = Framing::kLine;
+	}
+	else if (args->Framing() == "length")
+	{
+		framing = Framing::kLength;
+	}
+	else if (!args->Framing().empty() && args->Framing() != "raw")
+	{
+		std::cerr << "Unknown framing " << args->Framing() << ", use raw, line or length" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
 
-	/// SOCKS5 Proxy Example
-	if (proxy->Initialize("127.0.0.1", "1488",
-		"127.0.0.1", 1337) &&
-		proxy->Connect(Protocol::kSocks5)) {
-		std::cout << "Connected to proxy!" << '\n';
+	// a raw echo of a stream can't be told apart from its decoration
+	if ((stream || !args->StreamFile().empty()) && framing == Framing::kRaw && (!args->Prefix().empty() || !args->Suffix().empty()))
+	{
+		std::cerr << "Streaming with =prefix/=suffix needs =framing length" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
 
-		auto hello_world = "Hello World!";
-		auto* const byte = reinterpret_cast<const std::byte*>(hello_world);
-		auto const length = strlen(hello_world);
+	if ((stream || !args->StreamFile().empty()) && framing == Framing::kLine)
+	{
+		std::cerr << "Streams are binary, use =framing raw or length" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (udp && (udp_size < sizeof(std::uint64_t) || udp_size > 65507 - Datagrams::kHeadroom || !udp_batch || udp_batch > Datagrams::kBatch))
+	{
+		std::cerr << "Datagrams must be between " << sizeof(std::uint64_t) << " and " << 65507 - Datagrams::kHeadroom
+			<< " bytes and go out 1 to " << Datagrams::kBatch << " at a time" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!chunk || chunk + args->Prefix().size() + args->Suffix().size() > Framer::kMaxMessage)
+	{
+		std::cerr << "Chunk must be between 1 and " << Framer::kMaxMessage << " bytes including =prefix and =suffix" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	// raw echoes can't be told apart once more than one is in flight
+	if (window > 1 && framing == Framing::kRaw)
+	{
+		std::cerr << "Pipelining needs =framing line or length, same as the server" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
 
-		auto [size, status] = proxy->send(byte, length);
-		if (status == kn::socket_status::valid) {
-			std::cout << "Hello world was sent! Size: " << size << '\n';
+	if (args->BatchFormat() == "length")
+	{
+		batch_format = BatchFormat::kLength;
+	}
+	else if (!args->BatchFormat().empty() && args->BatchFormat() != "lines")
+	{
+		std::cerr << "Unknown batch format " << args->BatchFormat() << ", use lines or length" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	// replayed messages are matched with their echoes by the framing, same as a window > 1
+	if (!args->Batch().empty() && framing == Framing::kRaw)
+	{
+		std::cerr << "Batch replay needs =framing line or length, same as the server" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (rate < 0.0)
+	{
+		std::cerr << "Rate can't be negative" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (args->Output() == "json")
+	{
+		output = Output::kJson;
+	}
+	else if (args->Output() == "csv")
+	{
+		output = Output::kCsv;
+	}
+	else if (!args->Output().empty() && args->Output() != "text")
+	{
+		std::cerr << "Unknown output format " << args->Output() << ", use text, json or csv" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+
+	if (!args->Hosts().empty() && !Resolver::Shared().Hosts(args->Hosts()))
+	{
+		std::exit(EXIT_FAILURE);
+	}
+
+	const auto protocol_of = [](const std::string& name, Protocol& protocol) -> bool {
+		if (name == "socks4")
+			protocol = Protocol::kSocks4;
+		else if (name == "http")
+			protocol = Protocol::kHttp;
+		else if (name.empty() || name == "socks5")
+			protocol = Protocol::kSocks5;
+		else
+			return false;
+		return true;
+	};
+
+	auto proxy_protocol = Protocol::kSocks5;
+	if (!protocol_of(args->ProxyProtocol(), proxy_protocol))
+	{
+		std::cerr << "Unknown proxy protocol " << args->ProxyProtocol() << ", use socks5, socks4 or http" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	// =proxy is a chain of [protocol://][user:password@]host:port hops separated by commas, =proxy-set
+	// a list of them; what a hop leaves out comes from =proxy-protocol, =proxy-username and =proxy-password
+	const auto parse_hops = [&](const std::string& list) -> std::vector<ProxyOptions> {
+		std::vector<ProxyOptions> hops;
+		for (std::size_t from = 0; !list.empty() && from <= list.size();) {
+			const auto comma = std::min(list.find(',', from), list.size());
+			auto text = list.substr(from, comma - from);
+			from = comma + 1;
+
+			ProxyOptions hop{ {}, {}, proxy_protocol, args->ProxyUsername(), args->ProxyPassword(), !args->ProxyStrict() };
+
+			if (const auto scheme = text.find("://"); scheme != std::string::npos) {
+				if (!protocol_of(text.substr(0, scheme), hop.protocol)) {
+					std::cerr << "Unknown proxy protocol " << text.substr(0, scheme) << ", use socks5, socks4 or http" << '\n';
+					std::exit(EXIT_FAILURE);
+				}
+				text.erase(0, scheme + 3);
+			}
+
+			if (const auto at = text.rfind('@'); at != std::string::npos) {
+				const auto credentials = text.substr(0, at);
+				const auto split = credentials.find(':');
+				hop.username = credentials.substr(0, split);
+				hop.password = split == std::string::npos ? "" : credentials.substr(split + 1);
+				text.erase(0, at + 1);
+			}
+
+			const auto colon = text.rfind(':');
+			if (colon == std::string::npos || colon == 0)
+			{
+				std::cerr << "Proxies must be given as host:port" << '\n';
+				std::exit(EXIT_FAILURE);
+			}
+
+			// [::1]:1080 for IPv6 proxies
+			hop.host = text.front() == '[' && text[colon - 1] == ']' ? text.substr(1, colon - 2) : text.substr(0, colon);
+			hop.port = text.substr(colon + 1);
+			hops.push_back(std::move(hop));
+		}
+		return hops;
+	};
+
+	const auto chain = parse_hops(args->Proxy());
+	const auto proxy_set = parse_hops(args->ProxySet());
+
+	if (!chain.empty() && !proxy_set.empty())
+	{
+		std::cerr << "Use either =proxy or =proxy-set" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (udp) {
+		SOCKET fd = INVALID_SOCKET;
+
+		if (!proxy_set.empty() || chain.size() > 1) {
+			std::cerr << "Datagrams go through a single SOCKS5 =proxy" << '\n';
+			std::exit(EXIT_FAILURE);
+		}
+		else if (!chain.empty()) {
+			// UDP ASSOCIATE, the proxy's TCP connection holds the relay open until we're done
+			const auto& first = chain.front();
+			const auto start = std::chrono::steady_clock::now();
+			if (!proxy->Initialize(std::string(first.host), std::string(first.port), std::string(hostname), port,
+				std::string(first.username), std::string(first.password)) || !proxy->Associate(first.protocol)) {
+				std::cout << "Error setting up a UDP relay to " << hostname << ':' << port << " through proxy " << args->Proxy() << '\n';
+				std::exit(EXIT_FAILURE);
+			}
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+			std::cout << "UDP relay through proxy " << args->Proxy() << " set up in " << elapsed.count() << "us" << '\n';
+			fd = proxy->Udp();
 		}
 		else {
-			std::cout << "Something went wrong with proxy send" << '\n';
+			const auto resolution = Resolver::Shared().Resolve(hostname).get();
+			if (resolution.addresses.empty()) {
+				std::cout << "Can't resolve " << hostname << ": " << resolution.error << '\n';
+				std::exit(EXIT_FAILURE);
+			}
+
+			auto address = resolution.addresses.front();
+			if (address.Family() == AF_INET6)
+				reinterpret_cast<sockaddr_in6*>(&address.storage)->sin6_port = htons(port);
+			else
+				reinterpret_cast<sockaddr_in*>(&address.storage)->sin_port = htons(port);
+
+			fd = ::socket(address.Family(), SOCK_DGRAM, IPPROTO_UDP);
+			if (fd == INVALID_SOCKET || ::connect(fd, reinterpret_cast<const sockaddr*>(&address.storage), address.length) != 0) {
+				std::cout << "Can't open a UDP socket to " << hostname << ':' << port << ", error " << LastError() << '\n';
+				std::exit(EXIT_FAILURE);
+			}
+			SetNonBlocking(fd);
 		}
+
+		UdpStream datagrams(fd, chain.empty() ? nullptr : proxy.get(), udp_size, udp_batch);
+		const auto verified = datagrams.Run(udp, timeout);
+		datagrams.Report(std::cout);
+
+		if (chain.empty())
+			closesocket(fd);
+		return verified ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
 
-	kn::tcp_socket sv_sock({ hostname, port });
+	kn::tcp_socket sv_sock;
+	std::unique_ptr<Tunnels> tunnels;
 
-	if (!sv_sock.connect()) {
-		std::cout << "Error connecting to server at  " << hostname << ':' << port << '\n';
-		std::this_thread::sleep_for(2s);
-		std::exit(EXIT_FAILURE);
+	if (!chain.empty() && proxy_spare) {
+		// the first tunnel is waited for, the spares come up in the background
+		tunnels = std::make_unique<Tunnels>(chain, proxy_spare, connect_timeout);
+
+		const auto start = std::chrono::steady_clock::now();
+		std::string error;
+		sv_sock = tunnels->Take(hostname, port, connect_timeout, error);
+		if (!sv_sock.is_valid()) {
+			std::cout << "Error connecting to server at " << hostname << ':' << port << " through proxy " << args->Proxy() << ": " << error << '\n';
+			std::this_thread::sleep_for(2s);
+			std::exit(EXIT_FAILURE);
+		}
+
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+		std::cout << "Tunnel through proxy " << args->Proxy() << " set up in " << elapsed.count() << "us, "
+			<< proxy_spare << " more kept ready" << '\n';
+	}
+	else if (!proxy_set.empty()) {
+		// the better of two proxies, and a second one raced if the first is slow
+		Loop loop;
+		ProxySet set(loop, proxy_set);
+		loop.Start();
+
+		std::promise<std::string> connected;
+		const auto start = std::chrono::steady_clock::now();
+		loop.Post([&] {
+			set.Dial(hostname, port, connect_timeout, [&](kissnet::tcp_socket&& socket, const std::string& error, const ProxyOptions* via) {
+				sv_sock = std::move(socket);
+				connected.set_value(via ? via->host + ':' + via->port : error);
+				});
+			});
+
+		const auto through = connected.get_future().get();
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+		loop.Post([&] {
+			if (set.Hedged())
+				std::cout << "The first proxy failed or took longer than " << set.HedgeDelay().count() << "ms, a second one was raced" << '\n';
+			set.Close();
+			});
+		loop.Stop();
+
+		if (!sv_sock.is_valid()) {
+			std::cout << "Error connecting to server at " << hostname << ':' << port << " through the proxy set: " << through << '\n';
+			std::this_thread::sleep_for(2s);
+			std::exit(EXIT_FAILURE);
+		}
+
+		std::cout << "Tunnel through proxy " << through << " of " << proxy_set.size() << " set up in " << elapsed.count() << "us" << '\n';
+		sv_sock.set_non_blocking(false);
+	}
+	else if (!chain.empty()) {
+		// the handshakes are timed on their own, pipelined SOCKS5 saves one round trip to a proxy
+		proxy->Pipelined(!args->ProxyStrict());
+		const auto start = std::chrono::steady_clock::now();
+
+		auto& first = chain.front();
+		auto initialized = proxy->Initialize(std::string(first.host), std::string(first.port), std::string(hostname), port,
+			std::string(first.username), std::string(first.password));
+
+		try
+		{
+			for (std::size_t i = 1; i < chain.size(); ++i)
+				proxy->Via(chain[i].host, std::uint16_t(std::stoi(chain[i].port, nullptr, 10)), chain[i].protocol, chain[i].username, chain[i].password);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			initialized = false;
+		}
+
+		if (!initialized || !proxy->Connect(first.protocol)) {
+			std::cout << "Error connecting to server at " << hostname << ':' << port << " through proxy " << args->Proxy() << '\n';
+			std::this_thread::sleep_for(2s);
+			std::exit(EXIT_FAILURE);
+		}
+
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+		std::cout << "Tunnel through proxy " << args->Proxy() << " set up in " << elapsed.count() << "us"
+			<< (chain.size() == 1 && first.protocol == Protocol::kSocks5 ? (proxy->Pipelined() ? " (pipelined)" : " (strict)") : "") << '\n';
+
+		// the handshake of every hop, to find the slow link
+		if (chain.size() > 1) {
+			for (std::size_t i = 0; i < proxy->Latencies().size(); ++i)
+				std::cout << "  hop " << i + 1 << ' ' << chain[i].host << ':' << chain[i].port << " handshake " << proxy->Latencies()[i].count() << "us" << '\n';
+		}
+
+		sv_sock = std::move(*proxy->get());
+	}
+	else {
+		// every address of the name, IPv4 and IPv6 raced; a dead one costs 250ms instead of a connect timeout
+		const auto fastopen = args->FastOpen();
+		std::string error;
+		sv_sock = HappyEyeballs::Connect(hostname, port, connect_timeout, error, [fastopen](SOCKET fd) {
+			// with TCP_FASTOPEN_CONNECT connect() returns right away and the SYN leaves with the first send,
+			// so the first address wins without a race
+			if (!fastopen)
+				return;
+#ifdef TCP_FASTOPEN_CONNECT
+			const int enable = 1;
+			if (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, reinterpret_cast<const char*>(&enable), sizeof enable) != 0)
+				std::cerr << "Can't enable TCP Fast Open, using a regular handshake" << '\n';
+#else
+			(void)fd;
+			std::cerr << "TCP Fast Open isn't supported on this platform, using a regular handshake" << '\n';
+#endif
+			});
+
+		if (!sv_sock.is_valid()) {
+			std::cout << "Error connecting to server at  " << hostname << ':' << port << ": " << error << '\n';
+			std::this_thread::sleep_for(2s);
+			std::exit(EXIT_FAILURE);
+		}
 	}
 
 	sv_sock.set_non_blocking(true);
@@ -77,60 +467,166 @@ auto main(const int argc, char* argv[]) -> int
 		std::exit(0);
 		});
 
-	std::cout << "Connected to " << hostname << " on port " << port << '\n';
-
-	//Read user data into temp buffer
-	std::string message;
-	uint64_t req_id = 0;
+	std::cout << "Connected to " << hostname << " (" << sv_sock.get_bind_loc().address << ") on port " << port << '\n';
 
-	while (true) {
-		std::cout << ">> ";
-		std::getline(std::cin, message);
+	if (stream || !args->StreamFile().empty()) {
+		Mapping mapping;
+		std::string generated;
+		std::string_view source;
 
-		if (!message.compare("quit") ||
-			message.empty()) {
-			break;
+		if (!args->StreamFile().empty()) {
+			if (!mapping.Open(args->StreamFile()))
+				return EXIT_FAILURE;
+			source = mapping.View();
+		}
+		else {
+			// one pseudo-random megabyte, repeated; nothing along the way gets to compress it
+			generated.resize(static_cast<std::size_t>(std::min<std::uint64_t>(stream, 1 << 20)));
+			std::uint64_t state = 0x9E3779B97F4A7C15ull;
+			for (auto& byte : generated) {
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+				byte = static_cast<char>(state);
+			}
+			source = generated;
 		}
 
-		auto start = std::chrono::high_resolution_clock::now();
+		Stream streamer(sv_sock, framing, args->Prefix(), args->Suffix(), chunk);
+		const auto verified = streamer.Run(source, stream ? stream : source.size(), timeout);
+		streamer.Report(std::cout);
+		return verified ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 
-		auto* const data_byte = reinterpret_cast<const std::byte*>(message.c_str());
-		const auto data_length = message.length();
+	Echo echo(sv_sock);
 
-		// Send the data that buffer contains
-		auto [send_size, send_status] = sv_sock.send(data_byte, data_length);
-		if (!send_size || send_status != kissnet::socket_status::valid)
-		{
-			std::cout << "Cannot send message to server" << '\n';
-			std::raise(SIGINT);
-		}
+	Report report;
 
-		std::this_thread::sleep_for(1s);
+	if (!args->Batch().empty()) {
+		Batch batch;
+		if (!batch.Open(args->Batch(), batch_format))
+			return EXIT_FAILURE;
 
-		const auto bytes_available = sv_sock.bytes_available();
-		std::cout << "Bytes available: " << bytes_available << '\n';
+		Pipeline pipeline(sv_sock, framing, window, report);
+		pipeline.Verify(args->Prefix(), args->Suffix());
+		pipeline.Pace(rate);
 
-		kn::buffer<4096> buffer;
+		auto broken = false;
+		pipeline.Run([&](std::string_view& message) {
+			if (!batch.Next(message))
+				return false;
 
-		//Get the data, and the lengh of data
-		auto [recv_size, recv_status] = sv_sock.recv(buffer);
-		if (!recv_size || recv_status != kissnet::socket_status::valid)
-		{
-			std::cout << "Cannot recv message from server" << '\n';
-			std::raise(SIGINT);
-		}
+			// a line framed message can't carry the delimiter, a length record could
+			if ((framing == Framing::kLine && message.find('\n') != std::string_view::npos) || message.size() > Framer::kMaxMessage) {
+				std::cerr << "Batch record #" << batch.Records() - 1 << " can't be sent with =framing " << args->Framing() << '\n';
+				broken = true;
+				return false;
+			}
+			return true;
+			}, timeout);
+
+		std::cout << "replayed " << batch.Records() - (broken ? 1 : 0) << " message(s) from " << args->Batch() << '\n';
+	}
+	else if (framing != Framing::kRaw) {
+		// framed echoes: every line of stdin is one message, up to window of them in flight
+		Pipeline pipeline(sv_sock, framing, window, report);
+		pipeline.Verify(args->Prefix(), args->Suffix());
+		pipeline.Run(std::cin, timeout);
+	}
+	else {
+		//Read user data into temp buffer
+		std::string message;
+		uint64_t req_id = 0;
+		auto resend = false;
+
+		// a lost tunnel is swapped for a spare one and the message sent again, no setup on the way
+		const auto spare = [&]() -> bool {
+			if (!tunnels)
+				return false;
+
+			std::string error;
+			auto tunnel = tunnels->Take(hostname, port, connect_timeout, error);
+			if (!tunnel.is_valid()) {
+				std::cout << "No spare tunnel: " << error << '\n';
+				return false;
+			}
+
+			tunnel.set_non_blocking(true);
+			sv_sock = std::move(tunnel);
+			std::cout << "Connection lost, going on over a spare tunnel" << '\n';
+			return true;
+		};
+
+		while (true) {
+			if (!resend) {
+				std::cout << ">> ";
+				std::getline(std::cin, message);
+			}
+			resend = false;
+
+			if (!message.compare("quit") ||
+				message.empty()) {
+				break;
+			}
 
-		if (recv_size < buffer.size())
-			buffer[recv_size] = std::byte{ '\0' };
+			const auto start = std::chrono::steady_clock::now();
+			report.Begin(start);
 
-		std::string recieved(reinterpret_cast<const char*>(buffer.data()), recv_size);
+			// Send the data that buffer contains
+			if (const auto send_status = echo.Send(message, timeout); send_status.value != kissnet::socket_status::valid)
+			{
+				if ((resend = spare()))
+					continue;
+				std::cout << "Cannot send message to server" << '\n';
+				break;
+			}
 
-		auto now = std::chrono::high_resolution_clock::now();
-		std::chrono::duration<double> elapsed = now - start;
-		printf("handled request #%llu. handled %2.2f r/q in %2.2fs.\n\r\nData: %s\r\nSize: %i\r\n", req_id,
-			(float)((double)req_id / elapsed.count()), (float)elapsed.count(), recieved.c_str(), recv_size);
+			//Wait for the whole echo: payload plus the server's decoration
+			std::string recieved;
+			const auto expected = args->Prefix().size() + message.size() + args->Suffix().size();
+			const auto recv_status = echo.Receive(recieved, expected, timeout);
+			if (recv_status.value == kissnet::socket_status::timed_out)
+			{
+				std::cout << "Timed out waiting for the echo, got " << recieved.size() << " of " << expected << " bytes" << '\n';
+				report.Timeout();
+				continue;
+			}
+			else if (recv_status.value != kissnet::socket_status::valid)
+			{
+				if ((resend = spare()))
+					continue;
+				std::cout << "Cannot recv message from server" << '\n';
+				break;
+			}
 
-		req_id++;
+			const auto elapsed = std::chrono::steady_clock::now() - start;
+			const auto kernel_rtt = echo.KernelRtt();
+			report.Request(elapsed, kernel_rtt, message.size() + recieved.size());
+
+			std::cout << "handled request #" << req_id << " in "
+				<< std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us";
+			if (kernel_rtt)
+				std::cout << " (kernel rtt " << kernel_rtt->count() << "us)";
+			std::cout << '\n' << "Data: " << recieved << '\n' << "Size: " << recieved.size() << '\n';
+
+			req_id++;
+		}
+	}
+
+	report.Print(std::cout, Output::kText);
+
+	if (output != Output::kText) {
+		if (args->OutputFile().empty()) {
+			report.Print(std::cout, output);
+		}
+		else {
+			std::ofstream file(args->OutputFile());
+			if (!file) {
+				std::cerr << "Can't write the summary to " << args->OutputFile() << '\n';
+				return EXIT_FAILURE;
+			}
+			report.Print(file, output);
+		}
 	}
 
 	return EXIT_SUCCESS;
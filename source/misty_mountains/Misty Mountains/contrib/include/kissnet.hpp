@@ -303,6 +303,7 @@ namespace kissnet
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 
 using ioctl_setting = int;
 using buffsize_t = size_t;
@@ -721,6 +722,9 @@ namespace kissnet
 		sockaddr_storage socket_input = {};
 		socklen_t socket_input_socklen{};
 
+		///Error code of the last failed connect, 0 if there was none
+		int connect_error = 0;
+
 	public:
 		///Construct an invalid socket
 		socket() :
@@ -747,6 +751,7 @@ namespace kissnet
 			socket_input = std::move(other.socket_input);
 			socket_input_socklen = std::move(other.socket_input_socklen);
 			getaddrinfo_results = std::move(other.getaddrinfo_results);
+			connect_error = other.connect_error;
 
 #ifdef KISSNET_USE_OPENSSL
 			pSSL = other.pSSL;
@@ -769,6 +774,9 @@ namespace kissnet
 				if (!(sock < 0) || sock != INVALID_SOCKET)
 					closesocket(sock);
 
+				if (getaddrinfo_results)
+					freeaddrinfo(getaddrinfo_results);
+
 				KISSNET_OS_SPECIFIC_PAYLOAD_NAME = std::move(other.KISSNET_OS_SPECIFIC_PAYLOAD_NAME);
 				bind_loc = std::move(other.bind_loc);
 				sock = std::move(other.sock);
@@ -776,6 +784,7 @@ namespace kissnet
 				socket_input = std::move(other.socket_input);
 				socket_input_socklen = std::move(other.socket_input_socklen);
 				getaddrinfo_results = std::move(other.getaddrinfo_results);
+				connect_error = other.connect_error;
 
 #ifdef KISSNET_USE_OPENSSL
 				pSSL = other.pSSL;
@@ -914,16 +923,18 @@ namespace kissnet
 		{
 			if constexpr (sock_proto == protocol::tcp) //only TCP is a connected protocol
 			{
+				//sizeof(SOCKADDR) would cut an IPv6 address short
+				memcpy(&socket_output, getaddrinfo_results->ai_addr, getaddrinfo_results->ai_addrlen);
 
-				memcpy(&socket_output, getaddrinfo_results->ai_addr, sizeof(SOCKADDR));
-
-				int error = syscall_connect(sock, reinterpret_cast<SOCKADDR*>(&socket_output), sizeof(SOCKADDR));
+				connect_error = 0;
+				int error = syscall_connect(sock, reinterpret_cast<SOCKADDR*>(&socket_output), socklen_t(getaddrinfo_results->ai_addrlen));
 				if (error == SOCKET_ERROR)
 				{
 					const auto error = get_error_code();
 					if (error == EWOULDBLOCK || error == EAGAIN || error == EINPROGRESS)
 						return socket_status::non_blocking_would_have_blocked;
 
+					connect_error = error;
 					return socket_status::errored;
 				}
 				return socket_status::valid;
@@ -931,11 +942,12 @@ namespace kissnet
 #ifdef KISSNET_USE_OPENSSL
 			else if constexpr (sock_proto == protocol::tcp_ssl) //only TCP is a connected protocol
 			{
-				memcpy(&socket_output, getaddrinfo_results->ai_addr, sizeof(SOCKADDR));
+				memcpy(&socket_output, getaddrinfo_results->ai_addr, getaddrinfo_results->ai_addrlen);
 
-				int error = syscall_connect(sock, reinterpret_cast<SOCKADDR*>(&socket_output), sizeof(SOCKADDR));
+				int error = syscall_connect(sock, reinterpret_cast<SOCKADDR*>(&socket_output), socklen_t(getaddrinfo_results->ai_addrlen));
 				if (error == SOCKET_ERROR)
 				{
+					const auto error = get_error_code();
 					if (error == EWOULDBLOCK || error == EAGAIN || error == EINPROGRESS)
 						return socket_status::non_blocking_would_have_blocked;
 
@@ -960,12 +972,90 @@ namespace kissnet
 #endif
 		}
 
+		///(For TCP) connect to the endpoint, giving up after timeout milliseconds instead of waiting for the OS to give up.
+		///Returns timed_out if the connection didn't complete in time. The socket is left in blocking mode
+		socket_status connect(int64_t timeout)
+		{
+			const auto started = connect_async();
+			const auto status = started.value == socket_status::non_blocking_would_have_blocked ? connect_wait(timeout) : started.value;
+
+			set_non_blocking(false);
+			return status;
+		}
+
+		///(For TCP) put the socket in non blocking mode and start connecting to the endpoint. Returns valid if the connection
+		///completed right away, errored if it failed, non_blocking_would_have_blocked while it is in progress: wait for the
+		///socket to become writable (connect_wait(), or any poller with many sockets) and get the outcome from connect_result()
+		socket_status connect_async()
+		{
+			set_non_blocking(true);
+			return connect();
+		}
+
+		///(For TCP) outcome of a connect_async() once the socket became writable: valid, or errored with the reason in get_connect_error()
+		socket_status connect_result()
+		{
+			int error = 0;
+			socklen_t length = sizeof error;
+			if (getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) != 0)
+				error = get_error_code();
+
+			connect_error = error;
+			return error == 0 ? socket_status::valid : socket_status::errored;
+		}
+
+		///(For TCP) wait up to timeout milliseconds for a connect_async() to complete, returns timed_out or connect_result()
+		socket_status connect_wait(int64_t timeout)
+		{
+#ifdef _WIN32
+			//a failed connect shows up in the except set on Windows, and WSAPoll doesn't report it on older versions
+			fd_set fd_write, fd_except;
+			FD_ZERO(&fd_write);
+			FD_SET(sock, &fd_write);
+			FD_ZERO(&fd_except);
+			FD_SET(sock, &fd_except);
+
+			struct timeval tv;
+			tv.tv_sec = static_cast<long>(timeout / 1000);
+			tv.tv_usec = 1000 * static_cast<long>(timeout % 1000);
+
+			const int ret = syscall_select(0, nullptr, &fd_write, &fd_except, &tv);
+#else
+			//poll() rather than select(), the descriptor can be above FD_SETSIZE when many connections are open
+			pollfd fd{};
+			fd.fd = sock;
+			fd.events = POLLOUT;
+
+			int ret;
+			do
+			{
+				ret = ::poll(&fd, 1, static_cast<int>(timeout));
+			} while (ret == -1 && get_error_code() == EINTR);
+#endif
+			if (ret == -1)
+			{
+				connect_error = get_error_code();
+				return socket_status::errored;
+			}
+			if (ret == 0)
+				return socket_status::timed_out;
+
+			return connect_result();
+		}
+
+		///Error code of the last connect that failed (connect(), connect_result(), connect_wait()), 0 if it didn't
+		int get_connect_error() const
+		{
+			return connect_error;
+		}
+
 		///(for TCP= setup socket to listen to connection. Need to be called on binded socket, before being able to accept()
-		void listen()
+		/// \param backlog Maximum length of the pending connections queue. By default SOMAXCONN
+		void listen(int backlog = SOMAXCONN)
 		{
 			if constexpr (sock_proto == protocol::tcp)
 			{
-				if (syscall_listen(sock, SOMAXCONN) == SOCKET_ERROR)
+				if (syscall_listen(sock, backlog) == SOCKET_ERROR)
 				{
 					kissnet_fatal_error("listen failed\n");
 				}
@@ -1240,6 +1330,20 @@ namespace kissnet
 			return size > 0 ? size : 0;
 		}
 
+		///Return the underlying operating system socket handle (file descriptor, SOCKET...)
+		SOCKET get_handle() const
+		{
+			return sock;
+		}
+
+		///Give up ownership of the handle, the socket is left invalid and won't close it
+		SOCKET release()
+		{
+			const auto handle = sock;
+			sock = INVALID_SOCKET;
+			return handle;
+		}
+
 		///Return the protocol used by this socket
 		static protocol get_protocol()
 		{
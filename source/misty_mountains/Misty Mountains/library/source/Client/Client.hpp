@@ -0,0 +1,86 @@
+#ifndef CLIENT_HPP
+#define CLIENT_HPP
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "../Connection/Connection.hpp"
+#include "../Loop/Loop.hpp"
+#include "../Options/Options.hpp"
+#include "../Pool/Pool.hpp"
+
+/// <summary>
+/// Asynchronous echo client: calls from any thread are queued to one event loop thread
+/// that owns a pool of connections, so any number of calls can be outstanding without
+/// a thread per call.
+///
+///     Options options;
+///     options.framing = Framing::kLine;
+///     options.window = 16;
+///     Client client(options);
+///     auto echo = client.Echo("hello");
+///     client.Echo("world", [](Result result) { ... });
+///     if (const auto result = echo.get(); result) ...
+/// </summary>
+class Client
+{
+public:
+	explicit Client(Options options) :
+		options_(std::move(options)), pool_(loop_, dialer_, options_)
+	{
+		loop_.Start();
+		dialer_.Start();
+		loop_.Post([this] { pool_.Start(); });
+	}
+
+	/// <summary>
+	/// Calls still queued or in flight complete with an error
+	/// </summary>
+	~Client(void)
+	{
+		pool_.Closing();
+		dialer_.Stop();
+		loop_.Post([this] { pool_.Close(); });
+		loop_.Stop();
+	}
+
+	Client(const Client&) = delete;
+	Client& operator=(const Client&) = delete;
+
+	/// <summary>
+	/// Sends message and calls done with the outcome. done runs on the loop thread and must not block
+	/// </summary>
+	auto Echo(std::string message, std::function<void(Result)> done) -> void
+	{
+		loop_.Post([this, call = Call{ std::move(message), std::move(done), {} }]() mutable {
+			pool_.Submit(std::move(call));
+			});
+	}
+
+	/// <summary>
+	/// Sends message, the future is ready once the echo arrived or the call failed
+	/// </summary>
+	auto Echo(std::string message) -> std::future<Result>
+	{
+		auto promise = std::make_shared<std::promise<Result>>();
+		auto future = promise->get_future();
+
+		this->Echo(std::move(message), [promise](Result result) {
+			promise->set_value(std::move(result));
+			});
+
+		return future;
+	}
+
+private:
+	Options options_;
+	Loop loop_;
+	Loop dialer_;
+	Pool pool_;
+};
+
+#endif // !CLIENT_HPP
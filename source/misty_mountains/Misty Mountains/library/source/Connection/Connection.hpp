@@ -0,0 +1,267 @@
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#ifdef _WIN32
+#include <mstcpip.h>
+#endif
+
+#include "../Framing/Framing.hpp"
+#include "../Options/Options.hpp"
+
+/// <summary>
+/// Outcome of one echo call, an empty error means the echo arrived and matched
+/// </summary>
+struct Result
+{
+	std::string echo;
+	std::chrono::nanoseconds rtt{};
+	std::string error;
+
+	explicit operator bool(void) const
+	{
+		return error.empty();
+	}
+};
+
+/// <summary>
+/// Echo call waiting for a connection or for its echo
+/// </summary>
+struct Call
+{
+	std::string message;
+	std::function<void(Result)> done;
+	std::chrono::steady_clock::time_point queued;
+};
+
+/// <summary>
+/// One pooled connection: frames calls into its outbox and completes them in order as echoes arrive.
+/// Lives on the loop thread, the pool decides when it is dialed and what is sent on it
+/// </summary>
+class Connection
+{
+public:
+	explicit Connection(const Options& options) :
+		options_(options), window_(options.framing == Framing::kRaw || !options.window ? 1 : options.window)
+	{
+	}
+
+	Connection(const Connection&) = delete;
+	Connection& operator=(const Connection&) = delete;
+
+	/// <summary>
+	/// Takes over a connected socket
+	/// </summary>
+	auto Attach(kissnet::tcp_socket&& socket) -> void
+	{
+		socket_ = std::move(socket);
+		socket_.set_non_blocking(true);
+		socket_.set_tcp_no_delay(true);
+		KeepAlive(socket_.get_handle(), options_.keepalive);
+		open_ = true;
+	}
+
+	auto Open(void) const -> bool
+	{
+		return open_;
+	}
+
+	auto Handle(void) const -> SOCKET
+	{
+		return socket_.get_handle();
+	}
+
+	/// <summary>
+	/// Calls that can still be sent before the window is full
+	/// </summary>
+	auto Room(void) const -> std::size_t
+	{
+		return open_ && in_flight_.size() < window_ ? window_ - in_flight_.size() : 0;
+	}
+
+	auto InFlight(void) const -> std::size_t
+	{
+		return in_flight_.size();
+	}
+
+	/// <summary>
+	/// Send time of the oldest call still waiting for its echo
+	/// </summary>
+	auto Oldest(void) const -> std::optional<std::chrono::steady_clock::time_point>
+	{
+		if (in_flight_.empty())
+			return std::nullopt;
+
+		return in_flight_.front().sent;
+	}
+
+	/// <summary>
+	/// True while framed bytes are waiting for the socket to become writable
+	/// </summary>
+	auto Writing(void) const -> bool
+	{
+		return sent_ < outbox_.size();
+	}
+
+	auto Send(Call&& call) -> void
+	{
+		Framer::Encode(outbox_, options_.framing, call.message);
+		in_flight_.push_back({ std::move(call), std::chrono::steady_clock::now() });
+	}
+
+	auto Flush(void) -> bool
+	{
+		while (sent_ < outbox_.size()) {
+			auto [size, status] = socket_.send(reinterpret_cast<const std::byte*>(outbox_.data()) + sent_, outbox_.size() - sent_);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				break;
+			if (!status)
+				return false;
+
+			sent_ += size;
+		}
+
+		if (sent_ == outbox_.size()) {
+			outbox_.clear();
+			sent_ = 0;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Reads whatever arrived and completes the calls whose echo is in.
+	/// False if the server hung up or sent something nobody asked for
+	/// </summary>
+	auto Read(void) -> bool
+	{
+		for (;;) {
+			auto [size, status] = socket_.recv(buffer_);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				break;
+			if (!status || status.value == kissnet::socket_status::cleanly_disconnected)
+				return false;
+
+			inbox_.append(reinterpret_cast<const char*>(buffer_.data()), size);
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+
+		// raw echoes have no frame, the one call in flight knows how long its echo is
+		if (options_.framing == Framing::kRaw) {
+			if (in_flight_.empty())
+				return inbox_.empty();
+
+			const auto expected = options_.prefix.size() + in_flight_.front().call.message.size() + options_.suffix.size();
+			if (inbox_.size() < expected)
+				return true;
+			if (inbox_.size() > expected)
+				return false;
+
+			this->Complete(inbox_, now);
+			inbox_.clear();
+			return true;
+		}
+
+		auto unexpected = false;
+		const auto framed = Framer::Extract(inbox_, options_.framing, [&](const std::string_view echo) {
+			if (in_flight_.empty()) {
+				unexpected = true;
+				return;
+			}
+
+			this->Complete(echo, now);
+			});
+
+		return framed && !unexpected;
+	}
+
+	/// <summary>
+	/// Completes every call in flight with error and closes the socket
+	/// </summary>
+	auto Fail(const std::string& error) -> void
+	{
+		auto failed = std::move(in_flight_);
+		in_flight_.clear();
+		outbox_.clear();
+		inbox_.clear();
+		sent_ = 0;
+
+		if (open_)
+			socket_.close();
+		open_ = false;
+
+		for (auto& request : failed) {
+			Result result;
+			result.error = error;
+			request.call.done(std::move(result));
+		}
+	}
+
+private:
+	struct Sent
+	{
+		Call call;
+		std::chrono::steady_clock::time_point sent;
+	};
+
+	auto Complete(const std::string_view echo, const std::chrono::steady_clock::time_point now) -> void
+	{
+		auto request = std::move(in_flight_.front());
+		in_flight_.pop_front();
+
+		Result result;
+		result.echo = std::string(echo);
+		result.rtt = now - request.sent;
+
+		const auto& message = request.call.message;
+		if (echo.size() != options_.prefix.size() + message.size() + options_.suffix.size() ||
+			echo.substr(0, options_.prefix.size()) != options_.prefix ||
+			echo.substr(options_.prefix.size(), message.size()) != message ||
+			echo.substr(options_.prefix.size() + message.size()) != options_.suffix)
+			result.error = "echo doesn't match prefix + message + suffix";
+
+		request.call.done(std::move(result));
+	}
+
+	static auto KeepAlive(SOCKET fd, const std::chrono::seconds idle) -> void
+	{
+		const int enable = 1;
+		setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&enable), sizeof enable);
+		if (!idle.count())
+			return;
+
+#if defined(_WIN32)
+		tcp_keepalive values{ 1, static_cast<ULONG>(idle.count() * 1000), 1000 };
+		DWORD returned = 0;
+		WSAIoctl(fd, SIO_KEEPALIVE_VALS, &values, sizeof values, nullptr, 0, &returned, nullptr, nullptr);
+#elif defined(TCP_KEEPIDLE)
+		const int seconds = static_cast<int>(idle.count());
+		setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &seconds, sizeof seconds);
+#endif
+	}
+
+	const Options& options_;
+	std::size_t window_;
+
+	kissnet::tcp_socket socket_;
+	bool open_ = false;
+
+	std::deque<Sent> in_flight_;
+	std::string outbox_;
+	std::size_t sent_ = 0;
+	std::string inbox_;
+	kissnet::buffer<4096> buffer_;
+};
+
+#endif // !CONNECTION_HPP
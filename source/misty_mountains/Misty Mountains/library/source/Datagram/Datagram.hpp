@@ -0,0 +1,268 @@
+#ifndef DATAGRAM_HPP
+#define DATAGRAM_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#include "../Reactor/Reactor.hpp"
+
+/// <summary>
+/// One datagram of a batch: size bytes at data, to or from peer. On a connected socket
+/// the peer is left out (length 0)
+/// </summary>
+struct Datagram
+{
+	std::byte* data = nullptr;
+	std::size_t size = 0;
+	sockaddr_storage peer{};
+	socklen_t length = 0;
+};
+
+/// <summary>
+/// Where a datagram that came through a SOCKS5 relay goes (or came from): an address with
+/// its port, or a name (pointing into the datagram) for the relay to resolve
+/// </summary>
+struct DatagramTarget
+{
+	sockaddr_storage address{};
+	socklen_t length = 0;
+	std::string_view name;
+	std::uint16_t port = 0;
+};
+
+/// <summary>
+/// SOCKS5 UDP relay framing (RFC 1928, section 7) and batched datagram I/O. Every datagram
+/// through a relay carries RSV RSV FRAG ATYP DST.ADDR DST.PORT in front. Buffers keep
+/// kHeadroom bytes free ahead of the payload: Wrap writes the header into them and moves the
+/// start back, Unwrap moves it past the header, the payload itself is never copied.
+/// On linux a batch is one sendmmsg/recvmmsg, elsewhere one call per datagram
+/// </summary>
+class Datagrams
+{
+public:
+	// RSV RSV FRAG ATYP, a length byte and the longest name, the port
+	static constexpr std::size_t kHeadroom = 4 + 1 + 255 + 2;
+	static constexpr std::size_t kMaxSize = 65535;
+	static constexpr std::size_t kBatch = 32;
+
+	/// <summary>
+	/// The header for datagrams to host:port, built once per destination. Addresses go as
+	/// they are, anything else as a name; empty if the name is too long
+	/// </summary>
+	static auto Header(const std::string& host, const std::uint16_t port) -> std::string
+	{
+		in_addr v4{};
+		in6_addr v6{};
+
+		std::string header{ 0, 0, 0 };
+		if (inet_pton(AF_INET, host.c_str(), &v4) == 1) {
+			header += char(kIPv4);
+			header.append(reinterpret_cast<const char*>(&v4), sizeof v4);
+		}
+		else if (inet_pton(AF_INET6, host.c_str(), &v6) == 1) {
+			header += char(kIPv6);
+			header.append(reinterpret_cast<const char*>(&v6), sizeof v6);
+		}
+		else {
+			if (host.empty() || host.size() > 255)
+				return {};
+			header += char(kDomain);
+			header += char(host.size());
+			header += host;
+		}
+
+		header += char(port >> 8);
+		header += char(port & 0xFF);
+		return header;
+	}
+
+	/// <summary>
+	/// Puts header in front of the payload, which must have that much headroom
+	/// </summary>
+	static auto Wrap(Datagram& datagram, const std::string_view header) -> void
+	{
+		datagram.data -= header.size();
+		datagram.size += header.size();
+		std::memcpy(datagram.data, header.data(), header.size());
+	}
+
+	/// <summary>
+	/// Puts the header for address in front of the payload, what a relay does with answers
+	/// </summary>
+	static auto Wrap(Datagram& datagram, const sockaddr_storage& address) -> void
+	{
+		const auto v6 = address.ss_family == AF_INET6;
+		const auto* in = reinterpret_cast<const sockaddr_in*>(&address);
+		const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&address);
+		const std::size_t length = v6 ? 16 : 4;
+
+		datagram.data -= 4 + length + 2;
+		datagram.size += 4 + length + 2;
+
+		auto* header = reinterpret_cast<std::uint8_t*>(datagram.data);
+		header[0] = header[1] = header[2] = 0;
+		header[3] = v6 ? kIPv6 : kIPv4;
+		std::memcpy(header + 4, v6 ? static_cast<const void*>(&in6->sin6_addr) : static_cast<const void*>(&in->sin_addr), length);
+		// the port is in network order already
+		std::memcpy(header + 4 + length, v6 ? &in6->sin6_port : &in->sin_port, 2);
+	}
+
+	/// <summary>
+	/// Takes the header off, target gets what it said. False for a datagram too short for its
+	/// header or a fragment: fragments aren't reassembled, RFC 1928 lets them be dropped
+	/// </summary>
+	static auto Unwrap(Datagram& datagram, DatagramTarget& target) -> bool
+	{
+		const auto* header = reinterpret_cast<const std::uint8_t*>(datagram.data);
+		if (datagram.size < 5 || header[0] || header[1] || header[2])
+			return false;
+
+		const auto type = header[3];
+		const std::size_t address = type == kIPv4 ? 4u : type == kIPv6 ? 16u : type == kDomain ? 1u + header[4] : 0u;
+		if (!address || datagram.size < 4 + address + 2)
+			return false;
+
+		target.port = std::uint16_t(header[4 + address] << 8 | header[5 + address]);
+		target.name = {};
+		target.length = 0;
+
+		if (type == kIPv4) {
+			auto* in = reinterpret_cast<sockaddr_in*>(&target.address);
+			*in = {};
+			in->sin_family = AF_INET;
+			in->sin_port = htons(target.port);
+			std::memcpy(&in->sin_addr, header + 4, 4);
+			target.length = sizeof(sockaddr_in);
+		}
+		else if (type == kIPv6) {
+			auto* in6 = reinterpret_cast<sockaddr_in6*>(&target.address);
+			*in6 = {};
+			in6->sin6_family = AF_INET6;
+			in6->sin6_port = htons(target.port);
+			std::memcpy(&in6->sin6_addr, header + 4, 16);
+			target.length = sizeof(sockaddr_in6);
+		}
+		else {
+			target.name = std::string_view(reinterpret_cast<const char*>(header) + 5, header[4]);
+		}
+
+		datagram.data += 4 + address + 2;
+		datagram.size -= 4 + address + 2;
+		return true;
+	}
+
+	/// <summary>
+	/// Sends count datagrams, how many went out before the socket would block or failed
+	/// </summary>
+	static auto Send(SOCKET fd, Datagram* batch, const std::size_t count) -> std::size_t
+	{
+		std::size_t sent = 0;
+#ifdef __linux__
+		std::array<mmsghdr, kBatch> messages;
+		std::array<iovec, kBatch> vectors;
+
+		while (sent < count) {
+			const auto n = std::min(count - sent, kBatch);
+			for (std::size_t i = 0; i < n; ++i) {
+				auto& datagram = batch[sent + i];
+				vectors[i] = { datagram.data, datagram.size };
+				messages[i] = {};
+				messages[i].msg_hdr.msg_iov = &vectors[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+				messages[i].msg_hdr.msg_name = datagram.length ? &datagram.peer : nullptr;
+				messages[i].msg_hdr.msg_namelen = datagram.length;
+			}
+
+			const auto result = ::sendmmsg(fd, messages.data(), static_cast<unsigned int>(n), 0);
+			if (result <= 0)
+				break;
+
+			sent += static_cast<std::size_t>(result);
+			if (static_cast<std::size_t>(result) < n)
+				break;
+		}
+#else
+		for (; sent < count; ++sent) {
+			const auto& datagram = batch[sent];
+			const auto* peer = datagram.length ? reinterpret_cast<const sockaddr*>(&datagram.peer) : nullptr;
+			if (::sendto(fd, reinterpret_cast<const char*>(datagram.data), static_cast<buffsize_t>(datagram.size), 0, peer, datagram.length) < 0)
+				break;
+		}
+#endif
+		return sent;
+	}
+
+	/// <summary>
+	/// Receives up to count datagrams, each into its own slot of slot bytes at buffer and
+	/// kHeadroom into it. The count, 0 if the socket would block and -1 on an error
+	/// </summary>
+	static auto Receive(SOCKET fd, Datagram* batch, const std::size_t count, std::byte* buffer, const std::size_t slot) -> std::int64_t
+	{
+#ifdef __linux__
+		std::array<mmsghdr, kBatch> messages;
+		std::array<iovec, kBatch> vectors;
+
+		const auto n = std::min(count, kBatch);
+		for (std::size_t i = 0; i < n; ++i) {
+			auto& datagram = batch[i];
+			datagram.data = buffer + i * slot + kHeadroom;
+			vectors[i] = { datagram.data, slot - kHeadroom };
+			messages[i] = {};
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_name = &datagram.peer;
+			messages[i].msg_hdr.msg_namelen = sizeof datagram.peer;
+		}
+
+		const auto result = ::recvmmsg(fd, messages.data(), static_cast<unsigned int>(n), MSG_WAITFORONE, nullptr);
+		if (result < 0)
+			return WouldBlock() ? 0 : -1;
+
+		for (std::size_t i = 0; i < static_cast<std::size_t>(result); ++i) {
+			batch[i].size = messages[i].msg_len;
+			batch[i].length = messages[i].msg_hdr.msg_namelen;
+		}
+		return result;
+#else
+		// without recvmmsg a second read could block, one datagram per call
+		if (!count)
+			return 0;
+
+		auto& datagram = batch[0];
+		datagram.data = buffer + kHeadroom;
+		datagram.length = sizeof datagram.peer;
+		const auto received = ::recvfrom(fd, reinterpret_cast<char*>(datagram.data), static_cast<buffsize_t>(slot - kHeadroom), 0,
+			reinterpret_cast<sockaddr*>(&datagram.peer), &datagram.length);
+		if (received < 0)
+			return WouldBlock() ? 0 : -1;
+
+		datagram.size = static_cast<std::size_t>(received);
+		return 1;
+#endif
+	}
+
+private:
+	enum : std::uint8_t
+	{
+		kIPv4 = 1,
+		kDomain = 3,
+		kIPv6 = 4
+	};
+
+	static auto WouldBlock(void) -> bool
+	{
+		const auto error = LastError();
+		return error == EWOULDBLOCK || error == EAGAIN;
+	}
+};
+
+#endif // !DATAGRAM_HPP
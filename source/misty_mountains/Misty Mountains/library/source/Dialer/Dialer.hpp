@@ -0,0 +1,309 @@
+#ifndef DIALER_HPP
+#define DIALER_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Handshake/Handshake.hpp"
+#include "../Loop/Loop.hpp"
+#include "../Options/Options.hpp"
+#include "../Resolver/Resolver.hpp"
+
+/// <summary>
+/// Brings up tunnels through a proxy on a Loop. The connect to the proxy and the handshake
+/// are both driven by socket readiness, so one loop thread can have thousands of them in
+/// progress instead of blocking a thread on each. A chain of proxies is handshaken hop by hop
+/// over the one connection to the first. A proxy that rejects a pipelined SOCKS5 handshake is
+/// redialed step by step, and remembered so it isn't pipelined again. Loop thread only
+/// </summary>
+class Dialer
+{
+public:
+	/// <summary>
+	/// Gets the tunnel in non-blocking mode, or an invalid socket and why there is none,
+	/// and how long the handshake with each hop took
+	/// </summary>
+	using Done = std::function<void(kissnet::tcp_socket&& socket, const std::string& error, const std::vector<std::chrono::microseconds>& latencies)>;
+
+	explicit Dialer(Loop& loop) :
+		loop_(loop), guard_(std::make_shared<Guard>())
+	{
+		guard_->loop = &loop_;
+		guard_->dialer = this;
+	}
+
+	~Dialer(void)
+	{
+		// resolver answers still on their way must not reach a loop that is gone
+		std::lock_guard<std::mutex> lock(guard_->mutex);
+		guard_->loop = nullptr;
+		guard_->dialer = nullptr;
+	}
+
+	Dialer(const Dialer&) = delete;
+	Dialer& operator=(const Dialer&) = delete;
+
+	/// <summary>
+	/// Tunnels to host:port through proxy, done is called on the loop thread within timeout
+	/// </summary>
+	auto Dial(const ProxyOptions& proxy, const std::string& host, const std::uint16_t port,
+		const std::chrono::milliseconds timeout, Done done) -> void
+	{
+		this->Dial(std::vector<ProxyOptions>{ proxy }, host, port, timeout, std::move(done));
+	}
+
+	/// <summary>
+	/// Tunnels to host:port through every proxy of chain in order
+	/// </summary>
+	auto Dial(const std::vector<ProxyOptions>& chain, const std::string& host, const std::uint16_t port,
+		const std::chrono::milliseconds timeout, Done done) -> void
+	{
+		this->Start(chain, host, port, timeout, std::chrono::steady_clock::now() + timeout, std::move(done));
+	}
+
+	/// <summary>
+	/// Fails every tunnel still in progress
+	/// </summary>
+	auto Close(void) -> void
+	{
+		while (!attempts_.empty())
+			this->Finish(attempts_.begin()->first, "dialer is closed");
+	}
+
+	auto InProgress(void) const -> std::size_t
+	{
+		return attempts_.size();
+	}
+
+private:
+	struct Attempt
+	{
+		kissnet::tcp_socket socket;
+		std::optional<Handshake> handshake;
+		Done done;
+		bool connecting;
+
+		// kept for the next hop and for a redial without pipelining
+		std::vector<ProxyOptions> chain;
+		std::vector<std::uint16_t> ports;
+		std::string host;
+		std::uint16_t port;
+		// the caller's, a redial only gets what is left of it
+		std::chrono::milliseconds timeout;
+		std::chrono::steady_clock::time_point deadline;
+
+		// the hop whose handshake is running
+		std::size_t hop;
+		std::chrono::steady_clock::time_point started;
+		std::vector<std::chrono::microseconds> latencies;
+	};
+
+	/// <summary>
+	/// Starts a tunnel that has to be up by deadline, timeout is what the caller gave for it
+	/// </summary>
+	auto Start(const std::vector<ProxyOptions>& chain, const std::string& host, const std::uint16_t port,
+		const std::chrono::milliseconds timeout, const std::chrono::steady_clock::time_point deadline, Done done) -> void
+	{
+		std::vector<std::uint16_t> ports;
+		for (const auto& hop : chain) {
+			try
+			{
+				ports.push_back(std::uint16_t(std::stoi(hop.port, nullptr, 10)));
+			}
+			catch (const std::exception&) {
+				done({}, "wrong proxy port " + hop.port, {});
+				return;
+			}
+		}
+
+		if (chain.empty()) {
+			done({}, "no proxy to tunnel through", {});
+			return;
+		}
+
+		const auto id = ++last_id_;
+		auto& attempt = attempts_.emplace(id, Attempt{ {}, {}, std::move(done), true, chain, std::move(ports), host, port, timeout, deadline, 0, {}, {} }).first->second;
+		this->Next(attempt);
+
+		const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		loop_.After(left, [this, id, timeout] {
+			this->Finish(id, "no tunnel through the proxy within " + std::to_string(timeout.count()) + "ms");
+			});
+
+		Resolver::Shared().Resolve(chain.front().host, [guard = guard_, id, proxy_port = kissnet::port_t(attempt.ports.front()), name = chain.front().host](const Resolution& resolution) {
+			std::lock_guard<std::mutex> lock(guard->mutex);
+			if (!guard->loop)
+				return;
+
+			// the dialer outlives its loop's tasks, and Connect may dial again and come back here
+			guard->loop->Post([guard, id, proxy_port, name, resolution] {
+				guard->dialer->Connect(id, name, proxy_port, resolution);
+				});
+			});
+	}
+
+	/// <summary>
+	/// Shared with resolver callbacks, which may outlive the dialer
+	/// </summary>
+	struct Guard
+	{
+		std::mutex mutex;
+		Loop* loop = nullptr;
+		Dialer* dialer = nullptr;
+	};
+
+	auto Connect(const std::uint64_t id, const std::string& name, const kissnet::port_t port, const Resolution& resolution) -> void
+	{
+		const auto it = attempts_.find(id);
+		if (it == attempts_.end())
+			return;
+
+		const auto* address = resolution.First(AF_INET);
+		if (!address) {
+			this->Finish(id, resolution.error.empty() ? "no IPv4 address for proxy " + name : resolution.error);
+			return;
+		}
+
+		auto& attempt = it->second;
+		attempt.socket = kissnet::tcp_socket({ address->Text(), port });
+		if (!attempt.socket.connect_async()) {
+			this->Finish(id, "can't connect to proxy " + name + ", error " + std::to_string(attempt.socket.get_connect_error()));
+			return;
+		}
+
+		// a connect that completed right away still reports writable
+		if (!loop_.Watch(attempt.socket.get_handle(), false, true, [this, id](const PollEvent&) { this->Ready(id); })) {
+			attempt.socket.close();
+			this->Finish(id, "can't watch the proxy connection");
+		}
+	}
+
+	auto Ready(const std::uint64_t id) -> void
+	{
+		const auto it = attempts_.find(id);
+		if (it == attempts_.end())
+			return;
+
+		auto& attempt = it->second;
+		const auto fd = attempt.socket.get_handle();
+
+		if (attempt.connecting) {
+			if (!attempt.socket.connect_result()) {
+				this->Finish(id, "can't connect to the proxy, error " + std::to_string(attempt.socket.get_connect_error()));
+				return;
+			}
+			attempt.connecting = false;
+			// the first hop's handshake is timed from here, without the connect
+			attempt.started = std::chrono::steady_clock::now();
+		}
+
+		for (;;) {
+			switch (attempt.handshake->Advance(fd)) {
+			case Progress::kWrite:
+				loop_.Modify(fd, false, true);
+				return;
+			case Progress::kRead:
+				loop_.Modify(fd, true, false);
+				return;
+			case Progress::kDone:
+				if (this->Next(attempt))
+					continue;
+				this->Finish(id, {});
+				return;
+			case Progress::kFailed:
+				if (attempt.handshake->Rejected())
+					this->Redial(id);
+				else
+					this->Finish(id, attempt.handshake->Error() + (attempt.chain.size() > 1 ? " (hop " + std::to_string(attempt.hop + 1) + ')' : ""));
+				return;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Records the hop that is done and sets up the next handshake, false when the chain is through
+	/// </summary>
+	auto Next(Attempt& attempt) -> bool
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (attempt.handshake) {
+			attempt.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(now - attempt.started));
+			if (++attempt.hop == attempt.chain.size())
+				return false;
+		}
+		attempt.started = now;
+
+		// each hop is asked for a tunnel to the next one, the last to the destination
+		const auto& hop = attempt.chain[attempt.hop];
+		const auto last = attempt.hop + 1 == attempt.chain.size();
+		attempt.handshake.emplace(hop.protocol, last ? attempt.host : attempt.chain[attempt.hop + 1].host,
+			last ? attempt.port : attempt.ports[attempt.hop + 1], hop.username, hop.password);
+		attempt.handshake->Pipelined(hop.pipelined && !strict_.count(hop.host + ':' + hop.port));
+		return true;
+	}
+
+	/// <summary>
+	/// Starts over on a new connection with the strict handshake, the caller gets one answer either way
+	/// </summary>
+	auto Redial(const std::uint64_t id) -> void
+	{
+		const auto it = attempts_.find(id);
+		auto attempt = std::move(it->second);
+		attempts_.erase(it);
+
+		loop_.Forget(attempt.socket.get_handle());
+		attempt.socket.close();
+
+		const auto& hop = attempt.chain[attempt.hop];
+		strict_.insert(hop.host + ':' + hop.port);
+
+		// the redial doesn't get a timeout of its own, only what the first try left of the caller's
+		if (std::chrono::steady_clock::now() >= attempt.deadline) {
+			attempt.done({}, "no tunnel through the proxy within " + std::to_string(attempt.timeout.count()) + "ms", attempt.latencies);
+			return;
+		}
+		this->Start(attempt.chain, attempt.host, attempt.port, attempt.timeout, attempt.deadline, std::move(attempt.done));
+	}
+
+	/// <summary>
+	/// Hands the tunnel (or the error) over, does nothing if the attempt is over already
+	/// </summary>
+	auto Finish(const std::uint64_t id, std::string error) -> void
+	{
+		const auto it = attempts_.find(id);
+		if (it == attempts_.end())
+			return;
+
+		auto attempt = std::move(it->second);
+		attempts_.erase(it);
+
+		if (attempt.socket.is_valid())
+			loop_.Forget(attempt.socket.get_handle());
+
+		if (!error.empty())
+			attempt.socket.close();
+
+		attempt.done(std::move(attempt.socket), error, attempt.latencies);
+	}
+
+	Loop& loop_;
+	std::shared_ptr<Guard> guard_;
+	std::unordered_map<std::uint64_t, Attempt> attempts_;
+	std::uint64_t last_id_ = 0;
+	// host:port of the proxies that broke a pipelined handshake
+	std::unordered_set<std::string> strict_;
+};
+
+#endif // !DIALER_HPP
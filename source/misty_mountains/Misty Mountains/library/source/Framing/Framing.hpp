@@ -0,0 +1,116 @@
+#ifndef FRAMING_HPP
+#define FRAMING_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// how messages are delimited on the wire, the client's and the server's =framing must match
+enum class Framing {
+	kRaw,
+	kLine,
+	kLength
+};
+
+/// <summary>
+/// Frames messages and splits the inbound byte stream back into them, for the client's
+/// messages and the server's echoes alike
+/// raw   : nothing is framed, every read is one message (legacy behaviour)
+/// line  : messages end with '\n', a '\r' in front of it is dropped
+/// length: 4 byte big-endian length header in front of every message
+/// </summary>
+class Framer
+{
+public:
+	static constexpr std::size_t kHeader = 4;
+	static constexpr std::size_t kMaxMessage = 16 * 1024 * 1024;
+
+	/// <summary>
+	/// Appends the framed payload to out
+	/// </summary>
+	static auto Encode(std::string& out, const Framing framing, const std::string_view payload) -> void
+	{
+		if (framing == Framing::kLength) {
+			const auto length = static_cast<std::uint32_t>(payload.size());
+			const char header[kHeader] = {
+				static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+				static_cast<char>(length >> 8), static_cast<char>(length) };
+			out.append(header, kHeader);
+		}
+
+		out.append(payload);
+
+		if (framing == Framing::kLine)
+			out.push_back('\n');
+	}
+
+	/// <summary>
+	/// Appends the framed, decorated echo of payload to out
+	/// </summary>
+	static auto Encode(std::string& out, const Framing framing, const std::string& prefix, const std::string_view payload, const std::string& suffix) -> void
+	{
+		if (framing == Framing::kLength) {
+			const auto length = static_cast<std::uint32_t>(prefix.size() + payload.size() + suffix.size());
+			const char header[kHeader] = {
+				static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+				static_cast<char>(length >> 8), static_cast<char>(length) };
+			out.append(header, kHeader);
+		}
+
+		out.append(prefix);
+		out.append(payload);
+		out.append(suffix);
+
+		if (framing == Framing::kLine)
+			out.push_back('\n');
+	}
+
+	/// <summary>
+	/// Calls on_message for every complete message at the front of inbox and removes them.
+	/// Returns false if the peer sent a frame larger than kMaxMessage
+	/// </summary>
+	template <typename Callback>
+	static auto Extract(std::string& inbox, const Framing framing, Callback&& on_message) -> bool
+	{
+		std::size_t offset = 0;
+
+		if (framing == Framing::kLine) {
+			for (auto end = inbox.find('\n'); end != std::string::npos; end = inbox.find('\n', offset)) {
+				auto line = std::string_view(inbox).substr(offset, end - offset);
+				if (!line.empty() && line.back() == '\r')
+					line.remove_suffix(1);
+
+				on_message(line);
+				offset = end + 1;
+			}
+
+			if (inbox.size() - offset > kMaxMessage)
+				return false;
+		}
+		else if (framing == Framing::kLength) {
+			while (inbox.size() - offset >= kHeader) {
+				const auto* header = reinterpret_cast<const unsigned char*>(inbox.data() + offset);
+				const auto length = std::size_t{ header[0] } << 24 | std::size_t{ header[1] } << 16 | std::size_t{ header[2] } << 8 | header[3];
+
+				if (length > kMaxMessage)
+					return false;
+				if (inbox.size() - offset - kHeader < length)
+					break;
+
+				on_message(std::string_view(inbox).substr(offset + kHeader, length));
+				offset += kHeader + length;
+			}
+		}
+		else {
+			on_message(std::string_view(inbox));
+			offset = inbox.size();
+		}
+
+		inbox.erase(0, offset);
+		return true;
+	}
+};
+
+#endif // !FRAMING_HPP
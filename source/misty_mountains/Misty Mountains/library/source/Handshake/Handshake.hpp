@@ -0,0 +1,523 @@
+#ifndef HANDSHAKE_HPP
+#define HANDSHAKE_HPP
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#include "../Reactor/Reactor.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/// proxy types
+enum class Protocol {
+	kHttp,
+	kSocks4,
+	kSocks5
+};
+
+/// <summary>
+/// What a handshake needs before it can go on
+/// </summary>
+enum class Progress
+{
+	kWrite,
+	kRead,
+	kDone,
+	kFailed
+};
+
+/// <summary>
+/// One proxy handshake as a resumable state machine. Advance() sends and receives on a
+/// non-blocking socket until it would block and says which readiness to wait for, so a
+/// single thread can drive any number of handshakes. Replies are read exactly (SOCKS) or
+/// up to the end of the headers (HTTP) and may arrive in any number of pieces; tunnel bytes
+/// that came with them stay in the socket for the tunnel's first read.
+/// Pipelined SOCKS5 sends the greeting and the CONNECT request in one write and reads both
+/// replies from the stream, one round trip instead of two. Only without credentials, the
+/// method reply can't change what is sent next then. With credentials a SOCKS5 proxy that
+/// picks username/password gets them as RFC 1929 asks. Names are resolved by the proxy:
+/// SOCKS5 gets the destination as an IPv4, IPv6 or domain address and SOCKS4 falls back to
+/// SOCKS4a for names, so the client never waits for DNS. A SOCKS5 handshake can ask for a
+/// UDP relay (UDP ASSOCIATE) instead of a tunnel, the relay's address comes with the reply
+/// </summary>
+class Handshake
+{
+public:
+	static constexpr std::size_t kMaxHeaders = 8192;
+
+	Handshake(const Protocol protocol, std::string host, const std::uint16_t port,
+		std::string username = {}, std::string password = {}) :
+		protocol_(protocol), host_(std::move(host)), port_(port),
+		username_(std::move(username)), password_(std::move(password))
+	{
+	}
+
+	/// <summary>
+	/// Goes as far as the socket allows, call again once it is ready for what was returned
+	/// </summary>
+	auto Advance(SOCKET fd) -> Progress
+	{
+		if (state_ == State::kStart)
+			this->Begin();
+
+		while (state_ != State::kDone && state_ != State::kFailed) {
+			if (sent_ < out_.size()) {
+				const auto sent = ::send(fd, out_.data() + sent_, static_cast<buffsize_t>(out_.size() - sent_), MSG_NOSIGNAL);
+				if (sent < 0) {
+					const auto error = LastError();
+					if (error == EWOULDBLOCK || error == EAGAIN)
+						return Progress::kWrite;
+					return this->Broken("can't send to the proxy, error " + std::to_string(error));
+				}
+
+				sent_ += static_cast<std::size_t>(sent);
+				continue;
+			}
+
+			if (in_.size() >= need_) {
+				this->Parse();
+				continue;
+			}
+
+			// SOCKS replies are read to the byte and HTTP headers are peeked at first,
+			// whatever follows belongs to the tunnel and is left in the socket
+			const auto want = protocol_ == Protocol::kHttp ? kMaxHeaders - in_.size() : need_ - in_.size();
+			const auto offset = in_.size();
+			in_.resize(offset + want);
+			std::int64_t received = ::recv(fd, in_.data() + offset, static_cast<buffsize_t>(want), protocol_ == Protocol::kHttp ? MSG_PEEK : 0);
+			if (received > 0 && protocol_ == Protocol::kHttp)
+				received = this->Consume(fd, offset, static_cast<std::size_t>(received));
+			in_.resize(offset + (received > 0 ? static_cast<std::size_t>(received) : 0));
+
+			if (received == 0)
+				return this->Broken("the proxy closed the connection during the handshake");
+			if (received < 0) {
+				const auto error = LastError();
+				if (error == EWOULDBLOCK || error == EAGAIN)
+					return Progress::kRead;
+				return this->Broken("can't receive from the proxy, error " + std::to_string(error));
+			}
+		}
+
+		return state_ == State::kDone ? Progress::kDone : Progress::kFailed;
+	}
+
+	/// <summary>
+	/// Optimistic SOCKS5 without credentials, must be set before the first Advance()
+	/// </summary>
+	auto Pipelined(const bool enable) -> void
+	{
+		pipelined_ = enable && protocol_ == Protocol::kSocks5 && username_.empty();
+	}
+
+	/// <summary>
+	/// UDP ASSOCIATE instead of CONNECT, SOCKS5 only: host:port is where the datagrams will be
+	/// sent from, 0.0.0.0:0 if that isn't known yet. Must be set before the first Advance()
+	/// </summary>
+	auto Associate(void) -> void
+	{
+		command_ = kUdpAssociate;
+	}
+
+	/// <summary>
+	/// The address from the SOCKS5 reply: the relay's for UDP ASSOCIATE, the proxy's end of the
+	/// tunnel for CONNECT. A zero address means the proxy's own
+	/// </summary>
+	auto BoundHost(void) const -> const std::string&
+	{
+		return bound_host_;
+	}
+
+	auto BoundPort(void) const -> std::uint16_t
+	{
+		return bound_port_;
+	}
+
+	/// <summary>
+	/// The pipelined handshake broke before the proxy answered the request: it may not take
+	/// a request ahead of its method reply, redial and go step by step
+	/// </summary>
+	auto Rejected(void) const -> bool
+	{
+		return rejected_;
+	}
+
+	auto Error(void) const -> const std::string&
+	{
+		return error_;
+	}
+
+private:
+	enum class State
+	{
+		kStart,
+		kMethod,
+		kAuth,
+		kReplyHeader,
+		kReply,
+		kHeaders,
+		kDone,
+		kFailed
+	};
+
+	enum Socks : unsigned char
+	{
+		kSocks4 = 4,
+		kSocks5 = 5,
+		kConnect = 1,
+		kUdpAssociate = 3,
+		kAuthVersion = 1,
+		kNoAuth = 0x00,
+		kUserPassword = 0x02,
+		kNoAcceptable = 0xFF,
+		kIPv4 = 1,
+		kDomain = 3,
+		kIPv6 = 4,
+		kSocks4Granted = 90,
+		kMaxDomain = 255
+	};
+
+	auto Begin(void) -> void
+	{
+		if (command_ != kConnect && protocol_ != Protocol::kSocks5) {
+			this->Fail("only SOCKS5 proxies relay UDP");
+			return;
+		}
+
+		switch (protocol_) {
+		case Protocol::kSocks5:
+			// the method reply decides whether the credentials are needed
+			out_ = { char(kSocks5), 1, char(kNoAuth) };
+			if (!username_.empty()) {
+				out_[1] = 2;
+				out_ += char(kUserPassword);
+			}
+			if (pipelined_) {
+				const auto greeting = std::move(out_);
+				if (!this->Socks5Request())
+					return;
+				out_.insert(0, greeting);
+			}
+			this->Expect(State::kMethod, 2);
+			break;
+		case Protocol::kSocks4:
+			if (!this->Socks4Request())
+				return;
+			this->Expect(State::kReply, 8);
+			break;
+		case Protocol::kHttp:
+			this->HttpRequest();
+			this->Expect(State::kHeaders, 1);
+			break;
+		}
+	}
+
+	auto Parse(void) -> void
+	{
+		const auto* reply = reinterpret_cast<const unsigned char*>(in_.data());
+
+		switch (state_) {
+		case State::kMethod:
+			if (reply[0] != kSocks5) {
+				this->Broken("the proxy doesn't speak SOCKS5");
+				return;
+			}
+			if (reply[1] == kNoAcceptable) {
+				this->Fail("the proxy accepted none of the offered authentication methods");
+				return;
+			}
+			if (reply[1] == kUserPassword && !username_.empty()) {
+				if (!this->Socks5Auth())
+					return;
+				in_.clear();
+				this->Expect(State::kAuth, 2);
+				break;
+			}
+			if (reply[1] != kNoAuth) {
+				this->Fail("the proxy picked authentication method " + std::to_string(reply[1]) + " that wasn't offered");
+				return;
+			}
+			// pipelined, the request went out with the greeting
+			if (!pipelined_ && !this->Socks5Request())
+				return;
+			in_.clear();
+			this->Expect(State::kReplyHeader, 5);
+			break;
+
+		case State::kAuth:
+			if (reply[0] != kAuthVersion || reply[1] != 0) {
+				this->Fail("the proxy rejected username " + username_);
+				return;
+			}
+			if (!this->Socks5Request())
+				return;
+			in_.clear();
+			this->Expect(State::kReplyHeader, 5);
+			break;
+
+		case State::kReplyHeader: {
+			// version, reply, reserved, address type and the first byte of the bound address
+			const auto address = reply[3] == kIPv4 ? 4u : reply[3] == kIPv6 ? 16u : 1u + reply[4];
+			if (reply[0] != kSocks5 || (reply[3] != kIPv4 && reply[3] != kIPv6 && reply[3] != kDomain)) {
+				this->Broken("the proxy's reply to the request is garbled");
+				return;
+			}
+			this->Expect(State::kReply, 4 + address + 2);
+			break;
+		}
+
+		case State::kReply:
+			if (protocol_ == Protocol::kSocks4) {
+				if (reply[1] != kSocks4Granted) {
+					this->Fail("the SOCKS4 proxy rejected the request, code " + std::to_string(reply[1]));
+					return;
+				}
+			}
+			else if (reply[0] != kSocks5 || reply[1] != 0) {
+				this->Fail(std::string("the SOCKS5 proxy refused: ") + Socks5Reply(reply[1]));
+				return;
+			}
+
+			if (protocol_ == Protocol::kSocks5)
+				this->Bound(reply);
+			this->Finish();
+			break;
+
+		case State::kHeaders: {
+			const auto end = in_.find("\r\n\r\n");
+			if (end == std::string::npos) {
+				if (in_.size() >= kMaxHeaders) {
+					this->Fail("the proxy's response headers are too long");
+					return;
+				}
+				// more of the headers have to come
+				need_ = in_.size() + 1;
+				return;
+			}
+
+			// HTTP/1.0 or 1.1, any 2xx means the tunnel is up
+			const auto status = in_.substr(0, in_.find("\r\n"));
+			if (status.size() < 12 || status.compare(0, 7, "HTTP/1.") != 0 || status[8] != ' ' || status[9] != '2' ||
+				!std::isdigit(static_cast<unsigned char>(status[10])) || !std::isdigit(static_cast<unsigned char>(status[11]))) {
+				this->Fail("the proxy answered " + status);
+				return;
+			}
+			this->Finish();
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	auto Socks5Request(void) -> bool
+	{
+		in_addr v4{};
+		in6_addr v6{};
+
+		out_ = { char(kSocks5), char(command_), 0 };
+		if (inet_pton(AF_INET, host_.c_str(), &v4) == 1) {
+			out_ += char(kIPv4);
+			out_.append(reinterpret_cast<const char*>(&v4), sizeof v4);
+		}
+		else if (inet_pton(AF_INET6, host_.c_str(), &v6) == 1) {
+			out_ += char(kIPv6);
+			out_.append(reinterpret_cast<const char*>(&v6), sizeof v6);
+		}
+		else {
+			if (host_.empty() || host_.size() > kMaxDomain) {
+				this->Fail("SOCKS5 can't carry the name " + host_);
+				return false;
+			}
+			out_ += char(kDomain);
+			out_ += char(host_.size());
+			out_ += host_;
+		}
+
+		out_ += char(port_ >> 8);
+		out_ += char(port_ & 0xFF);
+		sent_ = 0;
+		return true;
+	}
+
+	/// <summary>
+	/// RFC 1929 request, a length byte each for the username and the password
+	/// </summary>
+	auto Socks5Auth(void) -> bool
+	{
+		if (username_.size() > 255 || password_.size() > 255) {
+			this->Fail("SOCKS5 usernames and passwords can't be longer than 255 bytes");
+			return false;
+		}
+
+		out_ = { char(kAuthVersion), char(username_.size()) };
+		out_ += username_;
+		out_ += char(password_.size());
+		out_ += password_;
+		sent_ = 0;
+		return true;
+	}
+
+	auto Socks4Request(void) -> bool
+	{
+		in_addr v4{};
+		in6_addr v6{};
+		const auto numeric = inet_pton(AF_INET, host_.c_str(), &v4) == 1;
+
+		if (!numeric && inet_pton(AF_INET6, host_.c_str(), &v6) == 1) {
+			this->Fail("SOCKS4 can't connect to the IPv6 address " + host_);
+			return false;
+		}
+
+		// SOCKS4a: the address 0.0.0.1 says the name follows the user id
+		const std::uint32_t address = numeric ? v4.s_addr : htonl(1);
+
+		out_ = { char(kSocks4), char(kConnect), char(port_ >> 8), char(port_ & 0xFF) };
+		out_.append(reinterpret_cast<const char*>(&address), 4);
+		out_ += username_;
+		out_ += '\0';
+		if (!numeric) {
+			out_ += host_;
+			out_ += '\0';
+		}
+		sent_ = 0;
+		return true;
+	}
+
+	auto HttpRequest(void) -> void
+	{
+		// IPv6 literals are bracketed in the authority
+		const auto target = (host_.find(':') == std::string::npos ? host_ : '[' + host_ + ']') + ':' + std::to_string(port_);
+		out_ = "CONNECT " + target + " HTTP/1.1\r\nHost: " + target + "\r\n";
+		if (!username_.empty())
+			out_ += "Proxy-Authorization: Basic " + Encode(username_ + ':' + password_) + "\r\n";
+		out_ += "\r\n";
+		sent_ = 0;
+	}
+
+	/// <summary>
+	/// Takes the peeked bytes at offset off the socket, up to the end of the headers if it is
+	/// among them. The bytes are read to where they were peeked to
+	/// </summary>
+	auto Consume(SOCKET fd, const std::size_t offset, const std::size_t peeked) -> std::int64_t
+	{
+		// the end may have started in the bytes read before
+		const auto end = std::string_view(in_.data(), offset + peeked).find("\r\n\r\n", offset >= 3 ? offset - 3 : 0);
+		const auto take = end == std::string_view::npos ? peeked : end + 4 - offset;
+
+		return ::recv(fd, in_.data() + offset, static_cast<buffsize_t>(take), 0);
+	}
+
+	/// <summary>
+	/// Keeps BND.ADDR and BND.PORT of a SOCKS5 reply
+	/// </summary>
+	auto Bound(const unsigned char* reply) -> void
+	{
+		char text[INET6_ADDRSTRLEN]{};
+		const auto address = reply[3] == kIPv4 ? 4u : reply[3] == kIPv6 ? 16u : 1u + reply[4];
+
+		if (reply[3] == kDomain)
+			bound_host_.assign(reinterpret_cast<const char*>(reply) + 5, reply[4]);
+		else if (inet_ntop(reply[3] == kIPv4 ? AF_INET : AF_INET6, reply + 4, text, sizeof text))
+			bound_host_ = text;
+
+		bound_port_ = std::uint16_t(reply[4 + address] << 8 | reply[5 + address]);
+	}
+
+	auto Expect(const State state, const std::size_t bytes) -> void
+	{
+		state_ = state;
+		need_ = bytes;
+	}
+
+	auto Finish(void) -> void
+	{
+		state_ = State::kDone;
+		out_.clear();
+		sent_ = 0;
+	}
+
+	/// <summary>
+	/// Failure that pipelining may have caused, anything but an answer to the request
+	/// </summary>
+	auto Broken(std::string error) -> Progress
+	{
+		rejected_ = pipelined_ && (state_ == State::kMethod || state_ == State::kReplyHeader);
+		return this->Fail(std::move(error));
+	}
+
+	auto Fail(std::string error) -> Progress
+	{
+		state_ = State::kFailed;
+		error_ = std::move(error);
+		return Progress::kFailed;
+	}
+
+	static auto Socks5Reply(const unsigned char code) -> const char*
+	{
+		switch (code) {
+		case 1: return "general failure";
+		case 2: return "connection not allowed by ruleset";
+		case 3: return "network unreachable";
+		case 4: return "host unreachable";
+		case 5: return "connection refused";
+		case 6: return "TTL expired";
+		case 7: return "command not supported";
+		case 8: return "address type not supported";
+		default: return "unknown reply";
+		}
+	}
+
+	static auto Encode(const std::string& value) -> std::string
+	{
+		static constexpr char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		std::string encoded;
+		encoded.reserve(4 * ((value.size() + 2) / 3));
+
+		for (std::size_t i = 0; i < value.size(); i += 3) {
+			const auto left = value.size() - i;
+			const std::uint32_t group = std::uint32_t(static_cast<unsigned char>(value[i])) << 16 |
+				(left > 1 ? std::uint32_t(static_cast<unsigned char>(value[i + 1])) << 8 : 0) |
+				(left > 2 ? std::uint32_t(static_cast<unsigned char>(value[i + 2])) : 0);
+
+			encoded += kTable[group >> 18 & 0x3F];
+			encoded += kTable[group >> 12 & 0x3F];
+			encoded += left > 1 ? kTable[group >> 6 & 0x3F] : '=';
+			encoded += left > 2 ? kTable[group & 0x3F] : '=';
+		}
+
+		return encoded;
+	}
+
+	Protocol protocol_;
+	std::string host_;
+	std::uint16_t port_;
+	std::string username_;
+	std::string password_;
+
+	unsigned char command_ = kConnect;
+	bool pipelined_ = false;
+	bool rejected_ = false;
+
+	std::string bound_host_;
+	std::uint16_t bound_port_ = 0;
+
+	State state_ = State::kStart;
+	std::string out_;
+	std::size_t sent_ = 0;
+	std::string in_;
+	std::size_t need_ = 0;
+	std::string error_;
+};
+
+#endif // !HANDSHAKE_HPP
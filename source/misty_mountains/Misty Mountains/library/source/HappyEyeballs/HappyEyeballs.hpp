@@ -0,0 +1,163 @@
+#ifndef HAPPY_EYEBALLS_HPP
+#define HAPPY_EYEBALLS_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Reactor/Reactor.hpp"
+#include "../Resolver/Resolver.hpp"
+
+/// <summary>
+/// Dual-stack connect racing (RFC 8305): the addresses of a name are tried with the
+/// families interleaved, starting with the one the resolver listed first. Each attempt
+/// gets kAttemptDelay before the next one starts alongside it, or less if it fails,
+/// and the first connection to complete wins. A dead address costs 250ms, not a
+/// connect timeout
+/// </summary>
+class HappyEyeballs
+{
+public:
+	using Prepare = std::function<void(SOCKET)>;
+
+	static constexpr auto kAttemptDelay = std::chrono::milliseconds(250);
+
+	/// <summary>
+	/// Connects to host:port within timeout. prepare sees every socket before its connect
+	/// (socket options such as TCP_FASTOPEN_CONNECT). On failure the socket is invalid and
+	/// error says why. The connected socket is left in blocking mode, like kissnet's connect
+	/// </summary>
+	static auto Connect(const std::string& host, const kissnet::port_t port, const std::chrono::milliseconds timeout,
+		std::string& error, const Prepare& prepare = {}) -> kissnet::tcp_socket
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		const auto resolution = Resolver::Shared().Resolve(host).get();
+		if (!resolution) {
+			error = resolution.error;
+			return {};
+		}
+
+		const auto order = Interleave(resolution.addresses);
+
+		// the kissnet socket type carries the family, an attempt is one or the other
+		using Socket = std::variant<kissnet::tcp_socket, kissnet::tcp_socket_v6>;
+
+		struct Attempt
+		{
+			Socket socket;
+			const Address* address;
+		};
+
+		const auto handle = [](Socket& socket) {
+			return std::visit([](auto& s) { return s.get_handle(); }, socket);
+		};
+
+		Poller poller;
+		std::vector<Attempt> attempts;
+		std::vector<PollEvent> events;
+		std::size_t next = 0;
+		auto next_start = std::chrono::steady_clock::now();
+		error = "no address of " + host + " answered";
+
+		for (;;) {
+			auto now = std::chrono::steady_clock::now();
+
+			if (next < order.size() && (now >= next_start || attempts.empty())) {
+				const auto* address = order[next++];
+				next_start = now + kAttemptDelay;
+
+				const kissnet::endpoint endpoint(address->Text(), port);
+				auto socket = address->Family() == AF_INET6 ? Socket(std::in_place_index<1>, endpoint) : Socket(std::in_place_index<0>, endpoint);
+
+				if (prepare)
+					prepare(handle(socket));
+
+				const auto status = std::visit([](auto& s) { return s.connect_async(); }, socket);
+				if (status.value == kissnet::socket_status::valid)
+					return Won(std::move(socket));
+
+				if (status.value != kissnet::socket_status::non_blocking_would_have_blocked) {
+					error = "can't connect to " + address->Text() + ", error " + std::to_string(std::visit([](auto& s) { return s.get_connect_error(); }, socket));
+					// this one is over already, the next one doesn't have to wait for it
+					next_start = now;
+					continue;
+				}
+
+				poller.Add(handle(socket), false, true);
+				attempts.push_back({ std::move(socket), address });
+				continue;
+			}
+
+			if (attempts.empty() && next >= order.size())
+				return {};
+
+			if (now >= deadline) {
+				error = "no connection to " + host + " within " + std::to_string(timeout.count()) + "ms";
+				return {};
+			}
+
+			const auto until = next < order.size() ? std::min(deadline, next_start) : deadline;
+			const auto wait = std::chrono::ceil<std::chrono::milliseconds>(until - now).count();
+			poller.Wait(events, static_cast<int>(std::max<std::int64_t>(wait, 0)));
+
+			for (const auto& event : events) {
+				const auto it = std::find_if(attempts.begin(), attempts.end(), [&](Attempt& attempt) { return handle(attempt.socket) == event.fd; });
+				if (it == attempts.end())
+					continue;
+
+				poller.Remove(event.fd);
+				const auto status = std::visit([](auto& s) { return s.connect_result(); }, it->socket);
+				if (status.value == kissnet::socket_status::valid)
+					return Won(std::move(it->socket));
+
+				error = "can't connect to " + it->address->Text() + ", error " + std::to_string(std::visit([](auto& s) { return s.get_connect_error(); }, it->socket));
+				attempts.erase(it);
+				next_start = std::chrono::steady_clock::now();
+			}
+		}
+	}
+
+private:
+	/// <summary>
+	/// Alternates the families, the first one is whichever the resolver put first
+	/// </summary>
+	static auto Interleave(const std::vector<Address>& addresses) -> std::vector<const Address*>
+	{
+		std::vector<const Address*> first, second, order;
+		const auto family = addresses.front().Family();
+
+		for (const auto& address : addresses)
+			(address.Family() == family ? first : second).push_back(&address);
+
+		for (std::size_t i = 0; i < std::max(first.size(), second.size()); ++i) {
+			if (i < first.size())
+				order.push_back(first[i]);
+			if (i < second.size())
+				order.push_back(second[i]);
+		}
+
+		return order;
+	}
+
+	/// <summary>
+	/// The winner as a kissnet::tcp_socket whatever its family, back in blocking mode; the losers close as they go out of scope
+	/// </summary>
+	static auto Won(std::variant<kissnet::tcp_socket, kissnet::tcp_socket_v6>&& attempt) -> kissnet::tcp_socket
+	{
+		return std::visit([](auto& s) {
+			s.set_non_blocking(false);
+			const auto endpoint = s.get_bind_loc();
+			return kissnet::tcp_socket(s.release(), endpoint);
+			}, attempt);
+	}
+};
+
+#endif // !HAPPY_EYEBALLS_HPP
@@ -0,0 +1,201 @@
+#ifndef LOOP_HPP
+#define LOOP_HPP
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Reactor/Reactor.hpp"
+
+/// <summary>
+/// Event loop thread: socket readiness, timers and tasks posted from any thread.
+/// Everything registered with it runs on the loop thread, so handlers must not block
+/// </summary>
+class Loop
+{
+public:
+	using Task = std::function<void()>;
+	using Handler = std::function<void(const PollEvent&)>;
+
+	Loop(void)
+	{
+		poller_.Add(notifier_.Handle());
+	}
+
+	~Loop(void)
+	{
+		Stop();
+	}
+
+	Loop(const Loop&) = delete;
+	Loop& operator=(const Loop&) = delete;
+
+	auto Start(void) -> void
+	{
+		running_ = true;
+		thread_ = std::thread([this] { this->Run(); });
+	}
+
+	/// <summary>
+	/// Runs the tasks posted so far and joins the thread, timers still pending are dropped
+	/// </summary>
+	auto Stop(void) -> void
+	{
+		if (!thread_.joinable())
+			return;
+
+		running_ = false;
+		notifier_.Notify();
+		thread_.join();
+	}
+
+	/// <summary>
+	/// Queues task for the loop thread, safe from any thread
+	/// </summary>
+	auto Post(Task task) -> void
+	{
+		auto wake = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			// a non-empty queue already has a wakeup on the way
+			wake = posted_.empty();
+			posted_.push_back(std::move(task));
+		}
+
+		if (wake)
+			notifier_.Notify();
+	}
+
+	/// <summary>
+	/// Runs task after delay, loop thread only
+	/// </summary>
+	auto After(const std::chrono::steady_clock::duration delay, Task task) -> void
+	{
+		timers_.push({ std::chrono::steady_clock::now() + delay, sequence_++, std::move(task) });
+	}
+
+	/// <summary>
+	/// Calls handler whenever fd is ready, loop thread only
+	/// </summary>
+	auto Watch(SOCKET fd, const bool read, const bool write, Handler handler) -> bool
+	{
+		if (!poller_.Add(fd, read, write))
+			return false;
+
+		handlers_[fd] = std::make_unique<Handler>(std::move(handler));
+		return true;
+	}
+
+	auto Modify(SOCKET fd, const bool read, const bool write) -> bool
+	{
+		return poller_.Modify(fd, read, write);
+	}
+
+	/// <summary>
+	/// Stops watching fd, safe to call from its own handler
+	/// </summary>
+	auto Forget(SOCKET fd) -> void
+	{
+		poller_.Remove(fd);
+
+		const auto it = handlers_.find(fd);
+		if (it == handlers_.end())
+			return;
+
+		// the handler may be the one running right now, it is destroyed after the batch
+		retired_.push_back(std::move(it->second));
+		handlers_.erase(it);
+	}
+
+	auto InLoop(void) const -> bool
+	{
+		return std::this_thread::get_id() == thread_.get_id();
+	}
+
+private:
+	struct Timer
+	{
+		std::chrono::steady_clock::time_point at;
+		std::uint64_t sequence;
+		Task task;
+
+		// earliest first, ties in the order they were added
+		auto operator<(const Timer& other) const -> bool
+		{
+			return at != other.at ? at > other.at : sequence > other.sequence;
+		}
+	};
+
+	auto Run(void) -> void
+	{
+		std::vector<PollEvent> events;
+		std::vector<Task> tasks;
+
+		for (;;) {
+			auto timeout_ms = -1;
+			if (!timers_.empty()) {
+				const auto left = std::chrono::ceil<std::chrono::milliseconds>(timers_.top().at - std::chrono::steady_clock::now()).count();
+				timeout_ms = left > 0 ? static_cast<int>(left) : 0;
+			}
+
+			poller_.Wait(events, timeout_ms);
+
+			for (const auto& event : events) {
+				if (event.fd == notifier_.Handle()) {
+					notifier_.Drain();
+					continue;
+				}
+
+				// looked up every time, an earlier handler may have forgotten this fd
+				const auto it = handlers_.find(event.fd);
+				if (it != handlers_.end())
+					(*it->second)(event);
+			}
+			retired_.clear();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				tasks.swap(posted_);
+			}
+			for (auto& task : tasks)
+				task();
+			tasks.clear();
+
+			if (!running_)
+				break;
+
+			const auto now = std::chrono::steady_clock::now();
+			while (!timers_.empty() && timers_.top().at <= now) {
+				auto task = timers_.top().task;
+				timers_.pop();
+				task();
+			}
+		}
+	}
+
+	Poller poller_;
+	Notifier notifier_;
+	std::unordered_map<SOCKET, std::unique_ptr<Handler>> handlers_;
+	std::vector<std::unique_ptr<Handler>> retired_;
+	std::priority_queue<Timer> timers_;
+	std::uint64_t sequence_ = 0;
+
+	std::mutex mutex_;
+	std::vector<Task> posted_;
+
+	std::atomic<bool> running_{ false };
+	std::thread thread_;
+};
+
+#endif // !LOOP_HPP
@@ -0,0 +1,64 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Framing/Framing.hpp"
+#include "../Proxy/Proxy.hpp"
+
+/// <summary>
+/// Proxy every pooled connection is tunnelled through
+/// </summary>
+struct ProxyOptions
+{
+	std::string host;
+	std::string port;
+	Protocol protocol = Protocol::kSocks5;
+	std::string username;
+	std::string password;
+	// SOCKS5 greeting and request in one write, proxies that reject it get the strict handshake
+	bool pipelined = true;
+};
+
+/// <summary>
+/// How a Client talks to the echo server, the defaults match the server's
+/// </summary>
+struct Options
+{
+	kissnet::endpoint server{ "127.0.0.1", 1337 };
+	Framing framing = Framing::kRaw;
+	std::string prefix;
+	std::string suffix;
+
+	// pooled connections, and echoes kept in flight on each (needs line or length framing above 1)
+	std::size_t connections = 1;
+	std::size_t window = 1;
+
+	// a call fails if its echo takes longer, and so does a call that found no connection in time
+	std::chrono::milliseconds timeout{ 1000 };
+
+	// reconnects wait min * 2^failures, capped at max, half of it randomized
+	std::chrono::milliseconds backoff_min{ 100 };
+	std::chrono::milliseconds backoff_max{ 10000 };
+
+	// TCP keepalive probes on idle pooled connections, 0 leaves the system default
+	std::chrono::seconds keepalive{ 30 };
+
+	std::optional<ProxyOptions> proxy;
+	// more proxies behind proxy, each reached through the tunnel of the one before
+	std::vector<ProxyOptions> via;
+
+	// interchangeable proxies each connection picks one of instead, probed every probe_interval
+	std::vector<ProxyOptions> proxies;
+	std::chrono::milliseconds probe_interval{ 5000 };
+};
+
+#endif // !OPTIONS_HPP
@@ -0,0 +1,350 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Connection/Connection.hpp"
+#include "../Dialer/Dialer.hpp"
+#include "../HappyEyeballs/HappyEyeballs.hpp"
+#include "../Loop/Loop.hpp"
+#include "../Options/Options.hpp"
+#include "../ProxySet/ProxySet.hpp"
+
+/// <summary>
+/// Keeps options.connections connections to the server open and spreads calls over them.
+/// Calls wait in one queue until some connection has room in its window, a connection that
+/// breaks fails what it had in flight and is redialed after a jittered exponential backoff.
+/// Everything runs on the loop thread but direct dials, which wait for the resolver and race
+/// the server's addresses on a separate dialer loop and hand the socket back. Proxied dials
+/// don't block anything, the tunnels are brought up by a Dialer on the loop thread, or by a
+/// ProxySet when there is a fleet of proxies to pick from
+/// </summary>
+class Pool
+{
+public:
+	Pool(Loop& loop, Loop& dialer, const Options& options) :
+		loop_(loop), dialer_(dialer), options_(options), tunnels_(loop), proxies_(loop, options.proxies), random_(std::random_device{}())
+	{
+		for (std::size_t i = 0; i < std::max<std::size_t>(options_.connections, 1); ++i)
+			slots_.push_back({ std::make_unique<Connection>(options_) });
+	}
+
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	/// <summary>
+	/// Dials every connection, loop thread only
+	/// </summary>
+	auto Start(void) -> void
+	{
+		if (proxies_.Size())
+			proxies_.Probe(options_.server.address, options_.server.port, options_.probe_interval);
+
+		for (std::size_t i = 0; i < slots_.size(); ++i)
+			this->Dial(i);
+
+		this->Sweep();
+	}
+
+	/// <summary>
+	/// Queues call until a connection has room for it, loop thread only
+	/// </summary>
+	auto Submit(Call&& call) -> void
+	{
+		call.queued = std::chrono::steady_clock::now();
+
+		if (closed_) {
+			Result result;
+			result.error = "client is closed";
+			call.done(std::move(result));
+			return;
+		}
+
+		pending_.push_back(std::move(call));
+		this->Dispatch();
+	}
+
+	/// <summary>
+	/// Dials that haven't started yet are skipped from now on, safe from any thread
+	/// </summary>
+	auto Closing(void) -> void
+	{
+		closing_ = true;
+	}
+
+	/// <summary>
+	/// Fails everything in flight or queued and closes the connections, loop thread only
+	/// </summary>
+	auto Close(void) -> void
+	{
+		closed_ = true;
+		tunnels_.Close();
+		proxies_.Close();
+
+		for (std::size_t i = 0; i < slots_.size(); ++i)
+			this->Drop(i, "client is closed");
+
+		auto pending = std::move(pending_);
+		pending_.clear();
+		for (auto& call : pending) {
+			Result result;
+			result.error = "client is closed";
+			call.done(std::move(result));
+		}
+	}
+
+private:
+	enum class State
+	{
+		kDialing,
+		kReady,
+		kBackoff
+	};
+
+	struct Slot
+	{
+		std::unique_ptr<Connection> connection;
+		State state = State::kDialing;
+		std::uint32_t failures = 0;
+		// bumped whenever the slot is dialed or dropped, late dial results and timers check it
+		std::uint64_t generation = 0;
+	};
+
+	auto Dial(const std::size_t i) -> void
+	{
+		auto& slot = slots_[i];
+		slot.state = State::kDialing;
+		const auto generation = ++slot.generation;
+
+		if (proxies_.Size()) {
+			proxies_.Dial(options_.server.address, options_.server.port, options_.timeout,
+				[this, i, generation](kissnet::tcp_socket&& socket, const std::string& error, const ProxyOptions*) {
+					this->Dialed(i, generation, error.empty(), std::move(socket));
+				});
+			return;
+		}
+
+		if (options_.proxy) {
+			auto chain = options_.via;
+			chain.insert(chain.begin(), *options_.proxy);
+
+			tunnels_.Dial(chain, options_.server.address, options_.server.port, options_.timeout,
+				[this, i, generation](kissnet::tcp_socket&& socket, const std::string& error, const std::vector<std::chrono::microseconds>&) {
+					this->Dialed(i, generation, error.empty(), std::move(socket));
+				});
+			return;
+		}
+
+		dialer_.Post([this, i, generation] {
+			auto socket = std::make_shared<kissnet::tcp_socket>();
+			const auto connected = !closing_ && this->Connect(*socket);
+
+			loop_.Post([this, i, generation, socket, connected] {
+				this->Dialed(i, generation, connected, std::move(*socket));
+				});
+			});
+	}
+
+	/// <summary>
+	/// Connects to the server directly. Runs on the dialer thread, waiting for the resolver is fine here
+	/// </summary>
+	auto Connect(kissnet::tcp_socket& socket) const -> bool
+	{
+		try
+		{
+			std::string error;
+			socket = HappyEyeballs::Connect(options_.server.address, options_.server.port, options_.timeout, error);
+			return socket.is_valid();
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return false;
+		}
+	}
+
+	auto Dialed(const std::size_t i, const std::uint64_t generation, const bool connected, kissnet::tcp_socket&& socket) -> void
+	{
+		auto& slot = slots_[i];
+		if (closed_ || generation != slot.generation)
+			return;
+
+		if (!connected) {
+			this->Retry(i);
+			return;
+		}
+
+		slot.connection->Attach(std::move(socket));
+		if (!loop_.Watch(slot.connection->Handle(), true, false, [this, i](const PollEvent& event) { this->Ready(i, event); })) {
+			slot.connection->Fail("can't watch the connection");
+			this->Retry(i);
+			return;
+		}
+
+		slot.state = State::kReady;
+		slot.failures = 0;
+		this->Dispatch();
+	}
+
+	/// <summary>
+	/// Readiness of a pooled connection
+	/// </summary>
+	auto Ready(const std::size_t i, const PollEvent& event) -> void
+	{
+		auto& connection = *slots_[i].connection;
+
+		if ((event.readable && !connection.Read()) || event.closed || !connection.Flush()) {
+			this->Drop(i, "connection to the server was lost");
+			this->Retry(i);
+			return;
+		}
+
+		loop_.Modify(connection.Handle(), true, connection.Writing());
+
+		// echoes that came in made room in the window
+		if (!pending_.empty())
+			this->Dispatch();
+	}
+
+	/// <summary>
+	/// Hands queued calls to the connections with the most room in their window.
+	/// The framed calls are written once per loop iteration, so a burst goes out in one send
+	/// </summary>
+	auto Dispatch(void) -> void
+	{
+		while (!pending_.empty()) {
+			Slot* best = nullptr;
+			for (auto& slot : slots_) {
+				if (slot.state == State::kReady && slot.connection->Room() && (!best || slot.connection->Room() > best->connection->Room()))
+					best = &slot;
+			}
+
+			if (!best)
+				break;
+
+			best->connection->Send(std::move(pending_.front()));
+			pending_.pop_front();
+		}
+
+		if (flush_posted_)
+			return;
+
+		flush_posted_ = true;
+		loop_.Post([this] {
+			flush_posted_ = false;
+			for (std::size_t i = 0; i < slots_.size(); ++i) {
+				auto& connection = *slots_[i].connection;
+				if (slots_[i].state != State::kReady || !connection.Writing())
+					continue;
+
+				if (!connection.Flush()) {
+					this->Drop(i, "connection to the server was lost");
+					this->Retry(i);
+					continue;
+				}
+
+				loop_.Modify(connection.Handle(), true, connection.Writing());
+			}
+			});
+	}
+
+	/// <summary>
+	/// Fails the calls in flight on the connection and closes it
+	/// </summary>
+	auto Drop(const std::size_t i, const std::string& error) -> void
+	{
+		auto& slot = slots_[i];
+		++slot.generation;
+
+		if (slot.connection->Open())
+			loop_.Forget(slot.connection->Handle());
+
+		slot.connection->Fail(error);
+	}
+
+	/// <summary>
+	/// Redials after backoff_min * 2^failures capped at backoff_max, half fixed and half random
+	/// so connections that broke together don't come back together
+	/// </summary>
+	auto Retry(const std::size_t i) -> void
+	{
+		auto& slot = slots_[i];
+		if (closed_)
+			return;
+
+		slot.state = State::kBackoff;
+		const auto generation = slot.generation;
+		const auto shift = std::min<std::uint32_t>(slot.failures++, 20);
+		const auto ceiling = std::min<std::chrono::milliseconds>(options_.backoff_min * (std::int64_t{ 1 } << shift), options_.backoff_max);
+		const auto delay = ceiling / 2 + std::chrono::milliseconds(std::uniform_int_distribution<std::int64_t>(0, ceiling.count() / 2)(random_));
+
+		if (slot.failures == 3)
+			std::cerr << "Can't reach " << options_.server.address << ':' << options_.server.port << ", retrying" << '\n';
+
+		loop_.After(delay, [this, i, generation] {
+			if (!closed_ && slots_[i].generation == generation && slots_[i].state == State::kBackoff)
+				this->Dial(i);
+			});
+	}
+
+	/// <summary>
+	/// Fails calls whose echo or connection didn't come within the timeout, reschedules itself
+	/// </summary>
+	auto Sweep(void) -> void
+	{
+		if (closed_)
+			return;
+
+		const auto now = std::chrono::steady_clock::now();
+
+		for (std::size_t i = 0; i < slots_.size(); ++i) {
+			const auto oldest = slots_[i].connection->Oldest();
+			if (slots_[i].state != State::kReady || !oldest || now - *oldest < options_.timeout)
+				continue;
+
+			// the echoes that are late would still arrive and be taken for the next calls
+			this->Drop(i, "no echo within the timeout");
+			this->Retry(i);
+		}
+
+		while (!pending_.empty() && now - pending_.front().queued >= options_.timeout) {
+			auto call = std::move(pending_.front());
+			pending_.pop_front();
+
+			Result result;
+			result.error = "no connection had room for the call within the timeout";
+			call.done(std::move(result));
+		}
+
+		const auto interval = std::max<std::chrono::milliseconds>(options_.timeout / 4, std::chrono::milliseconds(1));
+		loop_.After(interval, [this] { this->Sweep(); });
+	}
+
+	Loop& loop_;
+	Loop& dialer_;
+	const Options& options_;
+	Dialer tunnels_;
+	ProxySet proxies_;
+
+	std::vector<Slot> slots_;
+	std::deque<Call> pending_;
+	std::mt19937_64 random_;
+
+	bool flush_posted_ = false;
+	bool closed_ = false;
+	std::atomic<bool> closing_{ false };
+};
+
+#endif // !POOL_HPP
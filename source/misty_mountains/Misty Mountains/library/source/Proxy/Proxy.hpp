@@ -0,0 +1,468 @@
+#ifndef PROXY_HPP
+#define PROXY_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <kissnet.hpp>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include "../Datagram/Datagram.hpp"
+#include "../Handshake/Handshake.hpp"
+#include "../Resolver/Resolver.hpp"
+
+class Proxy
+{
+public:
+	static constexpr auto kConnectTimeout = std::chrono::milliseconds(5000);
+	static constexpr auto kHandshakeTimeout = std::chrono::milliseconds(5000);
+
+	Proxy(void) = default;
+
+	~Proxy(void)
+	{
+		if (udp_ != INVALID_SOCKET)
+			closesocket(udp_);
+	}
+
+	Proxy(const Proxy&) = delete;
+	Proxy& operator=(const Proxy&) = delete;
+
+	auto Initialize(const std::string&& proxy_host, std::string&& proxy_port,
+	                std::string&& dest_host, const uint16_t dest_port, 
+		std::string&& username = "", std::string&& password = "") -> bool
+	{
+		auto status{ false };
+		kissnet::port_t port_t = 0;
+		
+		if (proxy_host.empty() || proxy_port.empty() ||
+			dest_host.empty() || !dest_port)
+			return status;
+
+		try
+		{
+			const auto p = std::stoi(proxy_port, nullptr, 10);
+			port_t = kissnet::port_t(p);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return status;
+		}
+
+		// the socket would run getaddrinfo on its own, hand it the cached address instead
+		const auto resolution = Resolver::Shared().Resolve(proxy_host).get();
+		const auto* address = resolution.First(AF_INET);
+		if (!address) {
+			std::cerr << (resolution.error.empty() ? "No IPv4 address for " + proxy_host : resolution.error) << '\n';
+			return status;
+		}
+
+		endpoint_ = kissnet::endpoint{ address->Text(), port_t };
+		
+		kissnet::tcp_socket s_proxy(endpoint_);
+		
+		s_proxy_ = std::move(s_proxy);
+		if (s_proxy_.is_valid()) {
+			// a proxy that is down must not hold the caller for the OS connect timeout
+			const auto connected = s_proxy_.connect(kConnectTimeout.count());
+			if (connected.value == kissnet::socket_status::valid)
+				status = true;
+			else if (connected.value == kissnet::socket_status::timed_out)
+				std::cerr << "No answer from proxy " << proxy_host << " within " << kConnectTimeout.count() << "ms" << '\n';
+		}
+		
+		this->dest_host_ = dest_host;
+		this->dest_port_ = dest_port;
+
+		this->src_host_ = proxy_host;
+		this->src_port_ = port_t;
+
+		// a SOCKS4 user id or a username without a password counts too, Handshake decides what each protocol sends
+		this->username_ = std::move(username);
+		this->password_ = std::move(password);
+
+		return status;
+	}
+	
+	/// <summary>
+	/// Takes a socket that is connected to the proxy already instead of connecting in Initialize(),
+	/// one end of a socketpair for instance. host:port names the proxy, it is only dialed when a
+	/// pipelined handshake has to be redone step by step
+	/// </summary>
+	auto Attach(kissnet::tcp_socket&& socket, std::string host, const std::uint16_t port,
+		std::string dest_host, const std::uint16_t dest_port, std::string username = {}, std::string password = {}) -> void
+	{
+		s_proxy_ = std::move(socket);
+		endpoint_ = kissnet::endpoint{ host, port };
+
+		this->src_host_ = std::move(host);
+		this->src_port_ = port;
+		this->dest_host_ = std::move(dest_host);
+		this->dest_port_ = dest_port;
+		this->username_ = std::move(username);
+		this->password_ = std::move(password);
+	}
+
+	/// <summary>
+	/// Adds a proxy behind the ones before it: Connect() asks the previous hop for a tunnel to it
+	/// and runs its handshake inside. Call after Initialize(), once per hop in order
+	/// </summary>
+	auto Via(std::string host, const std::uint16_t port, const Protocol type,
+		std::string username = {}, std::string password = {}) -> void
+	{
+		hops_.push_back({ std::move(host), port, type, std::move(username), std::move(password), true });
+	}
+
+	/// <summary>
+	/// Runs the handshakes on the connected proxy socket, the caller's thread waits for them.
+	/// With hops added by Via() each handshake goes through the tunnel the one before built.
+	/// Many tunnels at once go through Dialer instead, which drives the same handshakes from a Loop.
+	/// A pipelined SOCKS5 handshake a hop chokes on is redone step by step on a new connection
+	/// </summary>
+	auto Connect(Protocol type = Protocol::kSocks5) -> bool
+	{
+		if (!s_proxy_.is_valid())
+			return false;
+
+		// the proxy Initialize() connected to goes first
+		std::vector<Hop> chain{ { this->src_host_, this->src_port_, type, this->username_, this->password_, !rejected_ } };
+		chain.insert(chain.end(), hops_.begin(), hops_.end());
+		for (auto& hop : chain)
+			hop.pipelined = hop.pipelined && pipelined_;
+
+		for (;;) {
+			latencies_.clear();
+			std::size_t i = 0;
+			std::string error;
+
+			for (; i < chain.size(); ++i) {
+				const auto last = i + 1 == chain.size();
+				Handshake handshake(chain[i].protocol, last ? this->dest_host_ : chain[i + 1].host, last ? this->dest_port_ : chain[i + 1].port,
+					chain[i].username, chain[i].password);
+				handshake.Pipelined(chain[i].pipelined);
+
+				const auto start = std::chrono::steady_clock::now();
+				const auto progress = this->Run(handshake, chain[i].host);
+				latencies_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
+				if (progress == Progress::kDone)
+					continue;
+
+				if (!handshake.Rejected()) {
+					// a timeout was reported by Run already
+					if (!handshake.Error().empty())
+						std::cerr << handshake.Error() << (chain.size() > 1 ? " (hop " + std::to_string(i + 1) + ')' : "") << '\n';
+					return false;
+				}
+
+				error = handshake.Error();
+				break;
+			}
+
+			if (i == chain.size())
+				return true;
+
+			// this hop is done with pipelining, the chain is built again from the start
+			chain[i].pipelined = false;
+			if (i == 0)
+				rejected_ = true;
+			else
+				hops_[i - 1].pipelined = false;
+
+			s_proxy_ = kissnet::tcp_socket(endpoint_);
+			if (s_proxy_.connect(kConnectTimeout.count()).value != kissnet::socket_status::valid) {
+				std::cerr << error << ", and the proxy can't be reached again to retry" << '\n';
+				return false;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Asks the proxy for a UDP relay (SOCKS5 UDP ASSOCIATE) instead of a tunnel, datagrams to
+	/// the destination then go through SendDatagrams() and answers come from ReceiveDatagrams().
+	/// The relay lives as long as the connection Initialize() made, which is kept open for it.
+	/// A chain can't carry datagrams, only the first proxy is used
+	/// </summary>
+	auto Associate(Protocol type = Protocol::kSocks5) -> bool
+	{
+		if (!s_proxy_.is_valid())
+			return false;
+
+		if (type != Protocol::kSocks5 || !hops_.empty()) {
+			std::cerr << "Only a single SOCKS5 proxy relays UDP" << '\n';
+			return false;
+		}
+
+		udp_header_ = Datagrams::Header(this->dest_host_, this->dest_port_);
+		if (udp_header_.empty()) {
+			std::cerr << "SOCKS5 can't carry the name " << this->dest_host_ << '\n';
+			return false;
+		}
+
+		// the proxy is told where the datagrams will come from, so it relays nobody else's
+		sockaddr_storage local{};
+		socklen_t length = sizeof local;
+		getsockname(s_proxy_.get_handle(), reinterpret_cast<sockaddr*>(&local), &length);
+		if (local.ss_family == AF_INET6)
+			reinterpret_cast<sockaddr_in6*>(&local)->sin6_port = 0;
+		else
+			reinterpret_cast<sockaddr_in*>(&local)->sin_port = 0;
+
+		udp_ = ::socket(local.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+		if (udp_ == INVALID_SOCKET || ::bind(udp_, reinterpret_cast<const sockaddr*>(&local), length) != 0 ||
+			getsockname(udp_, reinterpret_cast<sockaddr*>(&local), &length) != 0) {
+			std::cerr << "Can't open a UDP socket for the relay, error " << LastError() << '\n';
+			return false;
+		}
+
+		// the relay and the datagrams are in the family of the connection, as the server does it
+		const auto v6 = local.ss_family == AF_INET6;
+		const auto* from4 = reinterpret_cast<const sockaddr_in*>(&local);
+		const auto* from6 = reinterpret_cast<const sockaddr_in6*>(&local);
+		char text[INET6_ADDRSTRLEN]{};
+		inet_ntop(local.ss_family, v6 ? static_cast<const void*>(&from6->sin6_addr) : static_cast<const void*>(&from4->sin_addr), text, sizeof text);
+		const auto from_port = ntohs(v6 ? from6->sin6_port : from4->sin_port);
+
+		for (;;) {
+			Handshake handshake(Protocol::kSocks5, text, from_port, this->username_, this->password_);
+			handshake.Associate();
+			handshake.Pipelined(pipelined_ && !rejected_);
+
+			const auto start = std::chrono::steady_clock::now();
+			const auto progress = this->Run(handshake, this->src_host_);
+			latencies_ = { std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start) };
+
+			if (progress == Progress::kDone) {
+				// a relay that says 0.0.0.0 or :: listens on the proxy's own address
+				auto host = handshake.BoundHost();
+				if (host.empty() || host == "0.0.0.0" || host == "::")
+					host = endpoint_.address;
+				return this->Relay(host, handshake.BoundPort(), local.ss_family);
+			}
+
+			if (!handshake.Rejected() || rejected_) {
+				if (!handshake.Error().empty())
+					std::cerr << handshake.Error() << '\n';
+				return false;
+			}
+
+			rejected_ = true;
+			s_proxy_ = kissnet::tcp_socket(endpoint_);
+			if (s_proxy_.connect(kConnectTimeout.count()).value != kissnet::socket_status::valid) {
+				std::cerr << handshake.Error() << ", and the proxy can't be reached again to retry" << '\n';
+				return false;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Sends a batch of datagrams to the destination through the relay. Each one gets the
+	/// SOCKS5 header written into the Datagrams::kHeadroom bytes in front of it. How many went
+	/// out, the ones that didn't carry their header already and have to be built again
+	/// </summary>
+	auto SendDatagrams(Datagram* batch, const std::size_t count) -> std::size_t
+	{
+		for (std::size_t i = 0; i < count; ++i) {
+			Datagrams::Wrap(batch[i], udp_header_);
+			batch[i].length = 0;
+		}
+
+		return Datagrams::Send(udp_, batch, count);
+	}
+
+	/// <summary>
+	/// Receives a batch of answers from the relay with their headers taken off, see Datagrams::Receive.
+	/// Datagrams the relay garbled are dropped
+	/// </summary>
+	auto ReceiveDatagrams(Datagram* batch, const std::size_t count, std::byte* buffer, const std::size_t slot) -> std::int64_t
+	{
+		const auto received = Datagrams::Receive(udp_, batch, count, buffer, slot);
+
+		std::int64_t kept = 0;
+		DatagramTarget target;
+		for (std::int64_t i = 0; i < received; ++i) {
+			if (Datagrams::Unwrap(batch[i], target))
+				batch[kept++] = batch[i];
+		}
+
+		return received < 0 ? received : kept;
+	}
+
+	/// <summary>
+	/// The socket of the relay, to wait for datagrams on
+	/// </summary>
+	auto Udp(void) const -> SOCKET
+	{
+		return udp_;
+	}
+
+	/// <summary>
+	/// How long each hop's handshake took in the last Connect(), to find the slow link of a chain
+	/// </summary>
+	auto Latencies(void) const -> const std::vector<std::chrono::microseconds>&
+	{
+		return latencies_;
+	}
+
+	/// <summary>
+	/// SOCKS5 without credentials sends the greeting and the request together, one round trip
+	/// less. On by default for every hop, Connect() turns it off for good for a hop that rejected it
+	/// </summary>
+	auto Pipelined(const bool enable) -> void
+	{
+		pipelined_ = enable;
+	}
+
+	auto Pipelined(void) const -> bool
+	{
+		// credentials have to wait for the method reply
+		return pipelined_ && !rejected_ && username_.empty();
+	}
+
+	auto get(void) -> kissnet::tcp_socket*
+	{
+		return &this->s_proxy_;
+	}
+
+	template <size_t buff_size>
+	auto send(const kissnet::buffer<buff_size>& buff, const size_t length = buff_size) -> std::tuple<size_t, kissnet::socket_status>
+	{
+		return this->s_proxy_.send(buff, length);
+	}
+
+	auto send(const std::byte* read_buff, size_t length) -> std::tuple<size_t, kissnet::socket_status>
+	{
+		return this->s_proxy_.send(read_buff, length);
+	}
+
+	template <size_t buff_size>
+	auto recv(kissnet::buffer<buff_size>& write_buff, size_t start_offset = 0) -> std::tuple<size_t, kissnet::socket_status>
+	{
+		return this->s_proxy_.recv(write_buff, start_offset);
+	}
+
+	auto recv(std::byte* buffer, size_t len, bool wait = true) -> std::tuple<size_t, kissnet::socket_status>
+	{
+		return this->s_proxy_.recv(buffer, len, wait);
+	}
+
+private:
+	struct Hop
+	{
+		std::string host;
+		std::uint16_t port;
+		Protocol protocol;
+		std::string username;
+		std::string password;
+		bool pipelined;
+	};
+
+	auto Run(Handshake& handshake, const std::string& name) -> Progress
+	{
+		const auto fd = s_proxy_.get_handle();
+		const auto deadline = std::chrono::steady_clock::now() + kHandshakeTimeout;
+
+		s_proxy_.set_non_blocking(true);
+		auto progress = handshake.Advance(fd);
+		while (progress == Progress::kRead || progress == Progress::kWrite) {
+			if (!Wait(fd, progress, deadline)) {
+				std::cerr << "No handshake with proxy " << name << " within " << kHandshakeTimeout.count() << "ms" << '\n';
+				progress = Progress::kFailed;
+				break;
+			}
+			progress = handshake.Advance(fd);
+		}
+		s_proxy_.set_non_blocking(false);
+
+		return progress;
+	}
+
+	/// <summary>
+	/// Connects the UDP socket to the relay at host:port, it then only hears from the relay.
+	/// The relay has to be in the family of the socket, the proxy only knows the datagrams'
+	/// source address in that one
+	/// </summary>
+	auto Relay(const std::string& host, const std::uint16_t port, const int family) -> bool
+	{
+		sockaddr_storage relay{};
+		socklen_t length = 0;
+		auto* relay4 = reinterpret_cast<sockaddr_in*>(&relay);
+		auto* relay6 = reinterpret_cast<sockaddr_in6*>(&relay);
+		if (inet_pton(AF_INET, host.c_str(), &relay4->sin_addr) == 1) {
+			relay4->sin_family = AF_INET;
+			relay4->sin_port = htons(port);
+			length = sizeof(sockaddr_in);
+		}
+		else if (inet_pton(AF_INET6, host.c_str(), &relay6->sin6_addr) == 1) {
+			relay6->sin6_family = AF_INET6;
+			relay6->sin6_port = htons(port);
+			length = sizeof(sockaddr_in6);
+		}
+		else {
+			std::cerr << "The proxy's UDP relay is at " << host << ", not an IP address" << '\n';
+			return false;
+		}
+
+		if (relay.ss_family != family) {
+			std::cerr << "The proxy's UDP relay is at " << host << ", but the connection to the proxy is over IPv" <<
+				(family == AF_INET6 ? '6' : '4') << '\n';
+			return false;
+		}
+
+		if (::connect(udp_, reinterpret_cast<const sockaddr*>(&relay), length) != 0) {
+			std::cerr << "Can't reach the proxy's UDP relay at " << host << ':' << port << ", error " << LastError() << '\n';
+			return false;
+		}
+
+		SetNonBlocking(udp_);
+		return true;
+	}
+
+	/// <summary>
+	/// Waits until fd is ready for what the handshake asked for, false once the deadline passed
+	/// </summary>
+	static auto Wait(SOCKET fd, const Progress progress, const std::chrono::steady_clock::time_point deadline) -> bool
+	{
+		const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (left <= 0)
+			return false;
+
+		pollfd ready{};
+		ready.fd = fd;
+		ready.events = progress == Progress::kWrite ? POLLOUT : POLLIN;
+#ifdef _WIN32
+		return WSAPoll(&ready, 1, static_cast<int>(left)) > 0;
+#else
+		return ::poll(&ready, 1, static_cast<int>(left)) > 0;
+#endif
+	}
+
+private:
+	kissnet::tcp_socket s_proxy_;
+	kissnet::endpoint endpoint_;
+	bool pipelined_ = true;
+	bool rejected_ = false;
+
+	std::string src_host_;
+	uint16_t src_port_{};
+	
+	std::string dest_host_;
+	uint16_t dest_port_{};
+
+	std::string username_;
+	std::string password_;
+
+	std::vector<Hop> hops_;
+	std::vector<std::chrono::microseconds> latencies_;
+
+	// UDP ASSOCIATE: the socket to the relay and the header every datagram carries
+	SOCKET udp_ = INVALID_SOCKET;
+	std::string udp_header_;
+};
+
+#endif // !PROXY_HPP
@@ -0,0 +1,340 @@
+#ifndef PROXY_SET_HPP
+#define PROXY_SET_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Dialer/Dialer.hpp"
+#include "../Loop/Loop.hpp"
+#include "../Options/Options.hpp"
+
+/// <summary>
+/// A fleet of interchangeable proxies. Every tunnel goes through the better of two proxies
+/// picked at random (power of two choices), judged by an EWMA of their handshake latency
+/// and the tunnels they have in progress. A tunnel that isn't up after the p95 of recent
+/// setups is hedged: a second proxy is raced and whichever finishes first is used. Probes
+/// tunnel through every proxy in the background, proxies that keep failing are left out
+/// until they answer again. Loop thread only
+/// </summary>
+class ProxySet
+{
+public:
+	/// <summary>
+	/// Gets the tunnel in non-blocking mode and the proxy it goes through, or an invalid socket and why
+	/// </summary>
+	using Done = std::function<void(kissnet::tcp_socket&& socket, const std::string& error, const ProxyOptions* proxy)>;
+
+	static constexpr double kAlpha = 0.2;
+	static constexpr std::uint32_t kUnhealthyAfter = 2;
+	// the hedge waits this long until enough setups were seen for a p95
+	static constexpr auto kHedgeDelay = std::chrono::milliseconds(100);
+	static constexpr auto kMinHedgeDelay = std::chrono::milliseconds(1);
+	static constexpr std::size_t kMinSamples = 20;
+
+	ProxySet(Loop& loop, std::vector<ProxyOptions> proxies) :
+		loop_(loop), dialer_(loop), random_(std::random_device{}()), self_(std::make_shared<ProxySet*>(this))
+	{
+		for (auto& proxy : proxies)
+			members_.push_back({ std::move(proxy) });
+	}
+
+	ProxySet(const ProxySet&) = delete;
+	ProxySet& operator=(const ProxySet&) = delete;
+
+	/// <summary>
+	/// Tunnels through every proxy to host:port now and then every interval, the tunnels are closed right away
+	/// </summary>
+	auto Probe(const std::string& host, const std::uint16_t port, const std::chrono::milliseconds interval) -> void
+	{
+		if (closed_)
+			return;
+
+		for (std::size_t i = 0; i < members_.size(); ++i) {
+			if (members_[i].probing)
+				continue;
+
+			members_[i].probing = true;
+			const auto start = std::chrono::steady_clock::now();
+			dialer_.Dial(members_[i].proxy, host, port, interval,
+				[this, i, start](kissnet::tcp_socket&&, const std::string& error, const std::vector<std::chrono::microseconds>& latencies) {
+					members_[i].probing = false;
+					this->Record(i, error.empty(), latencies, std::chrono::steady_clock::now() - start);
+				});
+		}
+
+		loop_.After(interval, [self = std::weak_ptr<ProxySet*>(self_), host, port, interval] {
+			if (const auto set = self.lock())
+				(*set)->Probe(host, port, interval);
+			});
+	}
+
+	/// <summary>
+	/// Tunnels to host:port through the set, done is called on the loop thread within timeout
+	/// (plus the hedge delay when the first proxy failed late)
+	/// </summary>
+	auto Dial(const std::string& host, const std::uint16_t port, const std::chrono::milliseconds timeout, Done done) -> void
+	{
+		const auto first = this->Pick(kNone);
+		if (closed_ || first == kNone) {
+			done({}, closed_ ? "proxy set is closed" : "no proxy to tunnel through", nullptr);
+			return;
+		}
+
+		auto race = std::make_shared<Race>();
+		race->done = std::move(done);
+		race->first = first;
+		race->start = std::chrono::steady_clock::now();
+
+		this->Launch(race, first, host, port, timeout);
+
+		if (!race->finished && !race->hedged)
+			loop_.After(this->HedgeDelay(), [self = std::weak_ptr<ProxySet*>(self_), race, host, port, timeout] {
+				const auto set = self.lock();
+				if (!set || race->finished || race->hedged)
+					return;
+
+				// closed while the first proxy was still at it, nothing is raced anymore
+				if ((*set)->closed_) {
+					race->finished = true;
+					race->done({}, "proxy set is closed", nullptr);
+					return;
+				}
+
+				(*set)->Hedge(race, host, port, timeout);
+				});
+	}
+
+	/// <summary>
+	/// Gives up on the tunnels and probes in progress
+	/// </summary>
+	auto Close(void) -> void
+	{
+		closed_ = true;
+		dialer_.Close();
+	}
+
+	/// <summary>
+	/// How long the first proxy gets before a second one is raced: the p95 of recent setups
+	/// </summary>
+	auto HedgeDelay(void) const -> std::chrono::milliseconds
+	{
+		if (samples_ < kMinSamples)
+			return kHedgeDelay;
+
+		const auto count = std::min(samples_, setups_.size());
+		std::vector<std::chrono::microseconds> recent(setups_.begin(), setups_.begin() + static_cast<std::ptrdiff_t>(count));
+		const auto p95 = recent.begin() + static_cast<std::ptrdiff_t>(count * 95 / 100);
+		std::nth_element(recent.begin(), p95, recent.end());
+
+		return std::max<std::chrono::milliseconds>(std::chrono::ceil<std::chrono::milliseconds>(*p95), kMinHedgeDelay);
+	}
+
+	/// <summary>
+	/// Handshake latency EWMA of proxy i, zero until it was measured
+	/// </summary>
+	auto Latency(const std::size_t i) const -> std::chrono::microseconds
+	{
+		return std::chrono::microseconds(static_cast<std::int64_t>(members_[i].ewma));
+	}
+
+	auto Healthy(const std::size_t i) const -> bool
+	{
+		return members_[i].failures < kUnhealthyAfter;
+	}
+
+	/// <summary>
+	/// Tunnels that were hedged so far, and how many of those the second proxy won
+	/// </summary>
+	auto Hedged(void) const -> std::uint64_t
+	{
+		return hedged_;
+	}
+
+	auto HedgesWon(void) const -> std::uint64_t
+	{
+		return hedges_won_;
+	}
+
+	auto Size(void) const -> std::size_t
+	{
+		return members_.size();
+	}
+
+private:
+	static constexpr auto kNone = static_cast<std::size_t>(-1);
+
+	struct Member
+	{
+		ProxyOptions proxy;
+		double ewma = 0.0;
+		std::uint32_t failures = 0;
+		std::size_t outstanding = 0;
+		bool probing = false;
+	};
+
+	/// <summary>
+	/// One tunnel, raced over up to two proxies
+	/// </summary>
+	struct Race
+	{
+		Done done;
+		std::size_t first = kNone;
+		std::size_t running = 0;
+		bool hedged = false;
+		bool finished = false;
+		std::string error;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	auto Launch(const std::shared_ptr<Race>& race, const std::size_t i, const std::string& host, const std::uint16_t port,
+		const std::chrono::milliseconds timeout) -> void
+	{
+		++race->running;
+		++members_[i].outstanding;
+		const auto start = std::chrono::steady_clock::now();
+
+		dialer_.Dial(members_[i].proxy, host, port, timeout,
+			[this, race, i, start, host, port, timeout](kissnet::tcp_socket&& socket, const std::string& error, const std::vector<std::chrono::microseconds>& latencies) {
+				--race->running;
+				--members_[i].outstanding;
+				if (!closed_)
+					this->Record(i, error.empty(), latencies, std::chrono::steady_clock::now() - start);
+
+				// the loser's tunnel is closed as it goes out of scope
+				if (race->finished)
+					return;
+
+				if (error.empty()) {
+					race->finished = true;
+					if (i != race->first)
+						++hedges_won_;
+					race->done(std::move(socket), {}, &members_[i].proxy);
+					return;
+				}
+
+				race->error = error;
+				// the first one failed before its time was up, the second doesn't have to wait
+				if (!race->hedged && !closed_) {
+					const auto left = timeout - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - race->start);
+					this->Hedge(race, host, port, std::max(left, std::chrono::milliseconds(1)));
+					return;
+				}
+
+				if (!race->running) {
+					race->finished = true;
+					race->done({}, closed_ ? "proxy set is closed" : race->error, nullptr);
+				}
+			});
+	}
+
+	/// <summary>
+	/// Races a second proxy, or gives up if there is none and nothing is running anymore
+	/// </summary>
+	auto Hedge(const std::shared_ptr<Race>& race, const std::string& host, const std::uint16_t port, const std::chrono::milliseconds timeout) -> void
+	{
+		race->hedged = true;
+
+		const auto second = this->Pick(race->first);
+		if (second == kNone) {
+			if (!race->running) {
+				race->finished = true;
+				race->done({}, race->error, nullptr);
+			}
+			return;
+		}
+
+		++hedged_;
+		this->Launch(race, second, host, port, timeout);
+	}
+
+	/// <summary>
+	/// The better of two random proxies other than exclude, healthy ones first
+	/// </summary>
+	auto Pick(const std::size_t exclude) -> std::size_t
+	{
+		std::vector<std::size_t> candidates;
+		for (std::size_t i = 0; i < members_.size(); ++i) {
+			if (i != exclude && this->Healthy(i))
+				candidates.push_back(i);
+		}
+
+		// nothing answers the probes, trying one anyway beats failing right away
+		if (candidates.empty()) {
+			for (std::size_t i = 0; i < members_.size(); ++i) {
+				if (i != exclude)
+					candidates.push_back(i);
+			}
+		}
+
+		if (candidates.empty())
+			return kNone;
+		if (candidates.size() == 1)
+			return candidates.front();
+
+		std::uniform_int_distribution<std::size_t> pick(0, candidates.size() - 1);
+		const auto a = candidates[pick(random_)];
+		auto b = candidates[pick(random_)];
+		while (b == a)
+			b = candidates[pick(random_)];
+
+		return this->Cost(a) <= this->Cost(b) ? a : b;
+	}
+
+	/// <summary>
+	/// Expected wait behind a proxy: its latency, scaled by the tunnels it is setting up already.
+	/// Unmeasured proxies cost least and get measured
+	/// </summary>
+	auto Cost(const std::size_t i) const -> double
+	{
+		return (members_[i].ewma + 1.0) * static_cast<double>(members_[i].outstanding + 1);
+	}
+
+	auto Record(const std::size_t i, const bool success, const std::vector<std::chrono::microseconds>& latencies,
+		const std::chrono::steady_clock::duration setup) -> void
+	{
+		auto& member = members_[i];
+		if (!success) {
+			++member.failures;
+			return;
+		}
+
+		member.failures = 0;
+
+		std::chrono::microseconds handshake{};
+		for (const auto& latency : latencies)
+			handshake += latency;
+
+		const auto sample = static_cast<double>(handshake.count());
+		member.ewma = member.ewma == 0.0 ? sample : member.ewma + kAlpha * (sample - member.ewma);
+
+		setups_[samples_++ % setups_.size()] = std::chrono::duration_cast<std::chrono::microseconds>(setup);
+	}
+
+	Loop& loop_;
+	Dialer dialer_;
+	std::vector<Member> members_;
+	std::mt19937_64 random_;
+
+	// connect plus handshake of the last tunnels and probes, for the hedge delay
+	std::array<std::chrono::microseconds, 128> setups_{};
+	std::size_t samples_ = 0;
+
+	std::uint64_t hedged_ = 0;
+	std::uint64_t hedges_won_ = 0;
+	bool closed_ = false;
+	// the loop's timers only hold it weakly, the ones still queued when the set goes find it expired
+	std::shared_ptr<ProxySet*> self_;
+};
+
+#endif // !PROXY_SET_HPP
@@ -0,0 +1,278 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include <kissnet.hpp>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#elif !defined(_WIN32)
+#include <poll.h>
+#endif
+
+/// <summary>
+/// Readiness reported by Poller::Wait
+/// </summary>
+struct PollEvent
+{
+	SOCKET fd;
+	bool readable;
+	bool writable;
+	bool closed;
+};
+
+/// <summary>
+/// Last socket error. On Windows kissnet only posixifies the would-block, bad handle and
+/// interrupted codes, the WSA codes compared against elsewhere are mapped here
+/// </summary>
+inline auto LastError(void) -> int
+{
+#ifdef _WIN32
+	const auto error = kissnet::get_error_code();
+	switch (error) {
+	case WSAECONNABORTED:
+		return ECONNABORTED;
+	case WSAECONNRESET:
+		return ECONNRESET;
+	case WSAECONNREFUSED:
+		return ECONNREFUSED;
+	case WSAENETUNREACH:
+		return ENETUNREACH;
+	case WSAEHOSTUNREACH:
+		return EHOSTUNREACH;
+	case WSAETIMEDOUT:
+		return ETIMEDOUT;
+	case WSAEINPROGRESS:
+		return EINPROGRESS;
+	case WSAEMFILE:
+		return EMFILE;
+	case WSAENOBUFS:
+		return ENOBUFS;
+	default:
+		return error;
+	}
+#else
+	return errno;
+#endif
+}
+
+/// <summary>
+/// Puts a raw socket into non-blocking mode
+/// </summary>
+inline auto SetNonBlocking(SOCKET fd) -> bool
+{
+#ifdef _WIN32
+	ioctl_setting set = 1;
+	return ioctlsocket(fd, FIONBIO, &set) == 0;
+#else
+	const auto flags = fcntl(fd, F_GETFL, 0);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/// <summary>
+/// Readiness notification: epoll on linux, (WSA)poll everywhere else
+/// </summary>
+class Poller
+{
+public:
+	Poller(void)
+	{
+#ifdef __linux__
+		epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+#endif
+	}
+
+	~Poller(void)
+	{
+#ifdef __linux__
+		if (epoll_fd_ >= 0)
+			::close(epoll_fd_);
+#endif
+	}
+
+	Poller(const Poller&) = delete;
+	Poller& operator=(const Poller&) = delete;
+
+	auto Add(SOCKET fd, bool read = true, bool write = false) -> bool
+	{
+#ifdef __linux__
+		auto ev = Mask(fd, read, write);
+		return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+#else
+		index_[fd] = fds_.size();
+		fds_.push_back({ fd, Mask(read, write), 0 });
+		return true;
+#endif
+	}
+
+	auto Modify(SOCKET fd, bool read, bool write) -> bool
+	{
+#ifdef __linux__
+		auto ev = Mask(fd, read, write);
+		return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+#else
+		const auto it = index_.find(fd);
+		if (it == index_.end())
+			return false;
+
+		fds_[it->second].events = Mask(read, write);
+		return true;
+#endif
+	}
+
+	auto Remove(SOCKET fd) -> void
+	{
+#ifdef __linux__
+		epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+#else
+		const auto it = index_.find(fd);
+		if (it == index_.end())
+			return;
+
+		// swap with the last entry to keep the array dense
+		const auto slot = it->second;
+		index_.erase(it);
+		if (slot != fds_.size() - 1) {
+			fds_[slot] = fds_.back();
+			index_[fds_[slot].fd] = slot;
+		}
+		fds_.pop_back();
+#endif
+	}
+
+	/// <summary>
+	/// Waits up to timeout_ms (-1 = forever), fills events and returns their count
+	/// </summary>
+	auto Wait(std::vector<PollEvent>& events, int timeout_ms) -> int
+	{
+		events.clear();
+#ifdef __linux__
+		epoll_event ready[kMaxEvents];
+		const auto count = epoll_wait(epoll_fd_, ready, kMaxEvents, timeout_ms);
+
+		for (auto i = 0; i < count; ++i) {
+			const auto mask = ready[i].events;
+			events.push_back({ ready[i].data.fd,
+				(mask & (EPOLLIN | EPOLLRDHUP)) != 0,
+				(mask & EPOLLOUT) != 0,
+				(mask & (EPOLLERR | EPOLLHUP)) != 0 });
+		}
+#else
+#ifdef _WIN32
+		const auto count = WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+#else
+		const auto count = ::poll(fds_.data(), fds_.size(), timeout_ms);
+#endif
+		for (const auto& entry : fds_) {
+			if (!entry.revents)
+				continue;
+
+			events.push_back({ entry.fd,
+				(entry.revents & POLLIN) != 0,
+				(entry.revents & POLLOUT) != 0,
+				(entry.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 });
+		}
+#endif
+		return count < 0 ? 0 : static_cast<int>(events.size());
+	}
+
+private:
+#ifdef __linux__
+	static constexpr auto kMaxEvents = 256;
+
+	static auto Mask(SOCKET fd, bool read, bool write) -> epoll_event
+	{
+		epoll_event ev{};
+		ev.events = (read ? EPOLLIN | EPOLLRDHUP : 0u) | (write ? EPOLLOUT : 0u);
+		ev.data.fd = fd;
+		return ev;
+	}
+
+	int epoll_fd_ = -1;
+#else
+	static auto Mask(bool read, bool write) -> short
+	{
+		return static_cast<short>((read ? POLLIN : 0) | (write ? POLLOUT : 0));
+	}
+
+	std::vector<pollfd> fds_;
+	std::unordered_map<SOCKET, std::size_t> index_;
+#endif
+};
+
+/// <summary>
+/// Cross-thread wakeup for a Poller: an eventfd on linux,
+/// a self-connected loopback UDP socket everywhere else
+/// </summary>
+class Notifier
+{
+public:
+	Notifier(void)
+	{
+#ifdef __linux__
+		fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+		udp_ = kissnet::udp_socket({ "127.0.0.1", 0 });
+		udp_.bind();
+
+		sockaddr_storage self{};
+		socklen_t self_len = sizeof self;
+		fd_ = udp_.get_handle();
+		getsockname(fd_, reinterpret_cast<sockaddr*>(&self), &self_len);
+		::connect(fd_, reinterpret_cast<sockaddr*>(&self), self_len);
+		SetNonBlocking(fd_);
+#endif
+	}
+
+	~Notifier(void)
+	{
+#ifdef __linux__
+		if (fd_ >= 0)
+			::close(fd_);
+#endif
+	}
+
+	Notifier(const Notifier&) = delete;
+	Notifier& operator=(const Notifier&) = delete;
+
+	auto Handle(void) const -> SOCKET
+	{
+		return fd_;
+	}
+
+	auto Notify(void) -> void
+	{
+#ifdef __linux__
+		const std::uint64_t one = 1;
+		[[maybe_unused]] const auto written = ::write(fd_, &one, sizeof one);
+#else
+		const char one = 1;
+		::send(fd_, &one, 1, 0);
+#endif
+	}
+
+	auto Drain(void) -> void
+	{
+#ifdef __linux__
+		std::uint64_t value;
+		[[maybe_unused]] const auto read = ::read(fd_, &value, sizeof value);
+#else
+		char sink[64];
+		while (::recv(fd_, sink, sizeof sink, 0) > 0) {}
+#endif
+	}
+
+private:
+	SOCKET fd_ = INVALID_SOCKET;
+#ifndef __linux__
+	kissnet::udp_socket udp_;
+#endif
+};
+
+#endif // !REACTOR_HPP
@@ -0,0 +1,366 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <kissnet.hpp>
+
+/// <summary>
+/// One resolved address, port left at 0
+/// </summary>
+struct Address
+{
+	sockaddr_storage storage{};
+	socklen_t length = 0;
+
+	auto Family(void) const -> int
+	{
+		return storage.ss_family;
+	}
+
+	/// <summary>
+	/// Numeric form, kissnet sockets built from it don't go through DNS again
+	/// </summary>
+	auto Text(void) const -> std::string
+	{
+		char buffer[INET6_ADDRSTRLEN]{};
+		const auto* data = this->Family() == AF_INET6 ?
+			static_cast<const void*>(&reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_addr) :
+			static_cast<const void*>(&reinterpret_cast<const sockaddr_in*>(&storage)->sin_addr);
+
+		return inet_ntop(this->Family(), const_cast<void*>(data), buffer, sizeof buffer) ? buffer : "";
+	}
+};
+
+/// <summary>
+/// Addresses of a name in the order getaddrinfo (or the hosts file) gave them, or why there are none
+/// </summary>
+struct Resolution
+{
+	std::vector<Address> addresses;
+	std::string error;
+
+	explicit operator bool(void) const
+	{
+		return !addresses.empty();
+	}
+
+	/// <summary>
+	/// First address of the family, nullptr if there is none
+	/// </summary>
+	auto First(const int family) const -> const Address*
+	{
+		const auto it = std::find_if(addresses.begin(), addresses.end(), [family](const Address& address) { return address.Family() == family; });
+		return it == addresses.end() ? nullptr : &*it;
+	}
+};
+
+/// <summary>
+/// Asynchronous name resolution shared by everything that connects somewhere.
+/// getaddrinfo blocks, so it runs on a small pool of threads; answers are cached,
+/// failures too (for a shorter time), and concurrent lookups of one name share a
+/// single getaddrinfo call. Numeric addresses never leave the calling thread and
+/// names loaded with Hosts() are answered from the file, for offline tests
+/// </summary>
+class Resolver
+{
+public:
+	using Callback = std::function<void(const Resolution&)>;
+
+	// getaddrinfo doesn't report the record's TTL, answers are kept this long instead
+	static constexpr auto kTtl = std::chrono::seconds(60);
+	static constexpr auto kNegativeTtl = std::chrono::seconds(5);
+	static constexpr std::size_t kMaxEntries = 4096;
+
+	explicit Resolver(const std::size_t threads = 2)
+	{
+		for (std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i)
+			threads_.emplace_back([this] { this->Run(); });
+	}
+
+	~Resolver(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			running_ = false;
+		}
+		wake_.notify_all();
+
+		for (auto& thread : threads_)
+			thread.join();
+	}
+
+	Resolver(const Resolver&) = delete;
+	Resolver& operator=(const Resolver&) = delete;
+
+	/// <summary>
+	/// The process wide resolver
+	/// </summary>
+	static auto Shared(void) -> Resolver&
+	{
+		static Resolver resolver;
+		return resolver;
+	}
+
+	/// <summary>
+	/// Loads a hosts file ("address name [alias...]" per line, # comments), its names never go to DNS
+	/// </summary>
+	auto Hosts(const std::string& path) -> bool
+	{
+		std::ifstream file(path);
+		if (!file) {
+			std::cerr << "Can't open hosts file " << path << '\n';
+			return false;
+		}
+
+		std::unordered_map<std::string, Resolution> hosts;
+		std::string line;
+		while (std::getline(file, line)) {
+			line = line.substr(0, line.find('#'));
+			std::istringstream fields(line);
+
+			std::string text;
+			if (!(fields >> text))
+				continue;
+
+			Address address;
+			if (!Numeric(text, address)) {
+				std::cerr << "Ignoring hosts entry with a bad address: " << text << '\n';
+				continue;
+			}
+
+			for (std::string name; fields >> name;)
+				hosts[Lower(name)].addresses.push_back(address);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		hosts_ = std::move(hosts);
+		cache_.clear();
+		return true;
+	}
+
+	/// <summary>
+	/// Calls done with the addresses of host, right away if they are known, otherwise
+	/// from a resolver thread. done must not block
+	/// </summary>
+	auto Resolve(const std::string& host, Callback done) -> void
+	{
+		Resolution resolution;
+		if (Numeric(host, resolution)) {
+			done(resolution);
+			return;
+		}
+
+		const auto name = Lower(host);
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+
+			if (const auto it = hosts_.find(name); it != hosts_.end()) {
+				resolution = it->second;
+				lock.unlock();
+				done(resolution);
+				return;
+			}
+
+			if (const auto it = cache_.find(name); it != cache_.end() && it->second.expires > std::chrono::steady_clock::now()) {
+				resolution = it->second.resolution;
+				lock.unlock();
+				done(resolution);
+				return;
+			}
+
+			// somebody is already asking for this name, wait for the same answer
+			auto& waiting = waiting_[name];
+			waiting.push_back(std::move(done));
+			if (waiting.size() > 1)
+				return;
+
+			queue_.push_back(name);
+		}
+
+		wake_.notify_one();
+	}
+
+	auto Resolve(const std::string& host) -> std::future<Resolution>
+	{
+		auto promise = std::make_shared<std::promise<Resolution>>();
+		auto future = promise->get_future();
+
+		this->Resolve(host, [promise](const Resolution& resolution) {
+			promise->set_value(resolution);
+			});
+
+		return future;
+	}
+
+private:
+	struct Entry
+	{
+		Resolution resolution;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+	auto Run(void) -> void
+	{
+		for (;;) {
+			std::string name;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+				if (!running_)
+					return;
+
+				name = std::move(queue_.front());
+				queue_.pop_front();
+			}
+
+			const auto resolution = Lookup(name);
+
+			std::vector<Callback> waiting;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				this->Store(name, resolution);
+
+				const auto it = waiting_.find(name);
+				if (it != waiting_.end()) {
+					waiting = std::move(it->second);
+					waiting_.erase(it);
+				}
+			}
+
+			for (auto& done : waiting)
+				done(resolution);
+		}
+	}
+
+	/// <summary>
+	/// Caches an answer, mutex_ held
+	/// </summary>
+	auto Store(const std::string& name, const Resolution& resolution) -> void
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		if (cache_.size() >= kMaxEntries) {
+			for (auto it = cache_.begin(); it != cache_.end();)
+				it = it->second.expires <= now ? cache_.erase(it) : std::next(it);
+
+			if (cache_.size() >= kMaxEntries)
+				cache_.clear();
+		}
+
+		cache_[name] = { resolution, now + (resolution ? std::chrono::steady_clock::duration(kTtl) : kNegativeTtl) };
+	}
+
+	static auto Lookup(const std::string& name) -> Resolution
+	{
+		Resolution resolution;
+
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_ADDRCONFIG;
+
+		addrinfo* results = nullptr;
+		const auto error = getaddrinfo(name.c_str(), nullptr, &hints, &results);
+		if (error != 0) {
+#ifdef _WIN32
+			resolution.error = "can't resolve " + name + ", error " + std::to_string(error);
+#else
+			resolution.error = "can't resolve " + name + ": " + gai_strerror(error);
+#endif
+			return resolution;
+		}
+
+		for (auto* result = results; result; result = result->ai_next) {
+			if (result->ai_family != AF_INET && result->ai_family != AF_INET6)
+				continue;
+
+			Address address;
+			std::memcpy(&address.storage, result->ai_addr, result->ai_addrlen);
+			address.length = static_cast<socklen_t>(result->ai_addrlen);
+			resolution.addresses.push_back(address);
+		}
+
+		freeaddrinfo(results);
+
+		if (resolution.addresses.empty())
+			resolution.error = "no IPv4 or IPv6 address for " + name;
+
+		return resolution;
+	}
+
+	static auto Numeric(const std::string& text, Address& address) -> bool
+	{
+		auto* v4 = reinterpret_cast<sockaddr_in*>(&address.storage);
+		auto* v6 = reinterpret_cast<sockaddr_in6*>(&address.storage);
+
+		if (inet_pton(AF_INET, text.c_str(), &v4->sin_addr) == 1) {
+			v4->sin_family = AF_INET;
+			address.length = sizeof(sockaddr_in);
+			return true;
+		}
+
+		if (inet_pton(AF_INET6, text.c_str(), &v6->sin6_addr) == 1) {
+			v6->sin6_family = AF_INET6;
+			address.length = sizeof(sockaddr_in6);
+			return true;
+		}
+
+		return false;
+	}
+
+	static auto Numeric(const std::string& text, Resolution& resolution) -> bool
+	{
+		Address address;
+		if (!Numeric(text, address))
+			return false;
+
+		resolution.addresses.push_back(address);
+		return true;
+	}
+
+	static auto Lower(std::string name) -> std::string
+	{
+		std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		// "localhost." and "localhost" are the same name
+		if (!name.empty() && name.back() == '.')
+			name.pop_back();
+		return name;
+	}
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	bool running_ = true;
+
+	std::deque<std::string> queue_;
+	std::unordered_map<std::string, std::vector<Callback>> waiting_;
+	std::unordered_map<std::string, Entry> cache_;
+	std::unordered_map<std::string, Resolution> hosts_;
+
+#ifdef _WIN32
+	// getaddrinfo needs WSAStartup too, kissnet only does it for its own sockets
+	std::shared_ptr<kissnet::win32_specific::WSA> wsa_ = kissnet::win32_specific::getWSA();
+#endif
+
+	std::vector<std::thread> threads_;
+};
+
+#endif // !RESOLVER_HPP
@@ -0,0 +1,236 @@
+#ifndef TUNNELS_HPP
+#define TUNNELS_HPP
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Dialer/Dialer.hpp"
+#include "../Loop/Loop.hpp"
+#include "../Options/Options.hpp"
+
+/// <summary>
+/// Tunnels through a proxy (or a chain of them) kept ready per destination. Every destination that was warmed
+/// or taken from has up to spare tunnels connected, authenticated and past the handshake;
+/// Take() hands one out and a Dialer on the pool's own loop thread brings up the next in
+/// the background, so the tunnel setup isn't paid on the request path. Tunnels the proxy
+/// closed while they waited are dropped on the way out. Safe from any thread
+/// </summary>
+class Tunnels
+{
+public:
+	// a destination whose tunnels fail isn't redialed in a tight loop
+	static constexpr auto kRetryDelay = std::chrono::milliseconds(1000);
+
+	Tunnels(std::vector<ProxyOptions> chain, const std::size_t spare, const std::chrono::milliseconds timeout) :
+		chain_(std::move(chain)), spare_(spare), timeout_(timeout), dialer_(loop_)
+	{
+		loop_.Start();
+	}
+
+	~Tunnels(void)
+	{
+		this->Close();
+	}
+
+	Tunnels(const Tunnels&) = delete;
+	Tunnels& operator=(const Tunnels&) = delete;
+
+	/// <summary>
+	/// Starts keeping tunnels to host:port ready
+	/// </summary>
+	auto Warm(const std::string& host, const std::uint16_t port) -> void
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		this->Find(host, port);
+	}
+
+	/// <summary>
+	/// A ready tunnel to host:port in blocking mode, waiting up to wait if none is ready yet.
+	/// Gives up early when a tunnel fails meanwhile (the socket is invalid and error says why),
+	/// a proxy that turns the credentials down would do the same to the next one
+	/// </summary>
+	auto Take(const std::string& host, const std::uint16_t port, const std::chrono::milliseconds wait, std::string& error) -> kissnet::tcp_socket
+	{
+		const auto deadline = std::chrono::steady_clock::now() + wait;
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto& destination = this->Find(host, port);
+		auto failures = destination.failures;
+
+		for (;;) {
+			const auto woken = wake_.wait_until(lock, deadline, [&] {
+				return closed_ || !destination.ready.empty() || destination.failures != failures;
+				});
+
+			if (!woken || closed_ || destination.ready.empty()) {
+				error = closed_ ? "tunnel pool is closed" :
+					destination.error.empty() ? "no tunnel through the proxy within " + std::to_string(wait.count()) + "ms" : destination.error;
+				return {};
+			}
+
+			auto tunnel = std::move(destination.ready.front());
+			destination.ready.pop_front();
+			this->Refill(destination);
+
+			// a refill that failed while the dead one waited says nothing about the refill in flight, only later failures count
+			if (!Alive(tunnel)) {
+				failures = destination.failures;
+				continue;
+			}
+
+			tunnel.set_non_blocking(false);
+			return tunnel;
+		}
+	}
+
+	/// <summary>
+	/// Tunnels to host:port ready right now
+	/// </summary>
+	auto Spare(const std::string& host, const std::uint16_t port) -> std::size_t
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto it = destinations_.find(Key(host, port));
+		return it == destinations_.end() ? 0 : it->second.ready.size();
+	}
+
+	/// <summary>
+	/// Closes the ready tunnels and gives up on the ones in progress
+	/// </summary>
+	auto Close(void) -> void
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (closed_)
+				return;
+			closed_ = true;
+		}
+		wake_.notify_all();
+
+		loop_.Post([this] { dialer_.Close(); });
+		loop_.Stop();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		destinations_.clear();
+	}
+
+private:
+	struct Destination
+	{
+		std::string host;
+		std::uint16_t port;
+		// non-blocking while they wait, so a closed one shows when peeked at
+		std::deque<kissnet::tcp_socket> ready;
+		std::size_t dialing = 0;
+		std::uint64_t failures = 0;
+		std::string error;
+	};
+
+	static auto Key(const std::string& host, const std::uint16_t port) -> std::string
+	{
+		return host + ':' + std::to_string(port);
+	}
+
+	/// <summary>
+	/// The destination, created and warmed on first use; mutex_ held
+	/// </summary>
+	auto Find(const std::string& host, const std::uint16_t port) -> Destination&
+	{
+		const auto key = Key(host, port);
+		const auto it = destinations_.find(key);
+		if (it != destinations_.end())
+			return it->second;
+
+		auto& destination = destinations_[key];
+		destination.host = host;
+		destination.port = port;
+		this->Refill(destination);
+		return destination;
+	}
+
+	/// <summary>
+	/// Dials what is missing to have spare tunnels ready or on their way; mutex_ held
+	/// </summary>
+	auto Refill(Destination& destination) -> void
+	{
+		if (closed_)
+			return;
+
+		for (; destination.ready.size() + destination.dialing < spare_; ++destination.dialing) {
+			// the dialer is the loop thread's, and its callbacks take mutex_ themselves
+			loop_.Post([this, key = Key(destination.host, destination.port), host = destination.host, port = destination.port] {
+				dialer_.Dial(chain_, host, port, timeout_, [this, key](kissnet::tcp_socket&& socket, const std::string& error, const std::vector<std::chrono::microseconds>&) {
+					this->Dialed(key, std::move(socket), error);
+					});
+				});
+		}
+	}
+
+	/// <summary>
+	/// A tunnel came up or didn't, loop thread
+	/// </summary>
+	auto Dialed(const std::string& key, kissnet::tcp_socket&& socket, const std::string& error) -> void
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto it = destinations_.find(key);
+		if (closed_ || it == destinations_.end())
+			return;
+
+		auto& destination = it->second;
+		--destination.dialing;
+
+		if (error.empty()) {
+			destination.ready.push_back(std::move(socket));
+			destination.error.clear();
+			wake_.notify_all();
+			return;
+		}
+
+		destination.error = error;
+		++destination.failures;
+		wake_.notify_all();
+
+		loop_.After(kRetryDelay, [this, key] {
+			std::lock_guard<std::mutex> lock(mutex_);
+			const auto it = destinations_.find(key);
+			if (it != destinations_.end())
+				this->Refill(it->second);
+			});
+	}
+
+	/// <summary>
+	/// Whether a waiting tunnel is still open, nothing is read from it
+	/// </summary>
+	static auto Alive(kissnet::tcp_socket& tunnel) -> bool
+	{
+		char byte = 0;
+		const auto received = ::recv(tunnel.get_handle(), &byte, 1, MSG_PEEK);
+		if (received > 0)
+			return true;
+
+		const auto error = received < 0 ? LastError() : 0;
+		return received < 0 && (error == EWOULDBLOCK || error == EAGAIN);
+	}
+
+	std::vector<ProxyOptions> chain_;
+	std::size_t spare_;
+	std::chrono::milliseconds timeout_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::unordered_map<std::string, Destination> destinations_;
+	bool closed_ = false;
+
+	Loop loop_;
+	Dialer dialer_;
+};
+
+#endif // !TUNNELS_HPP
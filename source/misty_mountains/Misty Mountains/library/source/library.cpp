@@ -0,0 +1,18 @@
+// The library is header-only, services put library/source on their include path.
+// This translation unit only makes sure every header builds on its own.
+
+#include "Client/Client.hpp"
+#include "Connection/Connection.hpp"
+#include "Datagram/Datagram.hpp"
+#include "Dialer/Dialer.hpp"
+#include "Framing/Framing.hpp"
+#include "Handshake/Handshake.hpp"
+#include "HappyEyeballs/HappyEyeballs.hpp"
+#include "Loop/Loop.hpp"
+#include "Options/Options.hpp"
+#include "Pool/Pool.hpp"
+#include "Proxy/Proxy.hpp"
+#include "ProxySet/ProxySet.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Resolver/Resolver.hpp"
+#include "Tunnels/Tunnels.hpp"
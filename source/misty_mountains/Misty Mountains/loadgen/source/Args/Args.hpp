@@ -0,0 +1,150 @@
+#ifndef ARGS_HPP
+#define ARGS_HPP
+
+#pragma once
+
+#include <args.hpp>
+#include <iostream>
+
+class Args
+{
+public:
+	/// <summary>
+	/// Parsing Arguments from cmdline
+	/// </summary>
+	auto Initialize(const int argc, char* argv[]) -> void
+	{
+		args::ArgumentParser m_parser("## Misty Mountains ##", "Open loop load generator for the echo server.");
+
+		args::HelpFlag m_help(m_parser, "help", "Display this help menu", { "help" });
+
+		args::Group m_g_arguments(m_parser, "Arguments", args::Group::Validators::DontCare, args::Options::Global);
+
+		args::ValueFlag<std::string> m_sz_hostname(m_g_arguments, "host", "Hostname to connect. By default 127.0.0.1.", { 'h', "host" });
+		args::ValueFlag<std::string> m_sz_port(m_g_arguments, "port", "Port to connect. By default 1337.", { 'p', "port" });
+		args::ValueFlag<std::string> m_sz_connections(m_g_arguments, "count", "Concurrent connections. By default 1.", { 'c', "connections" });
+		args::ValueFlag<std::string> m_sz_threads(m_g_arguments, "count", "Event loop threads the connections are spread over. By default 1.", { 't', "threads" });
+		args::ValueFlag<std::string> m_sz_rate(m_g_arguments, "rps", "Target requests per second of this process, sent on schedule whether answered or not. By default 1000.", { 'r', "rate" });
+		args::ValueFlag<std::string> m_sz_duration(m_g_arguments, "seconds", "How long to send. By default 10.", { 'd', "duration" });
+		args::ValueFlag<std::string> m_sz_timeout(m_g_arguments, "ms", "How long to wait for outstanding echoes after the run. By default 1000.", { "timeout" });
+		args::ValueFlag<std::string> m_sz_payload(m_g_arguments, "spec", "Payload sizes: fixed:N, uniform:MIN:MAX, zipf:MIN:MAX:S or recorded:PATH. By default fixed:64.", { "payload" });
+		args::ValueFlag<std::string> m_sz_framing(m_g_arguments, "framing", "Message framing, must match the server: raw, line or length. By default raw.", { "framing" });
+		args::ValueFlag<std::string> m_sz_prefix(m_g_arguments, "prefix", "Prefix the server adds to the echo. By default none.", { 'f', "prefix" });
+		args::ValueFlag<std::string> m_sz_suffix(m_g_arguments, "suffix", "Suffix the server adds to the echo. By default none.", { 's', "suffix" });
+		args::ValueFlag<std::string> m_sz_shm(m_g_arguments, "name", "Shared memory segment to add the results of several processes up in. By default none.", { "shm" });
+		args::ValueFlag<std::string> m_sz_processes(m_g_arguments, "count", "Processes sharing =shm, the last one to finish prints the totals. By default 1.", { "processes" });
+		///
+
+		try
+		{
+			m_parser.ParseCLI(argc, argv);
+
+			this->m_sz_hostname_ = m_sz_hostname.Get();
+			this->m_sz_port_ = m_sz_port.Get();
+			this->m_sz_connections_ = m_sz_connections.Get();
+			this->m_sz_threads_ = m_sz_threads.Get();
+			this->m_sz_rate_ = m_sz_rate.Get();
+			this->m_sz_duration_ = m_sz_duration.Get();
+			this->m_sz_timeout_ = m_sz_timeout.Get();
+			this->m_sz_payload_ = m_sz_payload.Get();
+			this->m_sz_framing_ = m_sz_framing.Get();
+			this->m_sz_prefix_ = m_sz_prefix.Get();
+			this->m_sz_suffix_ = m_sz_suffix.Get();
+			this->m_sz_shm_ = m_sz_shm.Get();
+			this->m_sz_processes_ = m_sz_processes.Get();
+		}
+		catch (const args::Help&)
+		{
+			std::cout << m_parser;
+			std::exit(EXIT_SUCCESS);
+		}
+		catch (const args::ParseError& e)
+		{
+			std::cerr << e.what() << '\n';
+			std::cerr << m_parser;
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	auto Hostname(void) -> std::string&
+	{
+		return m_sz_hostname_;
+	}
+
+	auto Port(void) -> std::string&
+	{
+		return m_sz_port_;
+	}
+
+	auto Connections(void) -> std::string&
+	{
+		return m_sz_connections_;
+	}
+
+	auto Threads(void) -> std::string&
+	{
+		return m_sz_threads_;
+	}
+
+	auto Rate(void) -> std::string&
+	{
+		return m_sz_rate_;
+	}
+
+	auto Duration(void) -> std::string&
+	{
+		return m_sz_duration_;
+	}
+
+	auto Timeout(void) -> std::string&
+	{
+		return m_sz_timeout_;
+	}
+
+	auto Payload(void) -> std::string&
+	{
+		return m_sz_payload_;
+	}
+
+	auto Framing(void) -> std::string&
+	{
+		return m_sz_framing_;
+	}
+
+	auto Prefix(void) -> std::string&
+	{
+		return m_sz_prefix_;
+	}
+
+	auto Suffix(void) -> std::string&
+	{
+		return m_sz_suffix_;
+	}
+
+	auto Shm(void) -> std::string&
+	{
+		return m_sz_shm_;
+	}
+
+	auto Processes(void) -> std::string&
+	{
+		return m_sz_processes_;
+	}
+
+private:
+	std::string m_sz_hostname_;
+	std::string m_sz_port_;
+	std::string m_sz_connections_;
+	std::string m_sz_threads_;
+	std::string m_sz_rate_;
+	std::string m_sz_duration_;
+	std::string m_sz_timeout_;
+	std::string m_sz_payload_;
+	std::string m_sz_framing_;
+	std::string m_sz_prefix_;
+	std::string m_sz_suffix_;
+	std::string m_sz_shm_;
+	std::string m_sz_processes_;
+};
+
+#endif // !ARGS_HPP
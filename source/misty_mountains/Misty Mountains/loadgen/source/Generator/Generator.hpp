@@ -0,0 +1,397 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../../../library/source/Framing/Framing.hpp"
+#include "../../../library/source/Reactor/Reactor.hpp"
+#include "../../../client/source/Histogram/Histogram.hpp"
+#include "../Payload/Payload.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/// <summary>
+/// What one run produced, summed over loops and processes
+/// </summary>
+struct Results
+{
+	// latency from the time the schedule said to send, corrects for coordinated omission
+	Histogram corrected;
+	// latency from the time the message actually went out, what a closed loop would report
+	Histogram uncorrected;
+	std::uint64_t sent = 0;
+	std::uint64_t received = 0;
+	std::uint64_t timeouts = 0;
+	std::uint64_t errors = 0;
+	std::uint64_t bytes = 0;
+
+	auto Merge(const Results& other) -> void
+	{
+		corrected.Merge(other.corrected);
+		uncorrected.Merge(other.uncorrected);
+		sent += other.sent;
+		received += other.received;
+		timeouts += other.timeouts;
+		errors += other.errors;
+		bytes += other.bytes;
+	}
+
+	auto Report(std::ostream& out, const std::chrono::milliseconds duration) const -> void
+	{
+		const auto seconds = std::chrono::duration<double>(duration).count();
+
+		out << "sent: " << sent << " received: " << received
+			<< " timeouts: " << timeouts << " errors: " << errors
+			<< " (" << static_cast<double>(received) / seconds << " req/s, "
+			<< static_cast<double>(bytes) * 8.0 / seconds / 1e6 << " Mbit/s)" << '\n';
+
+		const auto line = [&out](const char* name, const Histogram& histogram) {
+			if (!histogram.Count())
+				return;
+
+			const auto us = [](const std::chrono::nanoseconds value) { return static_cast<double>(value.count()) / 1000.0; };
+			out << name << ":"
+				<< " min=" << us(histogram.Min()) << "us"
+				<< " p50=" << us(histogram.Percentile(50.0)) << "us"
+				<< " p90=" << us(histogram.Percentile(90.0)) << "us"
+				<< " p99=" << us(histogram.Percentile(99.0)) << "us"
+				<< " p99.9=" << us(histogram.Percentile(99.9)) << "us"
+				<< " max=" << us(histogram.Max()) << "us" << '\n';
+		};
+
+		line("latency (from intended send)", corrected);
+		line("latency (from actual send)", uncorrected);
+	}
+};
+
+/// <summary>
+/// Parameters shared by every loop of the process
+/// </summary>
+struct Plan
+{
+	kissnet::endpoint server;
+	Framing framing = Framing::kRaw;
+	std::string prefix;
+	std::string suffix;
+	double rate = 1000.0;
+	std::size_t connections = 1;
+	std::chrono::milliseconds duration{ 10000 };
+	std::chrono::milliseconds timeout{ 1000 };
+	const Payload* payload = nullptr;
+};
+
+/// <summary>
+/// Event loop thread driving its share of the connections open loop:
+/// request j of the process is due at start + j / rate on connection j % connections,
+/// whether or not earlier requests were answered
+/// </summary>
+class Generator
+{
+public:
+	Generator(const std::size_t id, const std::size_t loops, const Plan& plan) :
+		id_(id), loops_(loops), plan_(plan), random_(std::random_device{}() ^ (std::uint64_t{ id } << 32))
+	{
+	}
+
+	~Generator(void)
+	{
+		this->Join();
+	}
+
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+
+	auto Start(const std::chrono::steady_clock::time_point start) -> void
+	{
+		thread_ = std::thread([this, start] { this->Run(start); });
+	}
+
+	auto Join(void) -> void
+	{
+		if (thread_.joinable())
+			thread_.join();
+	}
+
+	auto Outcome(void) const -> const Results&
+	{
+		return results_;
+	}
+
+private:
+	struct Pending
+	{
+		std::chrono::steady_clock::time_point intended;
+		std::chrono::steady_clock::time_point actual;
+		std::size_t size;
+	};
+
+	struct Connection
+	{
+		kissnet::tcp_socket socket;
+		std::size_t slot = 0;
+		std::uint64_t next = 0;
+		std::string pending;
+		std::string inbox;
+		std::deque<Pending> in_flight;
+		bool writing = false;
+		// the non-blocking connect hasn't completed yet, nothing is scheduled until it has
+		bool connecting = false;
+	};
+
+	auto Run(const std::chrono::steady_clock::time_point start) -> void
+	{
+		start_ = start;
+		end_ = start + plan_.duration;
+
+		for (auto slot = id_; slot < plan_.connections; slot += loops_)
+			this->Connect(slot);
+
+		std::vector<PollEvent> events;
+		while (!connections_.empty()) {
+			const auto now = std::chrono::steady_clock::now();
+			if (now >= end_ + plan_.timeout)
+				break;
+
+			auto wake = now >= end_ ? end_ + plan_.timeout : end_;
+			auto waiting = false;
+
+			for (auto it = connections_.begin(); it != connections_.end();) {
+				auto& connection = it->second;
+				if (connection.connecting) {
+					++it;
+					continue;
+				}
+
+				// requests due before the end still go out when the loop is running late
+				if (!this->Schedule(connection, now, wake)) {
+					it = this->Close(it);
+					continue;
+				}
+
+				waiting = waiting || !connection.in_flight.empty();
+				++it;
+			}
+
+			if (now >= end_ && !waiting)
+				break;
+
+			// under a millisecond to the next send: spin instead of oversleeping the schedule
+			const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(wake - std::chrono::steady_clock::now());
+			poller_.Wait(events, left.count() > 0 ? static_cast<int>(left.count()) : 0);
+
+			for (const auto& event : events) {
+				const auto it = connections_.find(event.fd);
+				if (it == connections_.end())
+					continue;
+
+				if (it->second.connecting) {
+					if (!this->Connected(it->second))
+						this->Close(it);
+					continue;
+				}
+
+				auto alive = !event.closed;
+				if (alive && event.readable)
+					alive = this->Read(it->second);
+				if (alive && event.writable)
+					alive = this->Flush(it->second);
+
+				if (!alive)
+					this->Close(it);
+			}
+		}
+
+		for (const auto& [fd, connection] : connections_)
+			results_.timeouts += connection.in_flight.size();
+	}
+
+	/// <summary>
+	/// Starts a non-blocking connect, every connection of the loop is dialed at once
+	/// and they complete in the poller while the start time comes closer
+	/// </summary>
+	auto Connect(const std::size_t slot) -> void
+	{
+		kissnet::tcp_socket socket(plan_.server);
+		const auto status = socket.connect_async();
+		if (!status) {
+			++results_.errors;
+			return;
+		}
+
+		// requests are small and sent on a schedule, don't let Nagle hold them back
+		socket.set_tcp_no_delay();
+
+		const auto fd = socket.get_handle();
+		auto& connection = connections_[fd];
+		connection.socket = std::move(socket);
+		connection.slot = slot;
+		connection.connecting = status.value == kissnet::socket_status::non_blocking_would_have_blocked;
+		poller_.Add(fd, true, connection.connecting);
+	}
+
+	/// <summary>
+	/// The connect of connection completed one way or the other
+	/// </summary>
+	auto Connected(Connection& connection) -> bool
+	{
+		connection.connecting = false;
+		return connection.socket.connect_result() && poller_.Modify(connection.socket.get_handle(), true, false);
+	}
+
+	/// <summary>
+	/// Queues every request of connection that is due by now, lowers wake to its next one
+	/// </summary>
+	auto Schedule(Connection& connection, const std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& wake) -> bool
+	{
+		auto queued = false;
+
+		for (;;) {
+			const auto intended = this->Due(connection);
+			if (intended >= end_)
+				break;
+			if (intended > now) {
+				if (intended < wake)
+					wake = intended;
+				break;
+			}
+
+			// a raw echo can't be told apart from the next one, so raw stays one at a time
+			// and the late send is charged to the corrected latency
+			if (plan_.framing == Framing::kRaw && !connection.in_flight.empty())
+				break;
+
+			const auto message = plan_.payload->Next(random_);
+			Framer::Encode(connection.pending, plan_.framing, message);
+			connection.in_flight.push_back({ intended, now, message.size() });
+			++connection.next;
+			++results_.sent;
+			queued = true;
+		}
+
+		return !queued || connection.writing || this->Flush(connection);
+	}
+
+	auto Due(const Connection& connection) const -> std::chrono::steady_clock::time_point
+	{
+		const auto request = static_cast<double>(connection.slot + connection.next * plan_.connections);
+		return start_ + std::chrono::nanoseconds(static_cast<std::int64_t>(request * 1e9 / plan_.rate));
+	}
+
+	auto Flush(Connection& connection) -> bool
+	{
+		auto& out = connection.pending;
+		const auto fd = connection.socket.get_handle();
+
+		std::size_t offset = 0;
+		while (offset < out.size()) {
+			const auto sent = ::send(fd, out.data() + offset, static_cast<buffsize_t>(out.size() - offset), MSG_NOSIGNAL);
+			if (sent < 0) {
+				const auto error = LastError();
+				if (error == EWOULDBLOCK || error == EAGAIN)
+					break;
+				return false;
+			}
+			offset += static_cast<std::size_t>(sent);
+		}
+
+		out.erase(0, offset);
+		if (connection.writing != !out.empty()) {
+			connection.writing = !out.empty();
+			poller_.Modify(fd, true, connection.writing);
+		}
+
+		return true;
+	}
+
+	auto Read(Connection& connection) -> bool
+	{
+		for (;;) {
+			const auto [size, status] = connection.socket.recv(buffer_);
+			if (status.value == kissnet::socket_status::non_blocking_would_have_blocked)
+				break;
+			if (!status || status.value == kissnet::socket_status::cleanly_disconnected)
+				return false;
+
+			connection.inbox.append(reinterpret_cast<const char*>(buffer_.data()), size);
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		auto unexpected = false;
+
+		const auto complete = [&](const std::size_t size) {
+			if (connection.in_flight.empty()) {
+				unexpected = true;
+				return;
+			}
+
+			const auto& request = connection.in_flight.front();
+			results_.corrected.Record(now - request.intended);
+			results_.uncorrected.Record(now - request.actual);
+			results_.bytes += request.size + size;
+			++results_.received;
+			connection.in_flight.pop_front();
+		};
+
+		if (plan_.framing == Framing::kRaw) {
+			while (!connection.in_flight.empty()) {
+				const auto expected = plan_.prefix.size() + connection.in_flight.front().size + plan_.suffix.size();
+				if (connection.inbox.size() < expected)
+					break;
+
+				connection.inbox.erase(0, expected);
+				complete(expected);
+			}
+
+			unexpected = !connection.inbox.empty() && connection.in_flight.empty();
+		}
+		else if (!Framer::Extract(connection.inbox, plan_.framing, [&](const std::string_view echo) { complete(echo.size()); })) {
+			unexpected = true;
+		}
+
+		if (unexpected) {
+			std::cerr << "Unexpected data from the server, check =framing/=prefix/=suffix" << '\n';
+			return false;
+		}
+
+		return true;
+	}
+
+	auto Close(std::unordered_map<SOCKET, Connection>::iterator it) -> std::unordered_map<SOCKET, Connection>::iterator
+	{
+		++results_.errors;
+		results_.timeouts += it->second.in_flight.size();
+
+		poller_.Remove(it->first);
+		return connections_.erase(it);
+	}
+
+	std::size_t id_;
+	std::size_t loops_;
+	const Plan& plan_;
+	std::mt19937_64 random_;
+
+	Poller poller_;
+	std::unordered_map<SOCKET, Connection> connections_;
+	kissnet::buffer<65536> buffer_;
+
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point end_;
+	std::thread thread_;
+	Results results_;
+};
+
+#endif // !GENERATOR_HPP
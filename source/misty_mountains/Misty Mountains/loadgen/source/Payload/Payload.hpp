@@ -0,0 +1,189 @@
+#ifndef PAYLOAD_HPP
+#define PAYLOAD_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// Draws message sizes from a distribution given as
+/// fixed:N | uniform:MIN:MAX | zipf:MIN:MAX:S | recorded:PATH (one size per line)
+/// </summary>
+class Payload
+{
+public:
+	/// <summary>
+	/// Parses spec, returns false and explains why if it is invalid
+	/// </summary>
+	auto Initialize(const std::string& spec, const std::size_t limit) -> bool
+	{
+		const auto fields = Split(spec);
+		if (fields.empty())
+			return this->Invalid(spec);
+
+		try
+		{
+			if (fields[0] == "fixed" && fields.size() == 2) {
+				kind_ = Kind::kFixed;
+				min_ = max_ = std::stoul(fields[1]);
+			}
+			else if (fields[0] == "uniform" && fields.size() == 3) {
+				kind_ = Kind::kUniform;
+				min_ = std::stoul(fields[1]);
+				max_ = std::stoul(fields[2]);
+			}
+			else if (fields[0] == "zipf" && fields.size() == 4) {
+				kind_ = Kind::kZipf;
+				min_ = std::stoul(fields[1]);
+				max_ = std::stoul(fields[2]);
+				exponent_ = std::stod(fields[3]);
+			}
+			else if (fields[0] == "recorded" && fields.size() == 2) {
+				kind_ = Kind::kRecorded;
+				if (!this->Load(fields[1]))
+					return false;
+			}
+			else {
+				return this->Invalid(spec);
+			}
+		}
+		catch (const std::exception&)
+		{
+			return this->Invalid(spec);
+		}
+
+		if (!min_ || min_ > max_ || max_ > limit) {
+			std::cerr << "Payload sizes must satisfy 0 < min <= max <= " << limit << ": " << spec << '\n';
+			return false;
+		}
+
+		if (kind_ == Kind::kZipf)
+			this->Zipf();
+
+		// messages are slices of one buffer, so the line framing never sees a '\n'
+		data_.resize(max_);
+		for (std::size_t i = 0; i < data_.size(); ++i)
+			data_[i] = static_cast<char>('a' + i % 26);
+
+		return true;
+	}
+
+	/// <summary>
+	/// Next message, random is the calling thread's own engine
+	/// </summary>
+	auto Next(std::mt19937_64& random) const -> std::string_view
+	{
+		return std::string_view(data_.data(), this->Size(random));
+	}
+
+	auto Max(void) const -> std::size_t
+	{
+		return max_;
+	}
+
+private:
+	enum class Kind {
+		kFixed,
+		kUniform,
+		kZipf,
+		kRecorded
+	};
+
+	auto Size(std::mt19937_64& random) const -> std::size_t
+	{
+		switch (kind_) {
+		case Kind::kUniform:
+			return std::uniform_int_distribution<std::size_t>(min_, max_)(random);
+		case Kind::kZipf: {
+			// rank 1 (the smallest size) is the most frequent
+			const auto u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+			const auto rank = std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+			return min_ + std::min<std::size_t>(static_cast<std::size_t>(rank), max_ - min_);
+		}
+		case Kind::kRecorded:
+			return recorded_[std::uniform_int_distribution<std::size_t>(0, recorded_.size() - 1)(random)];
+		default:
+			return min_;
+		}
+	}
+
+	auto Zipf(void) -> void
+	{
+		cdf_.resize(max_ - min_ + 1);
+
+		double sum = 0.0;
+		for (std::size_t rank = 0; rank < cdf_.size(); ++rank) {
+			sum += 1.0 / std::pow(static_cast<double>(rank + 1), exponent_);
+			cdf_[rank] = sum;
+		}
+
+		for (auto& value : cdf_)
+			value /= sum;
+	}
+
+	auto Load(const std::string& path) -> bool
+	{
+		std::ifstream file(path);
+		if (!file) {
+			std::cerr << "Can't open recorded payload sizes " << path << '\n';
+			return false;
+		}
+
+		std::size_t size;
+		while (file >> size)
+			recorded_.push_back(size);
+
+		if (recorded_.empty()) {
+			std::cerr << "No payload sizes in " << path << '\n';
+			return false;
+		}
+
+		const auto [min, max] = std::minmax_element(recorded_.begin(), recorded_.end());
+		min_ = *min;
+		max_ = *max;
+		return true;
+	}
+
+	auto Invalid(const std::string& spec) const -> bool
+	{
+		std::cerr << "Invalid payload " << spec << ", use fixed:N, uniform:MIN:MAX, zipf:MIN:MAX:S or recorded:PATH" << '\n';
+		return false;
+	}
+
+	static auto Split(const std::string& spec) -> std::vector<std::string>
+	{
+		std::vector<std::string> fields;
+		std::size_t offset = 0;
+
+		// recorded:PATH keeps everything after the first ':' so windows paths survive
+		for (auto end = spec.find(':'); end != std::string::npos; end = spec.find(':', offset)) {
+			fields.push_back(spec.substr(offset, end - offset));
+			offset = end + 1;
+			if (fields.front() == "recorded")
+				break;
+		}
+
+		if (offset < spec.size() || !fields.empty())
+			fields.push_back(spec.substr(offset));
+		return fields;
+	}
+
+	Kind kind_ = Kind::kFixed;
+	std::size_t min_ = 0;
+	std::size_t max_ = 0;
+	double exponent_ = 1.0;
+	std::vector<double> cdf_;
+	std::vector<std::size_t> recorded_;
+	std::string data_;
+};
+
+#endif // !PAYLOAD_HPP
@@ -0,0 +1,177 @@
+#ifndef SHARED_HPP
+#define SHARED_HPP
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../Generator/Generator.hpp"
+
+/// <summary>
+/// Named shared memory segment several loadgen processes add their results to.
+/// Every process publishes once at the end, the last one of the expected count
+/// reads the totals back and reports for the whole fleet.
+/// </summary>
+class Shared
+{
+public:
+	Shared(void) = default;
+
+	~Shared(void)
+	{
+#ifdef _WIN32
+		if (segment_)
+			UnmapViewOfFile(segment_);
+		if (mapping_)
+			CloseHandle(mapping_);
+#else
+		if (segment_)
+			munmap(segment_, sizeof(Segment));
+#endif
+	}
+
+	Shared(const Shared&) = delete;
+	Shared& operator=(const Shared&) = delete;
+
+	/// <summary>
+	/// Creates or attaches to the segment called name, it starts zeroed
+	/// </summary>
+	auto Open(const std::string& name) -> bool
+	{
+		name_ = name;
+#ifdef _WIN32
+		mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(sizeof(Segment)), ("Local\\" + name).c_str());
+		if (mapping_)
+			segment_ = static_cast<Segment*>(MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment)));
+#else
+		const auto fd = shm_open(("/" + name).c_str(), O_CREAT | O_RDWR, 0600);
+		if (fd >= 0) {
+			if (ftruncate(fd, sizeof(Segment)) == 0) {
+				auto* memory = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				if (memory != MAP_FAILED)
+					segment_ = static_cast<Segment*>(memory);
+			}
+			::close(fd);
+		}
+#endif
+		if (!segment_) {
+			std::cerr << "Can't open shared memory segment " << name << '\n';
+			return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Adds results to the segment. True for the process that completed the expected count
+	/// </summary>
+	auto Publish(const Results& results, const std::uint64_t processes) -> bool
+	{
+		Add(segment_->corrected, results.corrected);
+		Add(segment_->uncorrected, results.uncorrected);
+		segment_->sent.fetch_add(results.sent);
+		segment_->received.fetch_add(results.received);
+		segment_->timeouts.fetch_add(results.timeouts);
+		segment_->errors.fetch_add(results.errors);
+		segment_->bytes.fetch_add(results.bytes);
+
+		// acq_rel: the last one sees everything the others added before their increment
+		return segment_->published.fetch_add(1, std::memory_order_acq_rel) + 1 == processes;
+	}
+
+	/// <summary>
+	/// Totals of every process that published so far, the segment is removed afterwards
+	/// </summary>
+	auto Collect(void) -> Results
+	{
+		Results results;
+		Read(segment_->corrected, results.corrected);
+		Read(segment_->uncorrected, results.uncorrected);
+		results.sent = segment_->sent.load();
+		results.received = segment_->received.load();
+		results.timeouts = segment_->timeouts.load();
+		results.errors = segment_->errors.load();
+		results.bytes = segment_->bytes.load();
+
+#ifndef _WIN32
+		shm_unlink(("/" + name_).c_str());
+#endif
+		return results;
+	}
+
+private:
+	struct Block
+	{
+		std::atomic<std::uint64_t> count;
+		std::atomic<std::uint64_t> sum;
+		// stored inverted so the zeroed segment starts at "no minimum yet"
+		std::atomic<std::uint64_t> inverted_min;
+		std::atomic<std::uint64_t> max;
+		std::atomic<std::uint64_t> buckets[Histogram::kBuckets];
+	};
+
+	struct Segment
+	{
+		std::atomic<std::uint64_t> published;
+		std::atomic<std::uint64_t> sent;
+		std::atomic<std::uint64_t> received;
+		std::atomic<std::uint64_t> timeouts;
+		std::atomic<std::uint64_t> errors;
+		std::atomic<std::uint64_t> bytes;
+		Block corrected;
+		Block uncorrected;
+	};
+
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared counters must not hide a process local lock");
+
+	static auto Add(Block& block, const Histogram& histogram) -> void
+	{
+		const auto& buckets = histogram.Buckets();
+		for (std::size_t i = 0; i < Histogram::kBuckets; ++i) {
+			if (buckets[i])
+				block.buckets[i].fetch_add(buckets[i], std::memory_order_relaxed);
+		}
+
+		block.count.fetch_add(histogram.Count(), std::memory_order_relaxed);
+		block.sum.fetch_add(histogram.Sum(), std::memory_order_relaxed);
+
+		if (!histogram.Count())
+			return;
+
+		const auto inverted = ~static_cast<std::uint64_t>(histogram.Min().count());
+		auto current = block.inverted_min.load(std::memory_order_relaxed);
+		while (inverted > current && !block.inverted_min.compare_exchange_weak(current, inverted, std::memory_order_relaxed)) {}
+
+		const auto max = static_cast<std::uint64_t>(histogram.Max().count());
+		current = block.max.load(std::memory_order_relaxed);
+		while (max > current && !block.max.compare_exchange_weak(current, max, std::memory_order_relaxed)) {}
+	}
+
+	static auto Read(const Block& block, Histogram& histogram) -> void
+	{
+		std::uint64_t buckets[Histogram::kBuckets];
+		for (std::size_t i = 0; i < Histogram::kBuckets; ++i)
+			buckets[i] = block.buckets[i].load(std::memory_order_relaxed);
+
+		histogram.Merge(buckets, block.count.load(), block.sum.load(), ~block.inverted_min.load(), block.max.load());
+	}
+
+	std::string name_;
+	Segment* segment_ = nullptr;
+#ifdef _WIN32
+	HANDLE mapping_ = nullptr;
+#endif
+};
+
+#endif // !SHARED_HPP
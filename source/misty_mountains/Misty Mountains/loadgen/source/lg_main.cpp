@@ -0,0 +1,135 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+#include <kissnet.hpp>
+namespace kn = kissnet;
+
+#include "Args/Args.hpp"
+#include "Generator/Generator.hpp"
+#include "Payload/Payload.hpp"
+#include "Shared/Shared.hpp"
+#include "../../library/source/Resolver/Resolver.hpp"
+
+auto main(const int argc, char* argv[]) -> int
+{
+	auto args = std::make_unique<Args>();
+
+	args->Initialize(argc, argv);
+
+	//Configuration (by default)
+	kn::port_t port = 1337;
+	std::string hostname{ "127.0.0.1" };
+	std::size_t threads = 1;
+	std::uint64_t processes = 1;
+	Plan plan;
+	Payload payload;
+
+	if (!args->Hostname().empty())
+	{
+		hostname = args->Hostname();
+	}
+
+	try
+	{
+		if (!args->Port().empty())
+			port = kn::port_t(std::stoi(args->Port(), nullptr, 10));
+		if (!args->Connections().empty())
+			plan.connections = std::stoul(args->Connections(), nullptr, 10);
+		if (!args->Threads().empty())
+			threads = std::stoul(args->Threads(), nullptr, 10);
+		if (!args->Rate().empty())
+			plan.rate = std::stod(args->Rate());
+		if (!args->Duration().empty())
+			plan.duration = std::chrono::milliseconds(static_cast<std::int64_t>(std::stod(args->Duration()) * 1000.0));
+		if (!args->Timeout().empty())
+			plan.timeout = std::chrono::milliseconds(std::stoul(args->Timeout(), nullptr, 10));
+		if (!args->Processes().empty())
+			processes = std::stoull(args->Processes(), nullptr, 10);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong numeric variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!plan.connections || !threads || plan.rate <= 0.0 || !processes)
+	{
+		std::cerr << "Connections, threads, rate and processes must be positive" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (args->Framing() == "line")
+	{
+		plan.framing = Framing::kLine;
+	}
+	else if (args->Framing() == "length")
+	{
+		plan.framing = Framing::kLength;
+	}
+	else if (!args->Framing().empty() && args->Framing() != "raw")
+	{
+		std::cerr << "Unknown framing " << args->Framing() << ", use raw, line or length" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!payload.Initialize(args->Payload().empty() ? "fixed:64" : args->Payload(), Framer::kMaxMessage))
+	{
+		std::exit(EXIT_FAILURE);
+	}
+
+	// every connection would otherwise run its own getaddrinfo
+	const auto resolution = Resolver::Shared().Resolve(hostname).get();
+	const auto* address = resolution.First(AF_INET);
+	if (!address)
+	{
+		std::cerr << (resolution.error.empty() ? "No IPv4 address for " + hostname : resolution.error) << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	plan.server = kn::endpoint(address->Text(), port);
+	plan.prefix = args->Prefix();
+	plan.suffix = args->Suffix();
+	plan.payload = &payload;
+
+	// attach before the run, the segment lives as long as some process has it open
+	Shared shared;
+	if (!args->Shm().empty() && !shared.Open(args->Shm()))
+	{
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (threads > plan.connections)
+		threads = plan.connections;
+
+	std::cout << "Sending " << plan.rate << " req/s over " << plan.connections << " connection(s) and "
+		<< threads << " thread(s) to " << hostname << ':' << port << " for " << plan.duration.count() << "ms" << '\n';
+
+	// leave the loops time to connect before the first request is due
+	const auto start = std::chrono::steady_clock::now() + 250ms;
+
+	std::vector<std::unique_ptr<Generator>> loops;
+	for (std::size_t i = 0; i < threads; ++i) {
+		loops.push_back(std::make_unique<Generator>(i, threads, plan));
+		loops.back()->Start(start);
+	}
+
+	Results results;
+	for (auto& loop : loops) {
+		loop->Join();
+		results.Merge(loop->Outcome());
+	}
+
+	results.Report(std::cout, plan.duration);
+
+	if (!args->Shm().empty() && shared.Publish(results, processes))
+	{
+		std::cout << "all " << processes << " processes:" << '\n';
+		shared.Collect().Report(std::cout, plan.duration);
+	}
+
+	return results.errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+#ifndef ACCEPTOR_HPP
+#define ACCEPTOR_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Metrics/Metrics.hpp"
+#include "../Worker/Worker.hpp"
+#include "../../../library/source/Reactor/Reactor.hpp"
+
+/// <summary>
+/// Dedicated thread draining the listen backlog and handing sockets to workers
+/// </summary>
+class Acceptor
+{
+public:
+	Acceptor(std::vector<std::unique_ptr<Worker>>& workers, const Placement placement, Metrics& metrics) :
+		workers_(workers), placement_(placement), metrics_(metrics)
+	{
+		poller_.Add(notifier_.Handle());
+	}
+
+	~Acceptor(void)
+	{
+		Stop();
+	}
+
+	Acceptor(const Acceptor&) = delete;
+	Acceptor& operator=(const Acceptor&) = delete;
+
+	/// <summary>
+	/// Registers an already listening socket, must be called before Start.
+	/// Connections from a socks listener are served as SOCKS proxy clients
+	/// </summary>
+	auto Listen(SOCKET listener, const bool socks = false) -> void
+	{
+		SetNonBlocking(listener);
+		poller_.Add(listener);
+		listeners_.push_back(listener);
+		if (socks)
+			socks_.push_back(listener);
+	}
+
+	auto Start(void) -> void
+	{
+		running_ = true;
+		thread_ = std::thread([this] { this->Run(); });
+	}
+
+	auto Stop(void) -> void
+	{
+		if (!thread_.joinable())
+			return;
+
+		running_ = false;
+		notifier_.Notify();
+		thread_.join();
+	}
+
+private:
+	auto Run(void) -> void
+	{
+		std::vector<PollEvent> events;
+
+		while (running_) {
+			poller_.Wait(events, this->Timeout());
+			this->Resume();
+
+			for (const auto& event : events) {
+				if (event.fd == notifier_.Handle())
+					notifier_.Drain();
+				else if (event.readable)
+					this->Drain(event.fd);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Accepts up to kBatch pending connections without going back to the poller
+	/// </summary>
+	auto Drain(SOCKET listener) -> void
+	{
+		const auto socks = std::find(socks_.begin(), socks_.end(), listener) != socks_.end();
+
+		for (auto i = 0; i < kBatch; ++i) {
+			sockaddr_storage address{};
+			socklen_t length = sizeof address;
+
+#ifdef __linux__
+			const auto fd = ::accept4(listener, reinterpret_cast<sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+			const auto fd = ::accept(listener, reinterpret_cast<sockaddr*>(&address), &length);
+#endif
+			if (fd == INVALID_SOCKET) {
+				const auto error = LastError();
+				if (error == EWOULDBLOCK || error == EAGAIN)
+					return;
+				// a client that gave up while queued only costs itself its connection
+				if (error == EINTR || error == ECONNABORTED || error == ECONNRESET)
+					continue;
+
+				// the connection stays queued and the listener readable, polling it again would only spin
+				if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+					this->Rest(listener, error);
+					return;
+				}
+
+				std::cerr << "accept() failed with error " << error << '\n';
+				return;
+			}
+
+			if (starved_) {
+				std::cerr << "accept() works again after running out of descriptors" << '\n';
+				starved_ = false;
+			}
+
+			Accepted accepted{ fd, {}, std::chrono::steady_clock::now(), socks };
+#ifndef __linux__
+			SetNonBlocking(fd);
+#endif
+			accepted.from = kissnet::endpoint(reinterpret_cast<SOCKADDR*>(&address));
+
+			metrics_.Accepted();
+			if (!this->Dispatch(accepted)) {
+				metrics_.Dropped();
+				closesocket(fd);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Takes a listener out of the poller for kRest while the process is out of descriptors or
+	/// memory, it is told once per episode
+	/// </summary>
+	auto Rest(SOCKET listener, const int error) -> void
+	{
+		if (!starved_) {
+			std::cerr << "accept() failed with error " << error << ", out of descriptors or memory, listeners pause for "
+				<< kRest.count() << "ms at a time until it passes" << '\n';
+			starved_ = true;
+		}
+
+		poller_.Remove(listener);
+		resting_.push_back(listener);
+		resume_ = std::chrono::steady_clock::now() + kRest;
+	}
+
+	/// <summary>
+	/// Puts the resting listeners back into the poller once their pause is over
+	/// </summary>
+	auto Resume(void) -> void
+	{
+		if (resting_.empty() || std::chrono::steady_clock::now() < resume_)
+			return;
+
+		for (const auto listener : resting_)
+			poller_.Add(listener);
+		resting_.clear();
+	}
+
+	/// <summary>
+	/// How long the poller may wait: until the resting listeners resume, or for ever
+	/// </summary>
+	auto Timeout(void) const -> int
+	{
+		if (resting_.empty())
+			return -1;
+
+		const auto left = std::chrono::ceil<std::chrono::milliseconds>(resume_ - std::chrono::steady_clock::now()).count();
+		return static_cast<int>(std::max<long long>(left, 0));
+	}
+
+	/// <summary>
+	/// Hands the socket to the chosen worker, falls through to the next one when its queue is full
+	/// </summary>
+	auto Dispatch(Accepted& accepted) -> bool
+	{
+		const auto count = workers_.size();
+		auto index = this->Pick();
+
+		for (std::size_t attempt = 0; attempt < count; ++attempt) {
+			if (workers_[index]->Assign(accepted))
+				return true;
+
+			index = (index + 1) % count;
+		}
+
+		return false;
+	}
+
+	auto Pick(void) -> std::size_t
+	{
+		if (placement_ == Placement::kRoundRobin)
+			return next_++ % workers_.size();
+
+		std::size_t best = 0;
+		for (std::size_t i = 1; i < workers_.size(); ++i) {
+			if (workers_[i]->Load() < workers_[best]->Load())
+				best = i;
+		}
+
+		return best;
+	}
+
+private:
+	static constexpr auto kBatch = 64;
+	// how long listeners pause when accept() runs out of descriptors or memory
+	static constexpr std::chrono::milliseconds kRest{ 100 };
+
+	std::vector<std::unique_ptr<Worker>>& workers_;
+	Placement placement_;
+	Metrics& metrics_;
+
+	std::thread thread_;
+	std::atomic<bool> running_{ false };
+	std::size_t next_ = 0;
+
+	Poller poller_;
+	Notifier notifier_;
+	std::vector<SOCKET> listeners_;
+	std::vector<SOCKET> socks_;
+
+	// listeners out of the poller until resume_, and whether that was reported
+	std::vector<SOCKET> resting_;
+	std::chrono::steady_clock::time_point resume_;
+	bool starved_ = false;
+};
+
+#endif // !ACCEPTOR_HPP
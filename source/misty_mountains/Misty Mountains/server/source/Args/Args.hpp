@@ -24,6 +24,34 @@ public:
 		args::ValueFlag<std::string> m_sz_path(m_g_arguments, "xml", "Path to XML Configuration file. By default 'config.xml' near executable.", { 'x', "xml" });
 		args::ValueFlag<std::string> m_sz_prefix(m_g_arguments, "prefix", "Prefix to add to echo. By default none.", { 'f', "prefix" });
 		args::ValueFlag<std::string> m_sz_suffix(m_g_arguments, "suffix", "Suffix to add to echo. By default none.", { 's', "suffix" });
+		args::ValueFlag<std::string> m_sz_workers(m_g_arguments, "workers", "Number of worker event loops. By default one per hardware thread.", { 'w', "workers" });
+		args::ValueFlag<std::string> m_sz_placement(m_g_arguments, "placement", "Connection placement: round-robin or least-loaded. By default round-robin.", { "placement" });
+		args::ValueFlag<std::string> m_sz_stats(m_g_arguments, "seconds", "Print metrics every N seconds. By default never.", { "stats" });
+		args::Flag m_b_verbose(m_g_arguments, "verbose", "Log every connection and message.", { 'v', "verbose" });
+		args::ValueFlag<std::string> m_sz_drain(m_g_arguments, "ms", "Time given to open connections to finish on shutdown. By default 5000ms.", { "drain" });
+		args::Flag m_b_daemon(m_g_arguments, "daemon", "Don't wait for return on the terminal, only signals stop the server.", { 'd', "daemon" });
+		args::ValueFlag<std::string> m_sz_framing(m_g_arguments, "framing", "Message framing: raw, line or length. By default raw.", { "framing" });
+		args::Flag m_b_coalesce(m_g_arguments, "coalesce", "Coalesce the responses of one loop iteration into one write per connection.", { "coalesce" });
+		args::ValueFlag<std::string> m_sz_coalesce_cap(m_g_arguments, "us", "Longest time responses are held back while coalescing. By default 200us.", { "coalesce-cap" });
+
+		args::Group m_g_listener(m_parser, "Listener", args::Group::Validators::DontCare, args::Options::Global);
+
+		args::ValueFlag<std::string> m_sz_backlog(m_g_listener, "backlog", "Pending connections queue length. By default SOMAXCONN.", { "backlog" });
+		args::ValueFlag<std::string> m_sz_defer_accept(m_g_listener, "seconds", "TCP_DEFER_ACCEPT timeout, linux only. By default off.", { "defer-accept" });
+		args::ValueFlag<std::string> m_sz_fastopen(m_g_listener, "queue", "TCP_FASTOPEN pending queue length. By default off.", { "fastopen" });
+		args::ValueFlag<std::string> m_sz_rcvbuf(m_g_listener, "bytes", "SO_RCVBUF size. By default system.", { "rcvbuf" });
+		args::ValueFlag<std::string> m_sz_sndbuf(m_g_listener, "bytes", "SO_SNDBUF size. By default system.", { "sndbuf" });
+		args::Flag m_b_nodelay(m_g_listener, "nodelay", "Set TCP_NODELAY on accepted sockets.", { "nodelay" });
+		args::ValueFlag<std::string> m_sz_upgrade(m_g_listener, "path", "Unix socket to take the listeners over from the running server and to hand them to the next one, linux only.", { "upgrade-socket" });
+		args::Flag m_b_quickack(m_g_listener, "quickack", "Set TCP_QUICKACK on accepted sockets, linux only.", { "quickack" });
+		args::Flag m_b_ipv6(m_g_listener, "ipv6", "Also listen on [::] for IPv6 clients.", { "ipv6" });
+		args::Flag m_b_udp(m_g_listener, "udp", "Also echo UDP datagrams sent to the port, as they came.", { "udp" });
+
+		args::Group m_g_socks(m_parser, "SOCKS", args::Group::Validators::DontCare, args::Options::Global);
+
+		args::ValueFlag<std::string> m_sz_socks(m_g_socks, "port", "Also run a SOCKS5/SOCKS4 proxy on this port. By default off.", { "socks" });
+		args::ValueFlag<std::string> m_sz_socks_username(m_g_socks, "username", "Username SOCKS5 clients have to authenticate with, SOCKS4 is refused then. By default none.", { "socks-username" });
+		args::ValueFlag<std::string> m_sz_socks_password(m_g_socks, "password", "Password SOCKS5 clients have to authenticate with. By default none.", { "socks-password" });
 		///
 
 		try
@@ -34,6 +62,30 @@ public:
 			this->m_sz_path_ = m_sz_path.Get();
 			this->m_sz_prefix_ = m_sz_prefix.Get();
 			this->m_sz_suffix_ = m_sz_suffix.Get();
+			this->m_sz_workers_ = m_sz_workers.Get();
+			this->m_sz_placement_ = m_sz_placement.Get();
+			this->m_sz_stats_ = m_sz_stats.Get();
+			this->m_b_verbose_ = m_b_verbose.Get();
+			this->m_sz_drain_ = m_sz_drain.Get();
+			this->m_b_daemon_ = m_b_daemon.Get();
+			this->m_sz_framing_ = m_sz_framing.Get();
+			this->m_b_coalesce_ = m_b_coalesce.Get();
+			this->m_sz_coalesce_cap_ = m_sz_coalesce_cap.Get();
+
+			this->m_sz_backlog_ = m_sz_backlog.Get();
+			this->m_sz_defer_accept_ = m_sz_defer_accept.Get();
+			this->m_sz_fastopen_ = m_sz_fastopen.Get();
+			this->m_sz_rcvbuf_ = m_sz_rcvbuf.Get();
+			this->m_sz_sndbuf_ = m_sz_sndbuf.Get();
+			this->m_b_nodelay_ = m_b_nodelay.Get();
+			this->m_b_quickack_ = m_b_quickack.Get();
+			this->m_b_ipv6_ = m_b_ipv6.Get();
+			this->m_b_udp_ = m_b_udp.Get();
+			this->m_sz_upgrade_ = m_sz_upgrade.Get();
+
+			this->m_sz_socks_ = m_sz_socks.Get();
+			this->m_sz_socks_username_ = m_sz_socks_username.Get();
+			this->m_sz_socks_password_ = m_sz_socks_password.Get();
 		}
 		catch (const args::Help&)
 		{
@@ -67,12 +119,146 @@ public:
 	{
 		return m_sz_suffix_;
 	}
+
+	auto Workers(void) -> std::string&
+	{
+		return m_sz_workers_;
+	}
+
+	auto Placement(void) -> std::string&
+	{
+		return m_sz_placement_;
+	}
+
+	auto Stats(void) -> std::string&
+	{
+		return m_sz_stats_;
+	}
+
+	auto Verbose(void) const -> bool
+	{
+		return m_b_verbose_;
+	}
+
+	auto DrainTimeout(void) -> std::string&
+	{
+		return m_sz_drain_;
+	}
+
+	auto Daemon(void) const -> bool
+	{
+		return m_b_daemon_;
+	}
+
+	auto Framing(void) -> std::string&
+	{
+		return m_sz_framing_;
+	}
+
+	auto Coalesce(void) const -> bool
+	{
+		return m_b_coalesce_;
+	}
+
+	auto CoalesceCap(void) -> std::string&
+	{
+		return m_sz_coalesce_cap_;
+	}
+
+	auto Backlog(void) -> std::string&
+	{
+		return m_sz_backlog_;
+	}
+
+	auto DeferAccept(void) -> std::string&
+	{
+		return m_sz_defer_accept_;
+	}
+
+	auto FastOpen(void) -> std::string&
+	{
+		return m_sz_fastopen_;
+	}
+
+	auto RecvBuffer(void) -> std::string&
+	{
+		return m_sz_rcvbuf_;
+	}
+
+	auto SendBuffer(void) -> std::string&
+	{
+		return m_sz_sndbuf_;
+	}
+
+	auto NoDelay(void) const -> bool
+	{
+		return m_b_nodelay_;
+	}
+
+	auto QuickAck(void) const -> bool
+	{
+		return m_b_quickack_;
+	}
+
+	auto Ipv6(void) const -> bool
+	{
+		return m_b_ipv6_;
+	}
+
+	auto Udp(void) const -> bool
+	{
+		return m_b_udp_;
+	}
+
+	auto UpgradeSocket(void) -> std::string&
+	{
+		return m_sz_upgrade_;
+	}
+
+	auto Socks(void) -> std::string&
+	{
+		return m_sz_socks_;
+	}
+
+	auto SocksUsername(void) -> std::string&
+	{
+		return m_sz_socks_username_;
+	}
+
+	auto SocksPassword(void) -> std::string&
+	{
+		return m_sz_socks_password_;
+	}
 	
 private:
 	std::string m_sz_port_;
 	std::string m_sz_path_;
 	std::string m_sz_prefix_;
 	std::string m_sz_suffix_;
+	std::string m_sz_workers_;
+	std::string m_sz_placement_;
+	std::string m_sz_stats_;
+	bool m_b_verbose_ = false;
+	std::string m_sz_drain_;
+	bool m_b_daemon_ = false;
+	std::string m_sz_framing_;
+	bool m_b_coalesce_ = false;
+	std::string m_sz_coalesce_cap_;
+
+	std::string m_sz_backlog_;
+	std::string m_sz_defer_accept_;
+	std::string m_sz_fastopen_;
+	std::string m_sz_rcvbuf_;
+	std::string m_sz_sndbuf_;
+	bool m_b_nodelay_ = false;
+	bool m_b_quickack_ = false;
+	bool m_b_ipv6_ = false;
+	bool m_b_udp_ = false;
+	std::string m_sz_upgrade_;
+
+	std::string m_sz_socks_;
+	std::string m_sz_socks_username_;
+	std::string m_sz_socks_password_;
 };
 
 #endif // !ARGS_HPP
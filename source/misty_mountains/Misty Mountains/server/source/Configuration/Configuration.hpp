@@ -3,8 +3,17 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
+#include "../../../library/source/Framing/Framing.hpp"
+
+/// how new connections are spread over the workers
+enum class Placement {
+	kRoundRobin,
+	kLeastLoaded
+};
+
 class Configuration
 {
 public:
@@ -28,6 +37,111 @@ public:
 		sz_suffix_ = value;
 	}
 
+	auto Workers(const std::size_t value) -> void
+	{
+		ui_workers_ = value;
+	}
+
+	auto PlacementPolicy(const Placement value) -> void
+	{
+		placement_ = value;
+	}
+
+	auto Verbose(const bool value) -> void
+	{
+		b_verbose_ = value;
+	}
+
+	auto StatsInterval(const std::size_t value) -> void
+	{
+		ui_stats_interval_ = value;
+	}
+
+	auto Backlog(const int value) -> void
+	{
+		i_backlog_ = value;
+	}
+
+	auto DeferAccept(const int value) -> void
+	{
+		i_defer_accept_ = value;
+	}
+
+	auto FastOpen(const int value) -> void
+	{
+		i_fast_open_ = value;
+	}
+
+	auto RecvBuffer(const int value) -> void
+	{
+		i_recv_buffer_ = value;
+	}
+
+	auto SendBuffer(const int value) -> void
+	{
+		i_send_buffer_ = value;
+	}
+
+	auto NoDelay(const bool value) -> void
+	{
+		b_no_delay_ = value;
+	}
+
+	auto QuickAck(const bool value) -> void
+	{
+		b_quick_ack_ = value;
+	}
+
+	auto Ipv6(const bool value) -> void
+	{
+		b_ipv6_ = value;
+	}
+
+	auto MessageFraming(const Framing value) -> void
+	{
+		framing_ = value;
+	}
+
+	auto Coalesce(const bool value) -> void
+	{
+		b_coalesce_ = value;
+	}
+
+	auto CoalesceCap(const std::size_t value) -> void
+	{
+		ui_coalesce_cap_ = value;
+	}
+
+	auto DrainTimeout(const std::size_t value) -> void
+	{
+		ui_drain_timeout_ = value;
+	}
+
+	auto UpgradeSocket(std::string&& value) -> void
+	{
+		sz_upgrade_socket_ = value;
+	}
+
+	auto Udp(const bool value) -> void
+	{
+		b_udp_ = value;
+	}
+
+	auto SocksPort(const std::uint16_t value) -> void
+	{
+		ui_socks_port_ = value;
+	}
+
+	auto SocksUsername(std::string&& value) -> void
+	{
+		sz_socks_username_ = value;
+	}
+
+	auto SocksPassword(std::string&& value) -> void
+	{
+		sz_socks_password_ = value;
+	}
+
 	auto Port(void) -> std::uint16_t
 	{
 		return ui_port_;
@@ -48,11 +162,155 @@ public:
 		return sz_suffix_;
 	}
 
+	auto Workers(void) const -> std::size_t
+	{
+		return ui_workers_;
+	}
+
+	auto PlacementPolicy(void) const -> Placement
+	{
+		return placement_;
+	}
+
+	auto Verbose(void) const -> bool
+	{
+		return b_verbose_;
+	}
+
+	auto StatsInterval(void) const -> std::size_t
+	{
+		return ui_stats_interval_;
+	}
+
+	auto Backlog(void) const -> int
+	{
+		return i_backlog_;
+	}
+
+	auto DeferAccept(void) const -> int
+	{
+		return i_defer_accept_;
+	}
+
+	auto FastOpen(void) const -> int
+	{
+		return i_fast_open_;
+	}
+
+	auto RecvBuffer(void) const -> int
+	{
+		return i_recv_buffer_;
+	}
+
+	auto SendBuffer(void) const -> int
+	{
+		return i_send_buffer_;
+	}
+
+	auto NoDelay(void) const -> bool
+	{
+		return b_no_delay_;
+	}
+
+	auto QuickAck(void) const -> bool
+	{
+		return b_quick_ack_;
+	}
+
+	auto Ipv6(void) const -> bool
+	{
+		return b_ipv6_;
+	}
+
+	auto MessageFraming(void) const -> Framing
+	{
+		return framing_;
+	}
+
+	auto Coalesce(void) const -> bool
+	{
+		return b_coalesce_;
+	}
+
+	/// <summary>
+	/// Longest time in microseconds responses are held back within one loop iteration
+	/// </summary>
+	auto CoalesceCap(void) const -> std::size_t
+	{
+		return ui_coalesce_cap_;
+	}
+
+	/// <summary>
+	/// Milliseconds given to open connections to finish on shutdown
+	/// </summary>
+	auto DrainTimeout(void) const -> std::size_t
+	{
+		return ui_drain_timeout_;
+	}
+
+	/// <summary>
+	/// Unix socket path used to hand the listeners to the next server
+	/// </summary>
+	auto UpgradeSocket(void) const -> const std::string&
+	{
+		return sz_upgrade_socket_;
+	}
+
+	/// <summary>
+	/// Whether datagrams to the port are echoed too
+	/// </summary>
+	auto Udp(void) const -> bool
+	{
+		return b_udp_;
+	}
+
+	/// <summary>
+	/// Port of the SOCKS listener, 0 if there is none
+	/// </summary>
+	auto SocksPort(void) const -> std::uint16_t
+	{
+		return ui_socks_port_;
+	}
+
+	/// <summary>
+	/// Credentials SOCKS clients have to send, empty if they don't have to authenticate
+	/// </summary>
+	auto SocksUsername(void) const -> const std::string&
+	{
+		return sz_socks_username_;
+	}
+
+	auto SocksPassword(void) const -> const std::string&
+	{
+		return sz_socks_password_;
+	}
+
 private:
 	std::uint16_t ui_port_ = 1337;
+	std::size_t ui_workers_ = 1;
+	Placement placement_ = Placement::kRoundRobin;
+	bool b_verbose_ = false;
+	std::size_t ui_stats_interval_ = 0;
+	int i_backlog_ = 0;
+	int i_defer_accept_ = 0;
+	int i_fast_open_ = 0;
+	int i_recv_buffer_ = 0;
+	int i_send_buffer_ = 0;
+	bool b_no_delay_ = false;
+	bool b_quick_ack_ = false;
+	bool b_ipv6_ = false;
+	Framing framing_ = Framing::kRaw;
+	bool b_coalesce_ = false;
+	std::size_t ui_coalesce_cap_ = 200;
+	std::size_t ui_drain_timeout_ = 5000;
 	std::string sz_prefix_;
 	std::string sz_suffix_;
 	std::string sz_port_;
+	std::string sz_upgrade_socket_;
+	bool b_udp_ = false;
+	std::uint16_t ui_socks_port_ = 0;
+	std::string sz_socks_username_;
+	std::string sz_socks_password_;
 };
 
 #endif // !CONFIGURATION_HPP
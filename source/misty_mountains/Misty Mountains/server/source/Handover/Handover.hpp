@@ -0,0 +1,266 @@
+#ifndef HANDOVER_HPP
+#define HANDOVER_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/un.h>
+#endif
+
+#include "../Shutdown/Shutdown.hpp"
+
+/// <summary>
+/// Zero-downtime upgrades: listening sockets are inherited from socket
+/// activation (LISTEN_FDS) or taken over from the running server through
+/// a unix socket with SCM_RIGHTS, the old server drains once the new one is up
+/// </summary>
+class Handover
+{
+public:
+	Handover(void) = default;
+
+	~Handover(void)
+	{
+#ifdef __linux__
+		if (peer_ >= 0)
+			::close(peer_);
+#endif
+	}
+
+	Handover(const Handover&) = delete;
+	Handover& operator=(const Handover&) = delete;
+
+	/// <summary>
+	/// Listening sockets passed by the service manager, see sd_listen_fds(3)
+	/// </summary>
+	static auto Inherited(void) -> std::vector<SOCKET>
+	{
+		std::vector<SOCKET> fds;
+#ifdef __linux__
+		const auto* pid = std::getenv("LISTEN_PID");
+		const auto* count = std::getenv("LISTEN_FDS");
+		if (!pid || !count || std::strtol(pid, nullptr, 10) != ::getpid())
+			return fds;
+
+		constexpr auto kFirst = 3;
+		const auto total = std::strtol(count, nullptr, 10);
+		for (auto fd = kFirst; fd < kFirst + total; ++fd) {
+			::fcntl(fd, F_SETFD, FD_CLOEXEC);
+			fds.push_back(fd);
+		}
+
+		// don't pass them on to our own children
+		::unsetenv("LISTEN_PID");
+		::unsetenv("LISTEN_FDS");
+		::unsetenv("LISTEN_FDNAMES");
+#endif
+		return fds;
+	}
+
+	/// <summary>
+	/// Asks the server running on path for its listening sockets, empty if there is none
+	/// </summary>
+	auto Takeover(const std::string& path) -> std::vector<SOCKET>
+	{
+		std::vector<SOCKET> fds;
+#ifdef __linux__
+		sockaddr_un address{};
+		if (!Address(path, address))
+			return fds;
+
+		peer_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (peer_ < 0 || ::connect(peer_, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0) {
+			::close(peer_);
+			peer_ = -1;
+			return fds;
+		}
+
+		char tag = 0;
+		iovec iov{ &tag, 1 };
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxSockets)];
+
+		msghdr message{};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof control;
+
+		// a wedged server that took the connection mustn't hold this one at startup for ever
+		pollfd pfd{ peer_, POLLIN, 0 };
+		if (::poll(&pfd, 1, static_cast<int>(kConfirmTimeout.count())) <= 0) {
+			std::cerr << "Server on " << path << " didn't hand its sockets over within " << kConfirmTimeout.count() << "ms" << '\n';
+			::close(peer_);
+			peer_ = -1;
+			return fds;
+		}
+
+		if (::recvmsg(peer_, &message, MSG_CMSG_CLOEXEC) <= 0 || tag != kTag) {
+			std::cerr << "Server on " << path << " didn't hand its sockets over" << '\n';
+			::close(peer_);
+			peer_ = -1;
+			return fds;
+		}
+
+		for (auto* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+				continue;
+
+			const auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for (std::size_t i = 0; i < count; ++i) {
+				int fd;
+				std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof fd);
+				fds.push_back(fd);
+			}
+		}
+
+		// the kernel closed the sockets that didn't fit, listening on only some of them isn't a handover
+		if (message.msg_flags & MSG_CTRUNC) {
+			std::cerr << "Server on " << path << " handed over more than " << kMaxSockets << " sockets, they didn't all arrive" << '\n';
+			for (const auto fd : fds)
+				::close(fd);
+			fds.clear();
+			::close(peer_);
+			peer_ = -1;
+			return fds;
+		}
+
+		std::cout << "Took over " << fds.size() << " listening socket(s) from " << path << '\n';
+#else
+		std::cerr << "Socket handover isn't supported on this platform" << '\n';
+		(void)path;
+#endif
+		return fds;
+	}
+
+	/// <summary>
+	/// Tells the previous server we accept on the sockets now, it starts draining
+	/// </summary>
+	auto Confirm(void) -> void
+	{
+#ifdef __linux__
+		if (peer_ < 0)
+			return;
+
+		::send(peer_, &kTag, 1, MSG_NOSIGNAL);
+		::close(peer_);
+		peer_ = -1;
+#endif
+	}
+
+	/// <summary>
+	/// Waits on path for the next server and hands the listeners over to it
+	/// </summary>
+	auto Serve(const std::string& path, const std::vector<SOCKET>& listeners) -> bool
+	{
+#ifdef __linux__
+		sockaddr_un address{};
+		if (!Address(path, address))
+			return false;
+
+		const auto server = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		::unlink(path.c_str());
+		if (server < 0 ||
+			::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0 ||
+			::listen(server, 1) != 0) {
+			std::cerr << "Can't listen for upgrades on " << path << '\n';
+			if (server >= 0)
+				::close(server);
+			return false;
+		}
+
+		std::thread([server, listeners] {
+			for (;;) {
+				const auto client = ::accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+				if (client < 0)
+					continue;
+
+				if (Send(client, listeners)) {
+					std::cout << "Sockets handed over to the new server, draining" << '\n';
+					::close(client);
+					::close(server);
+					Shutdown::Raise();
+					return;
+				}
+
+				::close(client);
+			}
+			}).detach();
+
+		return true;
+#else
+		(void)path;
+		(void)listeners;
+		std::cerr << "Socket handover isn't supported on this platform" << '\n';
+		return false;
+#endif
+	}
+
+private:
+#ifdef __linux__
+	static auto Address(const std::string& path, sockaddr_un& address) -> bool
+	{
+		if (path.empty() || path.size() >= sizeof address.sun_path) {
+			std::cerr << "Invalid upgrade socket path " << path << '\n';
+			return false;
+		}
+
+		address.sun_family = AF_UNIX;
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+
+	/// <summary>
+	/// Passes the listeners and waits for the new server to confirm it took them
+	/// </summary>
+	static auto Send(const int client, const std::vector<SOCKET>& listeners) -> bool
+	{
+		char tag = kTag;
+		iovec iov{ &tag, 1 };
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxSockets)]{};
+
+		const auto count = std::min(listeners.size(), kMaxSockets);
+
+		msghdr message{};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+		auto* cmsg = CMSG_FIRSTHDR(&message);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+		std::memcpy(CMSG_DATA(cmsg), listeners.data(), sizeof(int) * count);
+
+		if (::sendmsg(client, &message, MSG_NOSIGNAL) <= 0)
+			return false;
+
+		// keep serving if the new binary dies before it is up
+		pollfd pfd{ client, POLLIN, 0 };
+		if (::poll(&pfd, 1, static_cast<int>(kConfirmTimeout.count())) <= 0)
+			return false;
+
+		return ::recv(client, &tag, 1, 0) == 1 && tag == kTag;
+	}
+
+	int peer_ = -1;
+#endif
+
+	static constexpr char kTag = 'L';
+	static constexpr std::size_t kMaxSockets = 16;
+	static constexpr std::chrono::milliseconds kConfirmTimeout{ 10000 };
+};
+
+#endif // !HANDOVER_HPP
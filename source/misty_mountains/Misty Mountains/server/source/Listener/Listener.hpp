@@ -0,0 +1,105 @@
+#ifndef LISTENER_HPP
+#define LISTENER_HPP
+
+#pragma once
+
+#include <iostream>
+
+#include <kissnet.hpp>
+
+#include "../Configuration/Configuration.hpp"
+#include "../../../library/source/Reactor/Reactor.hpp"
+
+/// <summary>
+/// Socket options taken from the configuration, for the listener and every accepted socket
+/// </summary>
+class Listener
+{
+public:
+	/// <summary>
+	/// Must be called before bind(), a restarted server can bind again while old connections sit in TIME_WAIT
+	/// </summary>
+	static auto Prepare([[maybe_unused]] SOCKET fd) -> void
+	{
+#ifndef _WIN32
+		// on Windows SO_REUSEADDR would allow stealing a port that is in use
+		Set(fd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+#endif
+	}
+
+	/// <summary>
+	/// Must be called before bind() on the [::] listener, it only takes IPv6 so that it
+	/// doesn't fight the 0.0.0.0 one over the port (Linux maps IPv4 into it by default)
+	/// </summary>
+	static auto V6Only(SOCKET fd) -> void
+	{
+		Set(fd, IPPROTO_IPV6, IPV6_V6ONLY, 1, "IPV6_V6ONLY");
+	}
+
+	/// <summary>
+	/// Must be called after bind() and before listen(), buffer sizes set here
+	/// are inherited by accepted sockets and decide the advertised window scale
+	/// </summary>
+	static auto Tune(SOCKET fd, const Configuration& config) -> void
+	{
+		if (config.RecvBuffer())
+			Set(fd, SOL_SOCKET, SO_RCVBUF, config.RecvBuffer(), "SO_RCVBUF");
+
+		if (config.SendBuffer())
+			Set(fd, SOL_SOCKET, SO_SNDBUF, config.SendBuffer(), "SO_SNDBUF");
+
+		if (config.NoDelay())
+			Set(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+
+#ifdef TCP_DEFER_ACCEPT
+		// wake the acceptor only once the first bytes are there
+		if (config.DeferAccept())
+			Set(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, config.DeferAccept(), "TCP_DEFER_ACCEPT");
+#else
+		if (config.DeferAccept())
+			std::cerr << "TCP_DEFER_ACCEPT isn't supported on this platform" << '\n';
+#endif
+
+#ifdef TCP_FASTOPEN
+		// accept data carried in the SYN of clients holding a cookie
+		if (config.FastOpen())
+			Set(fd, IPPROTO_TCP, TCP_FASTOPEN, config.FastOpen(), "TCP_FASTOPEN");
+#else
+		if (config.FastOpen())
+			std::cerr << "TCP_FASTOPEN isn't supported on this platform" << '\n';
+#endif
+	}
+
+	/// <summary>
+	/// Options that aren't inherited from the listener or have to be re-armed
+	/// </summary>
+	static auto Accepted(SOCKET fd, const Configuration& config) -> void
+	{
+		if (config.NoDelay())
+			Set(fd, IPPROTO_TCP, TCP_NODELAY, 1, nullptr);
+
+		QuickAck(fd, config);
+	}
+
+	/// <summary>
+	/// Linux clears TCP_QUICKACK again on its own, so it is re-armed after every read
+	/// </summary>
+	static auto QuickAck([[maybe_unused]] SOCKET fd, const Configuration& config) -> void
+	{
+#ifdef TCP_QUICKACK
+		if (config.QuickAck())
+			Set(fd, IPPROTO_TCP, TCP_QUICKACK, 1, nullptr);
+#else
+		(void)config;
+#endif
+	}
+
+private:
+	static auto Set(SOCKET fd, int level, int name, int value, const char* label) -> void
+	{
+		if (setsockopt(fd, level, name, reinterpret_cast<const char*>(&value), sizeof value) != 0 && label)
+			std::cerr << "Can't set " << label << " to " << value << " (error " << LastError() << ")" << '\n';
+	}
+};
+
+#endif // !LISTENER_HPP
@@ -0,0 +1,235 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/// <summary>
+/// Lock-free latency recorder: power-of-two microsecond buckets,
+/// percentiles are reported as the upper bound of the matching bucket
+/// </summary>
+class Latency
+{
+public:
+	auto Record(const std::chrono::nanoseconds value) -> void
+	{
+		const auto ns = static_cast<std::uint64_t>(value.count() < 0 ? 0 : value.count());
+		const auto us = ns / 1000;
+
+		std::size_t bucket = 0;
+		while (bucket + 1 < kBuckets && (std::uint64_t{ 1 } << bucket) <= us)
+			++bucket;
+
+		buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+
+		auto min = min_ns_.load(std::memory_order_relaxed);
+		while (ns < min && !min_ns_.compare_exchange_weak(min, ns, std::memory_order_relaxed)) {}
+
+		auto max = max_ns_.load(std::memory_order_relaxed);
+		while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+	}
+
+	auto Count(void) const -> std::uint64_t
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Upper bound (in microseconds) of the bucket holding the given percentile
+	/// </summary>
+	auto Percentile(const double percentile) const -> std::uint64_t
+	{
+		const auto total = Count();
+		if (!total)
+			return 0;
+
+		const auto target = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+		std::uint64_t seen = 0;
+
+		for (std::size_t i = 0; i < kBuckets; ++i) {
+			seen += buckets_[i].load(std::memory_order_relaxed);
+			if (seen >= target && seen)
+				return std::uint64_t{ 1 } << i;
+		}
+
+		return std::uint64_t{ 1 } << (kBuckets - 1);
+	}
+
+	auto Report(std::ostream& out, const char* name) const -> void
+	{
+		const auto count = Count();
+		if (!count)
+			return;
+
+		out << name << ": n=" << count
+			<< " min=" << min_ns_.load(std::memory_order_relaxed) / 1000 << "us"
+			<< " avg=" << sum_ns_.load(std::memory_order_relaxed) / count / 1000 << "us"
+			<< " p50<=" << Percentile(50.0) << "us"
+			<< " p99<=" << Percentile(99.0) << "us"
+			<< " max=" << max_ns_.load(std::memory_order_relaxed) / 1000 << "us" << '\n';
+	}
+
+private:
+	static constexpr std::size_t kBuckets = 32;
+
+	std::array<std::atomic<std::uint64_t>, kBuckets> buckets_{};
+	std::atomic<std::uint64_t> count_{ 0 };
+	std::atomic<std::uint64_t> sum_ns_{ 0 };
+	std::atomic<std::uint64_t> min_ns_{ UINT64_MAX };
+	std::atomic<std::uint64_t> max_ns_{ 0 };
+};
+
+/// <summary>
+/// Server wide counters, shared by the acceptor and every worker
+/// </summary>
+class Metrics
+{
+public:
+	auto Accepted(void) -> void
+	{
+		accepted_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto Dropped(void) -> void
+	{
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto Messages(const std::uint64_t count) -> void
+	{
+		messages_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	auto Sends(const std::uint64_t count) -> void
+	{
+		sends_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Segments sent on a connection, as reported by TCP_INFO when it closes
+	/// </summary>
+	auto Segments(const std::uint64_t count) -> void
+	{
+		segments_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	auto FirstByte(void) -> Latency&
+	{
+		return first_byte_;
+	}
+
+	/// <summary>
+	/// SOCKS requests whose destination was connected, and those the server turned down
+	/// </summary>
+	auto SocksGranted(void) -> void
+	{
+		socks_granted_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto SocksFailed(void) -> void
+	{
+		socks_failed_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Bytes relayed from SOCKS clients to their destinations and back
+	/// </summary>
+	auto Relayed(const std::uint64_t up, const std::uint64_t down) -> void
+	{
+		if (up)
+			relayed_up_.fetch_add(up, std::memory_order_relaxed);
+		if (down)
+			relayed_down_.fetch_add(down, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// One batch of datagrams echoed or relayed: how many came in and how many went out
+	/// </summary>
+	auto Datagrams(const std::uint64_t received, const std::uint64_t sent) -> void
+	{
+		datagrams_in_.fetch_add(received, std::memory_order_relaxed);
+		datagrams_out_.fetch_add(sent, std::memory_order_relaxed);
+		datagram_batches_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// First byte of the greeting to the granted reply, destination connect included
+	/// </summary>
+	auto SocksHandshake(void) -> Latency&
+	{
+		return socks_handshake_;
+	}
+
+	auto SocksConnect(void) -> Latency&
+	{
+		return socks_connect_;
+	}
+
+	auto Report(std::ostream& out) const -> void
+	{
+		out << "accepted: " << accepted_.load(std::memory_order_relaxed)
+			<< " dropped: " << dropped_.load(std::memory_order_relaxed) << '\n';
+		first_byte_.Report(out, "accept-to-first-byte");
+
+		const auto uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+		const auto granted = socks_granted_.load(std::memory_order_relaxed);
+		const auto failed = socks_failed_.load(std::memory_order_relaxed);
+		if (granted || failed) {
+			const auto up = relayed_up_.load(std::memory_order_relaxed);
+			const auto down = relayed_down_.load(std::memory_order_relaxed);
+
+			out << "socks: granted " << granted << " failed " << failed
+				<< " relayed up " << up << " down " << down << " bytes"
+				<< " (" << static_cast<double>(up + down) / uptime / 1e6 << " MB/s)" << '\n';
+			socks_handshake_.Report(out, "socks-handshake");
+			socks_connect_.Report(out, "socks-connect");
+		}
+
+		if (const auto batches = datagram_batches_.load(std::memory_order_relaxed)) {
+			const auto received = datagrams_in_.load(std::memory_order_relaxed);
+			const auto sent = datagrams_out_.load(std::memory_order_relaxed);
+
+			out << "udp: datagrams in " << received << " out " << sent
+				<< " (" << static_cast<double>(received) / static_cast<double>(batches) << " datagrams/batch, "
+				<< static_cast<double>(received) / uptime << " datagrams/s)" << '\n';
+		}
+
+		const auto messages = messages_.load(std::memory_order_relaxed);
+		if (!messages)
+			return;
+
+		const auto sends = sends_.load(std::memory_order_relaxed);
+
+		out << "messages: " << messages
+			<< " sends: " << sends << " (" << static_cast<double>(sends) / static_cast<double>(messages) << " syscalls/message)"
+			<< " segments: " << segments_.load(std::memory_order_relaxed)
+			<< " (" << static_cast<double>(segments_.load(std::memory_order_relaxed)) / uptime << " segments/s)" << '\n';
+	}
+
+private:
+	std::atomic<std::uint64_t> accepted_{ 0 };
+	std::atomic<std::uint64_t> dropped_{ 0 };
+	std::atomic<std::uint64_t> messages_{ 0 };
+	std::atomic<std::uint64_t> sends_{ 0 };
+	std::atomic<std::uint64_t> segments_{ 0 };
+	std::atomic<std::uint64_t> socks_granted_{ 0 };
+	std::atomic<std::uint64_t> socks_failed_{ 0 };
+	std::atomic<std::uint64_t> relayed_up_{ 0 };
+	std::atomic<std::uint64_t> relayed_down_{ 0 };
+	std::atomic<std::uint64_t> datagrams_in_{ 0 };
+	std::atomic<std::uint64_t> datagrams_out_{ 0 };
+	std::atomic<std::uint64_t> datagram_batches_{ 0 };
+	std::chrono::steady_clock::time_point started_ = std::chrono::steady_clock::now();
+	Latency first_byte_;
+	Latency socks_handshake_;
+	Latency socks_connect_;
+};
+
+#endif // !METRICS_HPP
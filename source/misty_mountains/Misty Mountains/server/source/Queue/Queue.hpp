@@ -0,0 +1,89 @@
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+/// <summary>
+/// Bounded lock-free multi-producer / single-consumer queue.
+/// Every cell carries a sequence number, so producers only contend on the
+/// tail counter and the consumer never touches it (Vyukov's bounded queue).
+/// </summary>
+template <typename T, std::size_t capacity>
+class MpscQueue
+{
+	static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+	MpscQueue(void)
+	{
+		for (std::size_t i = 0; i < capacity; ++i)
+			cells_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	/// <summary>
+	/// Returns false when the queue is full, the value is left untouched then
+	/// </summary>
+	auto Push(T& value) -> bool
+	{
+		auto pos = tail_.load(std::memory_order_relaxed);
+
+		for (;;) {
+			auto& cell = cells_[pos & (capacity - 1)];
+			const auto sequence = cell.sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+			if (diff == 0) {
+				if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.value = std::move(value);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = tail_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Must only be called from the consumer thread
+	/// </summary>
+	auto Pop(void) -> std::optional<T>
+	{
+		auto& cell = cells_[head_ & (capacity - 1)];
+		const auto sequence = cell.sequence.load(std::memory_order_acquire);
+
+		if (static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(head_ + 1) < 0)
+			return std::nullopt;
+
+		std::optional<T> value{ std::move(cell.value) };
+		cell.sequence.store(head_ + capacity, std::memory_order_release);
+		++head_;
+
+		return value;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	alignas(64) std::array<Cell, capacity> cells_;
+	alignas(64) std::atomic<std::size_t> tail_{ 0 };
+	alignas(64) std::size_t head_{ 0 };
+};
+
+#endif // !QUEUE_HPP
@@ -0,0 +1,220 @@
+#ifndef RELAY_HPP
+#define RELAY_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+#include "../../../library/source/Reactor/Reactor.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/// <summary>
+/// One direction of a relayed connection. On linux the bytes are spliced from the source
+/// socket into a pipe and from the pipe into the other socket, so they never leave the kernel;
+/// elsewhere they are read into the caller's buffer and sent on. Nothing more is read while
+/// the other side still has bytes to take, the source is left to the TCP window instead
+/// </summary>
+class Relay
+{
+public:
+	// what one splice moves at most, the default pipe capacity
+	static constexpr std::size_t kChunk = 64 * 1024;
+	// reads per readiness event, so one busy relay doesn't hold the worker up
+	static constexpr int kBurst = 16;
+
+	Relay(void) = default;
+
+	~Relay(void)
+	{
+#ifdef __linux__
+		for (const auto fd : pipe_) {
+			if (fd >= 0)
+				::close(fd);
+		}
+#endif
+	}
+
+	Relay(const Relay&) = delete;
+	Relay& operator=(const Relay&) = delete;
+
+	/// <summary>
+	/// Creates the pipe the bytes are spliced through, false if there is none
+	/// </summary>
+	auto Open(void) -> bool
+	{
+#ifdef __linux__
+		return ::pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) == 0;
+#else
+		return true;
+#endif
+	}
+
+	/// <summary>
+	/// Bytes that go out ahead of anything relayed, counted as relayed or not
+	/// </summary>
+	auto Queue(const std::string_view data, const bool relayed) -> void
+	{
+		buffer_.append(data);
+		if (!relayed)
+			unaccounted_ += data.size();
+	}
+
+	/// <summary>
+	/// Writes what is waiting to to, then moves what from has until either side would block.
+	/// Half-closes to once from hung up and everything went out. False on a socket error
+	/// </summary>
+	auto Pump(SOCKET from, SOCKET to, std::byte* scratch, const std::size_t size, std::uint64_t& moved) -> bool
+	{
+		auto more = true;
+		for (auto i = 0; i < kBurst; ++i) {
+			if (!this->Drain(to, moved))
+				return false;
+			if (this->Pending() || eof_ || !more)
+				break;
+
+			const auto read = this->Fill(from, scratch, size);
+			if (read < 0)
+				return false;
+
+			// a short read emptied the socket, the next one would only block
+			more = static_cast<std::size_t>(read) == Want(size);
+		}
+
+		if (eof_ && !this->Pending() && !shut_) {
+#ifdef _WIN32
+			::shutdown(to, SD_SEND);
+#else
+			::shutdown(to, SHUT_WR);
+#endif
+			shut_ = true;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Read interest on the source: only while nothing waits for the other side
+	/// </summary>
+	auto Reading(void) const -> bool
+	{
+		return !eof_ && !this->Pending();
+	}
+
+	/// <summary>
+	/// Write interest on the other side
+	/// </summary>
+	auto Writing(void) const -> bool
+	{
+		return this->Pending();
+	}
+
+	/// <summary>
+	/// The source hung up and the other side got everything and was half-closed
+	/// </summary>
+	auto Done(void) const -> bool
+	{
+		return shut_;
+	}
+
+private:
+	auto Pending(void) const -> bool
+	{
+		return !buffer_.empty() || piped_;
+	}
+
+	static auto Want([[maybe_unused]] const std::size_t size) -> std::size_t
+	{
+#ifdef __linux__
+		return kChunk;
+#else
+		return size;
+#endif
+	}
+
+	static auto WouldBlock(void) -> bool
+	{
+		const auto error = LastError();
+		return error == EWOULDBLOCK || error == EAGAIN;
+	}
+
+	/// <summary>
+	/// Writes the buffer then the pipe to to, true if that went fine or would block
+	/// </summary>
+	auto Drain(SOCKET to, std::uint64_t& moved) -> bool
+	{
+		while (!buffer_.empty()) {
+			const auto sent = ::send(to, buffer_.data(), static_cast<buffsize_t>(buffer_.size()), MSG_NOSIGNAL);
+			if (sent < 0)
+				return WouldBlock();
+
+			const auto size = static_cast<std::size_t>(sent);
+			const auto skipped = std::min(size, unaccounted_);
+			unaccounted_ -= skipped;
+			moved += size - skipped;
+			buffer_.erase(0, size);
+		}
+
+#ifdef __linux__
+		while (piped_) {
+			const auto spliced = ::splice(pipe_[0], nullptr, to, nullptr, piped_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (spliced < 0)
+				return WouldBlock();
+			if (spliced == 0)
+				return false;
+
+			piped_ -= static_cast<std::size_t>(spliced);
+			moved += static_cast<std::size_t>(spliced);
+		}
+#endif
+		return true;
+	}
+
+	/// <summary>
+	/// Reads what from has into the pipe (or the buffer): the byte count, 0 if it would block
+	/// or from hung up, -1 on an error
+	/// </summary>
+	auto Fill(SOCKET from, [[maybe_unused]] std::byte* scratch, [[maybe_unused]] const std::size_t size) -> std::int64_t
+	{
+#ifdef __linux__
+		const std::int64_t read = ::splice(from, nullptr, pipe_[1], nullptr, kChunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (read > 0)
+			piped_ += static_cast<std::size_t>(read);
+#else
+		const std::int64_t read = ::recv(from, reinterpret_cast<char*>(scratch), static_cast<buffsize_t>(size), 0);
+		if (read > 0)
+			buffer_.append(reinterpret_cast<const char*>(scratch), static_cast<std::size_t>(read));
+#endif
+		if (read == 0)
+			eof_ = true;
+		if (read < 0)
+			return WouldBlock() ? 0 : -1;
+
+		return read;
+	}
+
+#ifdef __linux__
+	int pipe_[2] = { -1, -1 };
+#endif
+	// bytes spliced into the pipe and not out of it yet
+	std::size_t piped_ = 0;
+	std::string buffer_;
+	// the front of the buffer that isn't relayed data, like the handshake reply
+	std::size_t unaccounted_ = 0;
+	bool eof_ = false;
+	bool shut_ = false;
+};
+
+#endif // !RELAY_HPP
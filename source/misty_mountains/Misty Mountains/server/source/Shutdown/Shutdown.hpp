@@ -0,0 +1,111 @@
+#ifndef SHUTDOWN_HPP
+#define SHUTDOWN_HPP
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Turns SIGINT/SIGTERM into something the main loop waits on.
+/// On linux the signals are blocked and read from a signalfd, so they never
+/// interrupt a worker in the middle of a send. Must be created before any thread.
+/// </summary>
+class Shutdown
+{
+public:
+	Shutdown(void)
+	{
+#ifdef __linux__
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGINT);
+		sigaddset(&mask, SIGTERM);
+
+		// threads started afterwards inherit the mask
+		pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+		fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+#else
+		std::signal(SIGINT, [](int) { Requested() = true; });
+		std::signal(SIGTERM, [](int) { Requested() = true; });
+#endif
+	}
+
+	~Shutdown(void)
+	{
+#ifdef __linux__
+		if (fd_ >= 0)
+			::close(fd_);
+#endif
+	}
+
+	Shutdown(const Shutdown&) = delete;
+	Shutdown& operator=(const Shutdown&) = delete;
+
+	/// <summary>
+	/// Returns true once a shutdown signal arrived, false when the timeout expired first
+	/// </summary>
+	auto Wait(const std::chrono::milliseconds timeout) -> bool
+	{
+#ifdef __linux__
+		pollfd pfd{ fd_, POLLIN, 0 };
+		if (::poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0)
+			return false;
+
+		signalfd_siginfo info{};
+		if (::read(fd_, &info, sizeof info) != sizeof info)
+			return false;
+
+		signal_ = static_cast<int>(info.ssi_signo);
+		return true;
+#else
+		const auto until = std::chrono::steady_clock::now() + timeout;
+		while (!Requested() && std::chrono::steady_clock::now() < until)
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		signal_ = SIGINT;
+		return Requested();
+#endif
+	}
+
+	/// <summary>
+	/// Asks for a shutdown from any thread
+	/// </summary>
+	static auto Raise(void) -> void
+	{
+#ifdef __linux__
+		// process directed, std::raise would only target the calling thread
+		::kill(::getpid(), SIGINT);
+#else
+		std::raise(SIGINT);
+#endif
+	}
+
+	auto Signal(void) const -> int
+	{
+		return signal_;
+	}
+
+private:
+#ifndef __linux__
+	static auto Requested(void) -> std::atomic<bool>&
+	{
+		static std::atomic<bool> requested{ false };
+		return requested;
+	}
+#endif
+
+	int fd_ = -1;
+	int signal_ = 0;
+};
+
+#endif // !SHUTDOWN_HPP
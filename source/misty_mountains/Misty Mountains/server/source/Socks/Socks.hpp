@@ -0,0 +1,365 @@
+#ifndef SOCKS_HPP
+#define SOCKS_HPP
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <kissnet.hpp>
+
+/// <summary>
+/// What Socks::Parse got to
+/// </summary>
+enum class SocksStep
+{
+	kMore,
+	kConnect,
+	kAssociate,
+	kFailed
+};
+
+/// <summary>
+/// Server side of a SOCKS5 (RFC 1928, username/password from RFC 1929) or SOCKS4/4a handshake.
+/// Parse eats the client's bytes as they come, several steps may arrive in one read when the
+/// client pipelines them, and appends the replies; the reply to the request is only built
+/// once the destination answered (Granted) or didn't (Refused). SOCKS5 clients may ask for
+/// a UDP relay (UDP ASSOCIATE) instead, Granted then gets the relay's address
+/// </summary>
+class Socks
+{
+public:
+	static constexpr std::size_t kMaxName = 255;
+
+	/// <summary>
+	/// Empty credentials let every client in, otherwise SOCKS5 clients have to
+	/// authenticate and SOCKS4 ones (which can't send a password) are turned away
+	/// </summary>
+	Socks(const std::string& username, const std::string& password) :
+		username_(username), password_(password)
+	{
+	}
+
+	auto Parse(std::string& inbox, std::string& out) -> SocksStep
+	{
+		for (;;) {
+			const auto size = inbox.size();
+			const auto* data = reinterpret_cast<const std::uint8_t*>(inbox.data());
+
+			switch (state_) {
+			case State::kGreeting:
+			{
+				if (!size)
+					return SocksStep::kMore;
+
+				version_ = data[0];
+				if (version_ == kSocks4) {
+					state_ = State::kSocks4Request;
+					continue;
+				}
+				if (version_ != kSocks5)
+					return this->Fail("unknown SOCKS version " + std::to_string(version_));
+
+				if (size < 2 || size < 2u + data[1])
+					return SocksStep::kMore;
+
+				const auto wanted = username_.empty() && password_.empty() ? kNoAuth : kUserPass;
+				const auto offered = std::string_view(inbox).substr(2, data[1]).find(char(wanted)) != std::string_view::npos;
+				inbox.erase(0, 2u + data[1]);
+
+				out += { char(kSocks5), char(offered ? wanted : kNoAcceptable) };
+				if (!offered)
+					return this->Fail(wanted == kUserPass ? "client can't authenticate" : "client wants to authenticate");
+
+				state_ = wanted == kUserPass ? State::kAuth : State::kRequest;
+				continue;
+			}
+			case State::kAuth:
+			{
+				if (size < 2 || size < 3u + data[1] || size < 3u + data[1] + data[2u + data[1]])
+					return SocksStep::kMore;
+
+				const auto user_length = data[1];
+				const auto password_length = data[2u + user_length];
+				const auto accepted = data[0] == kAuthVersion &&
+					std::string_view(inbox).substr(2, user_length) == username_ &&
+					std::string_view(inbox).substr(3u + user_length, password_length) == password_;
+				inbox.erase(0, 3u + user_length + password_length);
+
+				out += { char(kAuthVersion), char(accepted ? 0 : 1) };
+				if (!accepted)
+					return this->Fail("wrong credentials");
+
+				state_ = State::kRequest;
+				continue;
+			}
+			case State::kRequest:
+			{
+				if (size < 5)
+					return SocksStep::kMore;
+
+				const auto type = data[3];
+				const auto address_length = type == kIPv4 ? 4u : type == kIPv6 ? 16u : type == kDomain ? 1u + data[4] : 0u;
+				if (!address_length) {
+					out += this->Reply(kAddressNotSupported, nullptr);
+					return this->Fail("unknown address type " + std::to_string(type));
+				}
+				if (size < 4 + address_length + 2)
+					return SocksStep::kMore;
+
+				if (data[0] != kSocks5 || (data[1] != kConnect && data[1] != kUdpAssociate)) {
+					out += this->Reply(kCommandNotSupported, nullptr);
+					return this->Fail("unsupported command " + std::to_string(data[1]));
+				}
+
+				command_ = data[1];
+				port_ = std::uint16_t(data[4 + address_length] << 8 | data[5 + address_length]);
+				if (type == kDomain)
+					host_.assign(inbox, 5, data[4]);
+				else
+					this->Literal(type == kIPv4 ? AF_INET : AF_INET6, data + 4);
+
+				inbox.erase(0, 4 + address_length + 2);
+				state_ = State::kDone;
+				return this->Done();
+			}
+			case State::kSocks4Request:
+			{
+				// VN CD DSTPORT DSTIP USERID\0, SOCKS4a adds HOST\0 after a 0.0.0.x address
+				constexpr std::size_t kFixed = 8;
+				if (size < kFixed)
+					return SocksStep::kMore;
+
+				const auto user_end = inbox.find('\0', kFixed);
+				if (user_end == std::string::npos)
+					return size - kFixed > kMaxName ? this->Fail("SOCKS4 user id too long") : SocksStep::kMore;
+
+				const auto named = data[4] == 0 && data[5] == 0 && data[6] == 0 && data[7] != 0;
+				auto end = user_end;
+				if (named) {
+					end = inbox.find('\0', user_end + 1);
+					if (end == std::string::npos)
+						return size - user_end - 1 > kMaxName ? this->Fail("SOCKS4a host name too long") : SocksStep::kMore;
+				}
+
+				if (data[1] != kConnect) {
+					out += this->Reply(kSocks4Rejected, nullptr);
+					return this->Fail("unsupported command " + std::to_string(data[1]));
+				}
+				if (!username_.empty() || !password_.empty()) {
+					out += this->Reply(kSocks4Rejected, nullptr);
+					return this->Fail("SOCKS4 can't authenticate");
+				}
+
+				port_ = std::uint16_t(data[2] << 8 | data[3]);
+				if (named)
+					host_.assign(inbox, user_end + 1, end - user_end - 1);
+				else
+					this->Literal(AF_INET, data + 4);
+
+				inbox.erase(0, end + 1);
+				state_ = State::kDone;
+				return SocksStep::kConnect;
+			}
+			case State::kDone:
+				return this->Done();
+			case State::kFailed:
+				return SocksStep::kFailed;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Reply to a request whose destination was connected, bound is the relay's address towards it
+	/// </summary>
+	auto Granted(const sockaddr_storage& bound) const -> std::string
+	{
+		return this->Reply(version_ == kSocks4 ? kSocks4Granted : kSucceeded, &bound);
+	}
+
+	/// <summary>
+	/// Reply to a request whose destination couldn't be connected, error is the connect's
+	/// </summary>
+	auto Refused(const int error) const -> std::string
+	{
+		if (version_ == kSocks4)
+			return this->Reply(kSocks4Rejected, nullptr);
+
+		switch (error) {
+		case ECONNREFUSED:
+			return this->Reply(kConnectionRefused, nullptr);
+		case ENETUNREACH:
+			return this->Reply(kNetworkUnreachable, nullptr);
+		case EHOSTUNREACH:
+		case ETIMEDOUT:
+			return this->Reply(kHostUnreachable, nullptr);
+		default:
+			return this->Reply(kGeneralFailure, nullptr);
+		}
+	}
+
+	/// <summary>
+	/// Whether the destination came as an address, otherwise Host() has to be resolved first
+	/// </summary>
+	auto Resolved(void) const -> bool
+	{
+		return length_ != 0;
+	}
+
+	/// <summary>
+	/// The destination address with its port, valid once Resolved()
+	/// </summary>
+	auto Destination(void) const -> const sockaddr_storage&
+	{
+		return destination_;
+	}
+
+	auto Length(void) const -> socklen_t
+	{
+		return length_;
+	}
+
+	/// <summary>
+	/// The destination as the client sent it, for the resolver and the logs
+	/// </summary>
+	auto Host(void) const -> const std::string&
+	{
+		return host_;
+	}
+
+	auto Port(void) const -> std::uint16_t
+	{
+		return port_;
+	}
+
+	auto Version(void) const -> int
+	{
+		return version_;
+	}
+
+	auto Error(void) const -> const std::string&
+	{
+		return error_;
+	}
+
+private:
+	enum class State
+	{
+		kGreeting,
+		kAuth,
+		kRequest,
+		kSocks4Request,
+		kDone,
+		kFailed
+	};
+
+	enum : std::uint8_t
+	{
+		kSocks4 = 4,
+		kSocks5 = 5,
+		kAuthVersion = 1,
+		kNoAuth = 0,
+		kUserPass = 2,
+		kNoAcceptable = 0xFF,
+		kConnect = 1,
+		kUdpAssociate = 3,
+		kIPv4 = 1,
+		kDomain = 3,
+		kIPv6 = 4,
+		kSucceeded = 0,
+		kGeneralFailure = 1,
+		kNetworkUnreachable = 3,
+		kHostUnreachable = 4,
+		kConnectionRefused = 5,
+		kCommandNotSupported = 7,
+		kAddressNotSupported = 8,
+		kSocks4Granted = 90,
+		kSocks4Rejected = 91
+	};
+
+	auto Done(void) const -> SocksStep
+	{
+		return command_ == kUdpAssociate ? SocksStep::kAssociate : SocksStep::kConnect;
+	}
+
+	auto Fail(std::string error) -> SocksStep
+	{
+		error_ = std::move(error);
+		state_ = State::kFailed;
+		return SocksStep::kFailed;
+	}
+
+	/// <summary>
+	/// Takes the destination address straight from the request, family's size at raw
+	/// </summary>
+	auto Literal(const int family, const std::uint8_t* raw) -> void
+	{
+		char text[INET6_ADDRSTRLEN]{};
+		if (family == AF_INET) {
+			auto* address = reinterpret_cast<sockaddr_in*>(&destination_);
+			address->sin_family = AF_INET;
+			address->sin_port = htons(port_);
+			std::memcpy(&address->sin_addr, raw, 4);
+			length_ = sizeof(sockaddr_in);
+			inet_ntop(AF_INET, &address->sin_addr, text, sizeof text);
+		}
+		else {
+			auto* address = reinterpret_cast<sockaddr_in6*>(&destination_);
+			address->sin6_family = AF_INET6;
+			address->sin6_port = htons(port_);
+			std::memcpy(&address->sin6_addr, raw, 16);
+			length_ = sizeof(sockaddr_in6);
+			inet_ntop(AF_INET6, &address->sin6_addr, text, sizeof text);
+		}
+		host_ = text;
+	}
+
+	/// <summary>
+	/// SOCKS5: VER REP RSV ATYP BND.ADDR BND.PORT, SOCKS4: 0 CD DSTPORT DSTIP.
+	/// Without a bound address the fields are zero
+	/// </summary>
+	auto Reply(const std::uint8_t code, const sockaddr_storage* bound) const -> std::string
+	{
+		const auto v6 = bound && bound->ss_family == AF_INET6;
+		const auto* in = reinterpret_cast<const sockaddr_in*>(bound);
+		const auto* in6 = reinterpret_cast<const sockaddr_in6*>(bound);
+		const auto port = !bound ? std::uint16_t{ 0 } : ntohs(v6 ? in6->sin6_port : in->sin_port);
+
+		std::string reply;
+		if (version_ == kSocks4) {
+			reply = { 0, char(code), char(port >> 8), char(port & 0xFF) };
+			if (bound && !v6)
+				reply.append(reinterpret_cast<const char*>(&in->sin_addr), 4);
+			else
+				reply.append(4, '\0');
+			return reply;
+		}
+
+		reply = { char(kSocks5), char(code), 0, char(v6 ? kIPv6 : kIPv4) };
+		if (v6)
+			reply.append(reinterpret_cast<const char*>(&in6->sin6_addr), 16);
+		else if (bound)
+			reply.append(reinterpret_cast<const char*>(&in->sin_addr), 4);
+		else
+			reply.append(4, '\0');
+
+		reply += { char(port >> 8), char(port & 0xFF) };
+		return reply;
+	}
+
+	const std::string& username_;
+	const std::string& password_;
+
+	State state_ = State::kGreeting;
+	std::uint8_t version_ = 0;
+	std::uint8_t command_ = kConnect;
+	std::string host_;
+	std::uint16_t port_ = 0;
+	sockaddr_storage destination_{};
+	socklen_t length_ = 0;
+	std::string error_;
+};
+
+#endif // !SOCKS_HPP
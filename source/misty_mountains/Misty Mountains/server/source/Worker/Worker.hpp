@@ -0,0 +1,1125 @@
+#ifndef WORKER_HPP
+#define WORKER_HPP
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <kissnet.hpp>
+
+#include "../Configuration/Configuration.hpp"
+#include "../Listener/Listener.hpp"
+#include "../Metrics/Metrics.hpp"
+#include "../Queue/Queue.hpp"
+#include "../Relay/Relay.hpp"
+#include "../Socks/Socks.hpp"
+#include "../../../library/source/Datagram/Datagram.hpp"
+#include "../../../library/source/Framing/Framing.hpp"
+#include "../../../library/source/Reactor/Reactor.hpp"
+#include "../../../library/source/Resolver/Resolver.hpp"
+
+#include <cstddef>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/// <summary>
+/// Connection handed from the acceptor to a worker
+/// </summary>
+struct Accepted
+{
+	SOCKET fd = INVALID_SOCKET;
+	kissnet::endpoint from;
+	std::chrono::steady_clock::time_point at;
+	// came in on the SOCKS listener
+	bool socks = false;
+};
+
+/// <summary>
+/// Event loop thread owning a share of the connections
+/// </summary>
+class Worker
+{
+public:
+	Worker(const std::size_t id, Configuration& config, Metrics& metrics) :
+		id_(id), config_(config), metrics_(metrics), guard_(std::make_shared<Guard>())
+	{
+		guard_->worker = this;
+		poller_.Add(notifier_.Handle());
+	}
+
+	~Worker(void)
+	{
+		// resolver answers still on their way must not reach a worker that is gone
+		{
+			std::lock_guard<std::mutex> lock(guard_->mutex);
+			guard_->worker = nullptr;
+		}
+		Stop();
+	}
+
+	Worker(const Worker&) = delete;
+	Worker& operator=(const Worker&) = delete;
+
+	auto Start(void) -> void
+	{
+		running_ = true;
+		thread_ = std::thread([this] { this->Run(); });
+	}
+
+	auto Stop(void) -> void
+	{
+		if (!thread_.joinable())
+			return;
+
+		running_ = false;
+		notifier_.Notify();
+		thread_.join();
+	}
+
+	/// <summary>
+	/// Answers what was already received, half-closes every connection and waits
+	/// for the peers to hang up, connections still open at the deadline are closed
+	/// </summary>
+	auto Drain(const std::chrono::milliseconds timeout) -> void
+	{
+		deadline_ = std::chrono::steady_clock::now() + timeout;
+		draining_.store(true, std::memory_order_release);
+		notifier_.Notify();
+	}
+
+	/// <summary>
+	/// Waits for the event loop to finish draining
+	/// </summary>
+	auto Join(void) -> void
+	{
+		if (thread_.joinable())
+			thread_.join();
+	}
+
+	/// <summary>
+	/// Called from the acceptor thread, false if the handoff queue is full
+	/// </summary>
+	auto Assign(Accepted& connection) -> bool
+	{
+		if (!queue_.Push(connection))
+			return false;
+
+		load_.fetch_add(1, std::memory_order_relaxed);
+		notifier_.Notify();
+		return true;
+	}
+
+	/// <summary>
+	/// Echoes the datagrams that arrive on fd back to where they came from, call before Start()
+	/// </summary>
+	auto Echo(SOCKET fd) -> void
+	{
+		echo_ = fd;
+		SetNonBlocking(fd);
+		slots_.resize(kSlot * datagrams_.size());
+		poller_.Add(fd);
+	}
+
+	/// <summary>
+	/// Connections owned or queued, used for least-loaded placement
+	/// </summary>
+	auto Load(void) const -> std::size_t
+	{
+		return load_.load(std::memory_order_relaxed);
+	}
+
+private:
+	/// <summary>
+	/// The payload of a datagram to a name that wasn't resolved yet, and the port it goes to
+	/// </summary>
+	struct Held
+	{
+		std::uint16_t port;
+		std::string payload;
+	};
+
+	/// <summary>
+	/// SOCKS side of a connection from the SOCKS listener: the handshake, then the
+	/// connection to the destination and a relay in each direction. For UDP ASSOCIATE
+	/// the upstream is the datagram relay's socket instead, kept as long as the connection
+	/// </summary>
+	struct Session
+	{
+		explicit Session(const Configuration& config) :
+			handshake(config.SocksUsername(), config.SocksPassword())
+		{
+		}
+
+		Socks handshake;
+		// tells a resolver answer for this session from one for a later connection on the same fd
+		std::uint64_t id = 0;
+		SOCKET upstream = INVALID_SOCKET;
+		bool resolving = false;
+		bool connecting = false;
+		bool relaying = false;
+		bool associated = false;
+		std::chrono::steady_clock::time_point started;
+		std::chrono::steady_clock::time_point connect_started;
+
+		// client to destination and back
+		Relay up;
+		Relay down;
+
+		// read and write interest last set on the client and on the destination
+		bool client_read = true;
+		bool client_write = false;
+		bool upstream_read = false;
+		bool upstream_write = true;
+
+		// UDP ASSOCIATE: the only address datagrams are relayed for, the named destinations it sent to
+		// and the datagrams held for the names still being resolved
+		sockaddr_storage client{};
+		socklen_t client_length = 0;
+		std::unordered_map<std::string, Address> names;
+		std::unordered_map<std::string, std::vector<Held>> held;
+	};
+
+	/// <summary>
+	/// A name resolved for a session, handed over from a resolver thread. The name is only
+	/// set for the destinations of a UDP relay, otherwise it is the session's own destination
+	/// </summary>
+	struct Lookup
+	{
+		SOCKET fd;
+		std::uint64_t id;
+		Resolution resolution;
+		std::string name;
+	};
+
+	/// <summary>
+	/// Shared with resolver callbacks, which may outlive the worker
+	/// </summary>
+	struct Guard
+	{
+		std::mutex mutex;
+		Worker* worker = nullptr;
+		std::vector<Lookup> resolved;
+	};
+
+	struct Connection
+	{
+		kissnet::tcp_socket socket;
+		kissnet::endpoint from;
+		std::chrono::steady_clock::time_point accepted_at;
+		bool first_byte = false;
+		bool writing = false;
+		bool dirty = false;
+		bool half_closed = false;
+		std::string inbox;
+		std::string pending;
+		std::unique_ptr<Session> session;
+	};
+
+	// bytes a SOCKS client may send ahead of the tunnel before it is cut off
+	static constexpr std::size_t kMaxEarly = 64 * 1024;
+	// a datagram of any size with room for a SOCKS5 header in front
+	static constexpr std::size_t kSlot = Datagrams::kHeadroom + Datagrams::kMaxSize;
+	// named destinations a UDP relay remembers before it starts over, and resolves at once
+	static constexpr std::size_t kMaxNames = 64;
+	// datagrams a UDP relay holds for a name being resolved, the ones beyond are dropped
+	static constexpr std::size_t kMaxHeld = 8;
+
+	auto Run(void) -> void
+	{
+		std::vector<PollEvent> events;
+		const auto cap = std::chrono::microseconds(config_.CoalesceCap());
+
+		while (running_) {
+			poller_.Wait(events, this->Timeout());
+			const auto iteration = std::chrono::steady_clock::now();
+
+			for (const auto& event : events) {
+				if (event.fd == notifier_.Handle()) {
+					notifier_.Drain();
+					this->Adopt();
+					this->Resolved();
+					continue;
+				}
+
+				if (event.fd == echo_) {
+					this->EchoDatagrams();
+					continue;
+				}
+
+				auto it = connections_.find(event.fd);
+				auto upstream = false;
+				if (it == connections_.end()) {
+					// the destination side of a SOCKS connection
+					const auto owner = upstreams_.find(event.fd);
+					if (owner == upstreams_.end())
+						continue;
+
+					it = connections_.find(owner->second);
+					upstream = true;
+				}
+
+				auto alive = true;
+				if (it->second.session) {
+					alive = this->OnSocks(it->second, event, upstream);
+				}
+				else {
+					alive = !event.closed || event.readable;
+					if (alive && event.readable)
+						alive = this->OnReadable(it->second);
+					if (alive && event.writable)
+						alive = this->OnWritable(it->second);
+				}
+
+				if (!alive)
+					this->Close(it);
+
+				// a busy iteration must not hold responses back longer than the cap
+				if (!dirty_.empty() && std::chrono::steady_clock::now() - iteration > cap)
+					this->FlushDirty();
+			}
+
+			this->FlushDirty();
+
+			if (draining_.load(std::memory_order_acquire) && !this->DrainStep())
+				break;
+		}
+
+		while (!connections_.empty())
+			this->Close(connections_.begin());
+	}
+
+	auto Adopt(void) -> void
+	{
+		while (auto accepted = queue_.Pop()) {
+			const auto fd = accepted->fd;
+
+			auto& connection = connections_[fd];
+			connection.socket = kissnet::tcp_socket(fd, accepted->from);
+			connection.from = accepted->from;
+			connection.accepted_at = accepted->at;
+			if (accepted->socks) {
+				connection.session = std::make_unique<Session>(config_);
+				connection.session->id = ++sessions_;
+			}
+			Listener::Accepted(fd, config_);
+			poller_.Add(fd);
+
+			if (config_.Verbose())
+				std::cout << "Worker " << id_ << " took " << accepted->from.address << ':' << accepted->from.port << '\n';
+		}
+	}
+
+	auto OnReadable(Connection& connection) -> bool
+	{
+		const auto [data_size, valid] = connection.socket.recv(buffer_);
+		last_read_ = data_size;
+
+		if (valid.value == kissnet::socket_status::non_blocking_would_have_blocked)
+			return true;
+
+		if (!valid || valid.value == kissnet::socket_status::cleanly_disconnected)
+			return false;
+
+		// our side is already shut down, nothing can be answered anymore
+		if (connection.half_closed)
+			return true;
+
+		Listener::QuickAck(connection.socket.get_handle(), config_);
+
+		if (!connection.first_byte) {
+			connection.first_byte = true;
+			metrics_.FirstByte().Record(std::chrono::steady_clock::now() - connection.accepted_at);
+		}
+
+		const auto data = std::string_view(reinterpret_cast<const char*>(buffer_.data()), data_size);
+
+		if (config_.Verbose()) {
+			std::cout << "Incoming from " << connection.from.address << ":" << connection.from.port << '\n';
+			std::cout << "Data: " << data << '\n';
+		}
+
+		auto alive = true;
+		std::uint64_t messages = 0;
+
+		// without coalescing every message still goes out with its own send
+		const auto respond = [&](const std::string_view payload) {
+			Framer::Encode(connection.pending, config_.MessageFraming(), config_.Prefix(), payload, config_.Suffix());
+			++messages;
+
+			if (!config_.Coalesce() && !connection.writing && alive)
+				alive = this->Flush(connection);
+		};
+
+		if (config_.MessageFraming() == Framing::kRaw) {
+			respond(data);
+		}
+		else {
+			connection.inbox.append(data);
+			if (!Framer::Extract(connection.inbox, config_.MessageFraming(), respond))
+				return false;
+		}
+
+		metrics_.Messages(messages);
+
+		if (config_.Coalesce() && !connection.pending.empty() && !connection.writing && !connection.dirty) {
+			connection.dirty = true;
+			dirty_.push_back(connection.socket.get_handle());
+		}
+
+		return alive;
+	}
+
+	auto OnWritable(Connection& connection) -> bool
+	{
+		return this->Flush(connection);
+	}
+
+	/// <summary>
+	/// Writes as much pending output as the socket takes, write interest follows what is left
+	/// </summary>
+	auto Flush(Connection& connection) -> bool
+	{
+		auto& out = connection.pending;
+		const auto fd = connection.socket.get_handle();
+
+		std::size_t offset = 0;
+		std::uint64_t sends = 0;
+		while (offset < out.size()) {
+			const auto sent = ::send(fd, out.data() + offset, static_cast<buffsize_t>(out.size() - offset), MSG_NOSIGNAL);
+			++sends;
+			if (sent < 0) {
+				const auto error = LastError();
+				if (error == EWOULDBLOCK || error == EAGAIN)
+					break;
+				return false;
+			}
+			offset += static_cast<std::size_t>(sent);
+		}
+
+		metrics_.Sends(sends);
+
+		out.erase(0, offset);
+		if (connection.writing != !out.empty()) {
+			connection.writing = !out.empty();
+			poller_.Modify(fd, true, connection.writing);
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Readiness of a SOCKS connection, on the client's side or on the destination's
+	/// </summary>
+	auto OnSocks(Connection& connection, const PollEvent& event, const bool upstream) -> bool
+	{
+		auto& session = *connection.session;
+
+		if (upstream && session.connecting)
+			return this->Connected(connection);
+
+		if (session.associated) {
+			if (upstream) {
+				this->Forward(connection);
+				return true;
+			}
+			return this->Hold(connection, event);
+		}
+
+		if (!session.relaying) {
+			if (event.closed && !event.readable)
+				return false;
+			if (event.readable && !this->Greet(connection))
+				return false;
+			return !event.writable || this->Flush(connection);
+		}
+
+		const auto client = connection.socket.get_handle();
+		auto* scratch = buffer_.data();
+		std::uint64_t up = 0;
+		std::uint64_t down = 0;
+		auto alive = true;
+
+		// a hang-up is read as the end of the stream, or as the error, by the next pump
+		const auto readable = event.readable || event.closed;
+		if (upstream) {
+			if (readable)
+				alive = session.down.Pump(session.upstream, client, scratch, buffer_.size(), down);
+			if (alive && event.writable)
+				alive = session.up.Pump(client, session.upstream, scratch, buffer_.size(), up);
+		}
+		else {
+			if (readable)
+				alive = session.up.Pump(client, session.upstream, scratch, buffer_.size(), up);
+			if (alive && event.writable)
+				alive = session.down.Pump(session.upstream, client, scratch, buffer_.size(), down);
+		}
+
+		metrics_.Relayed(up, down);
+
+		if (!alive || (session.up.Done() && session.down.Done()))
+			return false;
+
+		this->Interest(connection);
+		return true;
+	}
+
+	/// <summary>
+	/// Reads the SOCKS handshake, bytes the client sends on before its tunnel is up wait in the inbox
+	/// </summary>
+	auto Greet(Connection& connection) -> bool
+	{
+		auto& session = *connection.session;
+
+		const auto [data_size, valid] = connection.socket.recv(buffer_);
+		if (valid.value == kissnet::socket_status::non_blocking_would_have_blocked)
+			return true;
+
+		if (!valid || valid.value == kissnet::socket_status::cleanly_disconnected)
+			return false;
+
+		if (!connection.first_byte) {
+			connection.first_byte = true;
+			session.started = std::chrono::steady_clock::now();
+			metrics_.FirstByte().Record(session.started - connection.accepted_at);
+		}
+
+		connection.inbox.append(reinterpret_cast<const char*>(buffer_.data()), data_size);
+		if (session.resolving || session.connecting)
+			return connection.inbox.size() <= kMaxEarly;
+
+		const auto step = session.handshake.Parse(connection.inbox, connection.pending);
+		if (step == SocksStep::kMore)
+			return connection.inbox.size() <= kMaxEarly && this->Flush(connection);
+
+		if (step == SocksStep::kFailed) {
+			metrics_.SocksFailed();
+			if (config_.Verbose())
+				std::cout << "SOCKS handshake from " << connection.from.address << ':' << connection.from.port << " failed: " << session.handshake.Error() << '\n';
+
+			// the refusal goes out if the socket takes it right away
+			this->Flush(connection);
+			return false;
+		}
+
+		if (!this->Flush(connection))
+			return false;
+
+		if (step == SocksStep::kAssociate)
+			return this->Associate(connection);
+
+		if (session.handshake.Resolved())
+			return this->Connect(connection, session.handshake.Destination(), session.handshake.Length());
+
+		// names are resolved off the worker thread, the answer comes back through the notifier
+		session.resolving = true;
+		Resolver::Shared().Resolve(session.handshake.Host(), [guard = guard_, fd = connection.socket.get_handle(), id = session.id](const Resolution& resolution) {
+			std::lock_guard<std::mutex> lock(guard->mutex);
+			if (!guard->worker)
+				return;
+
+			guard->resolved.push_back({ fd, id, resolution, {} });
+			guard->worker->notifier_.Notify();
+			});
+
+		return true;
+	}
+
+	/// <summary>
+	/// Connects the sessions whose destination name was resolved
+	/// </summary>
+	auto Resolved(void) -> void
+	{
+		std::vector<Lookup> resolved;
+		{
+			std::lock_guard<std::mutex> lock(guard_->mutex);
+			resolved.swap(guard_->resolved);
+		}
+
+		for (auto& lookup : resolved) {
+			const auto it = connections_.find(lookup.fd);
+			if (it == connections_.end() || !it->second.session || it->second.session->id != lookup.id)
+				continue;
+
+			if (!lookup.name.empty()) {
+				this->Release(*it->second.session, lookup);
+				continue;
+			}
+
+			if (!it->second.session->resolving)
+				continue;
+
+			auto& connection = it->second;
+			connection.session->resolving = false;
+
+			auto alive = false;
+			if (lookup.resolution.addresses.empty()) {
+				alive = this->Refuse(connection, EHOSTUNREACH);
+			}
+			else {
+				auto address = lookup.resolution.addresses.front();
+				const auto port = htons(connection.session->handshake.Port());
+				if (address.Family() == AF_INET6)
+					reinterpret_cast<sockaddr_in6*>(&address.storage)->sin6_port = port;
+				else
+					reinterpret_cast<sockaddr_in*>(&address.storage)->sin_port = port;
+
+				alive = this->Connect(connection, address.storage, address.length);
+			}
+
+			if (!alive)
+				this->Close(it);
+		}
+	}
+
+	/// <summary>
+	/// Starts connecting to the destination, its socket is watched for the connect to complete
+	/// </summary>
+	auto Connect(Connection& connection, const sockaddr_storage& address, const socklen_t length) -> bool
+	{
+		auto& session = *connection.session;
+
+		const auto fd = ::socket(address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+		if (fd == INVALID_SOCKET)
+			return this->Refuse(connection, LastError());
+
+		SetNonBlocking(fd);
+		if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), length) != 0) {
+			const auto error = LastError();
+			if (error != EINPROGRESS && error != EWOULDBLOCK) {
+				closesocket(fd);
+				return this->Refuse(connection, error);
+			}
+		}
+
+		session.upstream = fd;
+		session.connecting = true;
+		session.connect_started = std::chrono::steady_clock::now();
+		upstreams_[fd] = connection.socket.get_handle();
+		poller_.Add(fd, false, true);
+		return true;
+	}
+
+	/// <summary>
+	/// The connect to the destination completed: the client is granted its tunnel and the relay starts
+	/// </summary>
+	auto Connected(Connection& connection) -> bool
+	{
+		auto& session = *connection.session;
+
+		int error = 0;
+		socklen_t length = sizeof error;
+		if (getsockopt(session.upstream, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) != 0)
+			error = LastError();
+		if (error)
+			return this->Refuse(connection, error);
+
+		if (!session.up.Open() || !session.down.Open())
+			return this->Refuse(connection, LastError());
+
+		const auto now = std::chrono::steady_clock::now();
+		session.connecting = false;
+		session.relaying = true;
+		metrics_.SocksConnect().Record(now - session.connect_started);
+		metrics_.SocksHandshake().Record(now - session.started);
+		metrics_.SocksGranted();
+
+		sockaddr_storage bound{};
+		socklen_t bound_length = sizeof bound;
+		getsockname(session.upstream, reinterpret_cast<sockaddr*>(&bound), &bound_length);
+		Listener::Accepted(session.upstream, config_);
+
+		if (config_.Verbose())
+			std::cout << "Worker " << id_ << " relays " << connection.from.address << ':' << connection.from.port << " to " << session.handshake.Host() << ':' << session.handshake.Port() << '\n';
+
+		// replies the client didn't take yet go first, then the grant, then whatever the destination sends;
+		// what the client sent ahead goes to the destination before anything read from now on
+		session.down.Queue(connection.pending, false);
+		session.down.Queue(session.handshake.Granted(bound), false);
+		session.up.Queue(connection.inbox, true);
+		session.client_write = connection.writing;
+		connection.pending.clear();
+		connection.inbox.clear();
+		connection.inbox.shrink_to_fit();
+
+		const auto client = connection.socket.get_handle();
+		std::uint64_t up = 0;
+		std::uint64_t down = 0;
+		const auto alive = session.down.Pump(session.upstream, client, buffer_.data(), buffer_.size(), down) &&
+			session.up.Pump(client, session.upstream, buffer_.data(), buffer_.size(), up);
+		metrics_.Relayed(up, down);
+
+		if (!alive)
+			return false;
+
+		this->Interest(connection);
+		return true;
+	}
+
+	/// <summary>
+	/// Tells the client its destination can't be reached, always false: the connection is done
+	/// </summary>
+	auto Refuse(Connection& connection, const int error) -> bool
+	{
+		auto& session = *connection.session;
+		metrics_.SocksFailed();
+
+		if (config_.Verbose())
+			std::cout << "SOCKS connect from " << connection.from.address << ':' << connection.from.port << " to " << session.handshake.Host() << ':' << session.handshake.Port() << " failed with error " << error << '\n';
+
+		connection.pending += session.handshake.Refused(error);
+		this->Flush(connection);
+		return false;
+	}
+
+	/// <summary>
+	/// UDP ASSOCIATE: opens the relay's socket on the address the client connected to and grants it.
+	/// The port the client said it sends from is taken as is, 0 means it is learned from the first datagram
+	/// </summary>
+	auto Associate(Connection& connection) -> bool
+	{
+		auto& session = *connection.session;
+		const auto client = connection.socket.get_handle();
+
+		sockaddr_storage local{};
+		socklen_t length = sizeof local;
+		session.client_length = sizeof session.client;
+		if (getsockname(client, reinterpret_cast<sockaddr*>(&local), &length) != 0 ||
+			getpeername(client, reinterpret_cast<sockaddr*>(&session.client), &session.client_length) != 0)
+			return this->Refuse(connection, LastError());
+
+		Port(local, 0);
+		Port(session.client, session.handshake.Port());
+
+		const auto fd = ::socket(local.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+		if (fd == INVALID_SOCKET)
+			return this->Refuse(connection, LastError());
+
+		if (::bind(fd, reinterpret_cast<const sockaddr*>(&local), length) != 0 ||
+			getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) != 0) {
+			const auto error = LastError();
+			closesocket(fd);
+			return this->Refuse(connection, error);
+		}
+
+		SetNonBlocking(fd);
+		session.upstream = fd;
+		session.associated = true;
+		upstreams_[fd] = client;
+		poller_.Add(fd);
+		if (slots_.empty())
+			slots_.resize(kSlot * datagrams_.size());
+
+		metrics_.SocksHandshake().Record(std::chrono::steady_clock::now() - session.started);
+		metrics_.SocksGranted();
+
+		if (config_.Verbose())
+			std::cout << "Worker " << id_ << " relays datagrams for " << connection.from.address << ':' << connection.from.port << '\n';
+
+		// nothing else is read from the connection, it only holds the relay open
+		connection.inbox.clear();
+		connection.pending += session.handshake.Granted(local);
+		return this->Flush(connection);
+	}
+
+	/// <summary>
+	/// The connection of a UDP relay: what the client sends on it is ignored, the relay ends when it hangs up
+	/// </summary>
+	auto Hold(Connection& connection, const PollEvent& event) -> bool
+	{
+		if (event.closed && !event.readable)
+			return false;
+
+		if (event.readable) {
+			const auto [data_size, valid] = connection.socket.recv(buffer_);
+			if (valid.value != kissnet::socket_status::non_blocking_would_have_blocked &&
+				(!valid || valid.value == kissnet::socket_status::cleanly_disconnected))
+				return false;
+		}
+
+		return !event.writable || this->Flush(connection);
+	}
+
+	/// <summary>
+	/// Datagrams on a UDP relay. The client's are unwrapped and sent on to where their header
+	/// says, everyone else's get a header saying where they came from and go to the client.
+	/// One batch in and one out, the headers are written in place
+	/// </summary>
+	auto Forward(Connection& connection) -> void
+	{
+		auto& session = *connection.session;
+
+		for (auto burst = 0; burst < Relay::kBurst; ++burst) {
+			// an error here is ICMP news about an earlier datagram, nothing to give up the relay for
+			const auto received = Datagrams::Receive(session.upstream, datagrams_.data(), datagrams_.size(), slots_.data(), kSlot);
+			if (received <= 0)
+				break;
+
+			std::size_t out = 0;
+			std::uint64_t up = 0;
+			std::uint64_t down = 0;
+			DatagramTarget target;
+
+			for (std::size_t i = 0; i < static_cast<std::size_t>(received); ++i) {
+				auto& datagram = datagrams_[i];
+
+				if (this->FromClient(session, datagram)) {
+					// the relay's socket only reaches its own family
+					if (!Datagrams::Unwrap(datagram, target) || !this->Destination(connection, datagram, target) ||
+						target.address.ss_family != session.client.ss_family)
+						continue;
+
+					datagram.peer = target.address;
+					datagram.length = target.length;
+					up += datagram.size;
+				}
+				else {
+					// nowhere to send answers before the client's port is known
+					if (!Port(session.client))
+						continue;
+
+					down += datagram.size;
+					Datagrams::Wrap(datagram, datagram.peer);
+					datagram.peer = session.client;
+					datagram.length = session.client_length;
+				}
+
+				if (out != i)
+					datagrams_[out] = datagram;
+				++out;
+			}
+
+			const auto sent = Datagrams::Send(session.upstream, datagrams_.data(), out);
+			metrics_.Datagrams(static_cast<std::size_t>(received), sent);
+			metrics_.Relayed(up, down);
+
+			if (static_cast<std::size_t>(received) < datagrams_.size())
+				break;
+		}
+	}
+
+	/// <summary>
+	/// Whether a datagram came from the session's client, whose port is taken from its first datagram if it didn't say
+	/// </summary>
+	static auto FromClient(Session& session, const Datagram& datagram) -> bool
+	{
+		const auto& client = session.client;
+		if (datagram.peer.ss_family != client.ss_family)
+			return false;
+
+		const auto same = client.ss_family == AF_INET6 ?
+			std::memcmp(&reinterpret_cast<const sockaddr_in6*>(&client)->sin6_addr, &reinterpret_cast<const sockaddr_in6*>(&datagram.peer)->sin6_addr, sizeof(in6_addr)) == 0 :
+			std::memcmp(&reinterpret_cast<const sockaddr_in*>(&client)->sin_addr, &reinterpret_cast<const sockaddr_in*>(&datagram.peer)->sin_addr, sizeof(in_addr)) == 0;
+		if (!same)
+			return false;
+
+		if (!Port(client))
+			Port(session.client, Port(datagram.peer));
+
+		return Port(client) == Port(datagram.peer);
+	}
+
+	/// <summary>
+	/// Fills in the address of a named destination from the session's names or the resolver's cache.
+	/// While the resolver looks up a name it doesn't know yet the datagram is held, with a few more
+	/// to the same name, and Release() sends them once the answer is in
+	/// </summary>
+	auto Destination(Connection& connection, const Datagram& datagram, DatagramTarget& target) -> bool
+	{
+		if (target.length)
+			return true;
+
+		auto& session = *connection.session;
+		const std::string name(target.name);
+		auto it = session.names.find(name);
+		if (it == session.names.end()) {
+			if (const auto held = session.held.find(name); held != session.held.end()) {
+				if (held->second.size() < kMaxHeld)
+					held->second.push_back({ target.port, std::string(reinterpret_cast<const char*>(datagram.data), datagram.size) });
+				return false;
+			}
+
+			auto answer = Resolver::Shared().Resolve(name);
+			if (answer.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				if (session.held.size() >= kMaxNames)
+					return false;
+
+				session.held[name].push_back({ target.port, std::string(reinterpret_cast<const char*>(datagram.data), datagram.size) });
+
+				// joins the lookup just started, the answer comes back through the notifier
+				Resolver::Shared().Resolve(name, [guard = guard_, fd = connection.socket.get_handle(), id = session.id, name](const Resolution& resolution) {
+					std::lock_guard<std::mutex> lock(guard->mutex);
+					if (!guard->worker)
+						return;
+
+					guard->resolved.push_back({ fd, id, resolution, name });
+					guard->worker->notifier_.Notify();
+					});
+				return false;
+			}
+
+			const auto resolution = answer.get();
+			const auto* address = resolution.First(session.client.ss_family);
+			if (!address)
+				return false;
+
+			if (session.names.size() >= kMaxNames)
+				session.names.clear();
+			it = session.names.emplace(name, *address).first;
+		}
+
+		target.address = it->second.storage;
+		target.length = it->second.length;
+		Port(target.address, target.port);
+		return true;
+	}
+
+	/// <summary>
+	/// Sends the datagrams a UDP relay held for a name that is resolved now, or drops them if
+	/// the name has no address in the client's family
+	/// </summary>
+	auto Release(Session& session, const Lookup& lookup) -> void
+	{
+		const auto it = session.held.find(lookup.name);
+		if (it == session.held.end())
+			return;
+
+		auto held = std::move(it->second);
+		session.held.erase(it);
+
+		const auto* address = lookup.resolution.First(session.client.ss_family);
+		if (!address || session.upstream == INVALID_SOCKET)
+			return;
+
+		if (session.names.size() >= kMaxNames)
+			session.names.clear();
+		session.names.emplace(lookup.name, *address);
+
+		std::array<Datagram, kMaxHeld> batch;
+		std::uint64_t up = 0;
+		for (std::size_t i = 0; i < held.size(); ++i) {
+			auto& datagram = batch[i];
+			datagram.data = reinterpret_cast<std::byte*>(held[i].payload.data());
+			datagram.size = held[i].payload.size();
+			datagram.peer = address->storage;
+			datagram.length = address->length;
+			Port(datagram.peer, held[i].port);
+			up += datagram.size;
+		}
+
+		metrics_.Datagrams(0, Datagrams::Send(session.upstream, batch.data(), held.size()));
+		metrics_.Relayed(up, 0);
+	}
+
+	/// <summary>
+	/// Sends every datagram of the echo socket straight back, a batch at a time
+	/// </summary>
+	auto EchoDatagrams(void) -> void
+	{
+		for (auto burst = 0; burst < Relay::kBurst; ++burst) {
+			const auto received = Datagrams::Receive(echo_, datagrams_.data(), datagrams_.size(), slots_.data(), kSlot);
+			if (received <= 0)
+				break;
+
+			const auto count = static_cast<std::size_t>(received);
+			metrics_.Datagrams(count, Datagrams::Send(echo_, datagrams_.data(), count));
+
+			if (count < datagrams_.size())
+				break;
+		}
+	}
+
+	static auto Port(const sockaddr_storage& address) -> std::uint16_t
+	{
+		return ntohs(address.ss_family == AF_INET6 ? reinterpret_cast<const sockaddr_in6*>(&address)->sin6_port : reinterpret_cast<const sockaddr_in*>(&address)->sin_port);
+	}
+
+	static auto Port(sockaddr_storage& address, const std::uint16_t port) -> void
+	{
+		if (address.ss_family == AF_INET6)
+			reinterpret_cast<sockaddr_in6*>(&address)->sin6_port = htons(port);
+		else
+			reinterpret_cast<sockaddr_in*>(&address)->sin_port = htons(port);
+	}
+
+	/// <summary>
+	/// Reads from a side only while the other one took everything, writes while something waits for it
+	/// </summary>
+	auto Interest(Connection& connection) -> void
+	{
+		auto& session = *connection.session;
+
+		const auto client_read = session.up.Reading();
+		const auto client_write = session.down.Writing();
+		if (client_read != session.client_read || client_write != session.client_write) {
+			session.client_read = client_read;
+			session.client_write = client_write;
+			poller_.Modify(connection.socket.get_handle(), client_read, client_write);
+		}
+
+		const auto upstream_read = session.down.Reading();
+		const auto upstream_write = session.up.Writing();
+		if (upstream_read != session.upstream_read || upstream_write != session.upstream_write) {
+			session.upstream_read = upstream_read;
+			session.upstream_write = upstream_write;
+			poller_.Modify(session.upstream, upstream_read, upstream_write);
+		}
+	}
+
+	auto Timeout(void) const -> int
+	{
+		if (!draining_.load(std::memory_order_acquire))
+			return -1;
+
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline_ - std::chrono::steady_clock::now());
+		return left.count() > 0 ? static_cast<int>(left.count()) : 0;
+	}
+
+	/// <summary>
+	/// Half-closes connections with nothing left to send, false once draining is over
+	/// </summary>
+	auto DrainStep(void) -> bool
+	{
+		if (std::chrono::steady_clock::now() >= deadline_)
+			return false;
+
+		for (auto it = connections_.begin(); it != connections_.end();) {
+			auto& [fd, connection] = *it;
+			// relays end when either side hangs up, or at the deadline
+			if (connection.half_closed || connection.session) {
+				++it;
+				continue;
+			}
+
+			// answer whatever already arrived before our side goes away
+			auto alive = true;
+			do {
+				alive = this->OnReadable(connection);
+			} while (alive && last_read_ > 0 && !connection.half_closed);
+
+			if (alive && !connection.pending.empty())
+				alive = this->Flush(connection);
+
+			if (!alive) {
+				it = this->Close(it);
+				continue;
+			}
+
+			if (!connection.pending.empty()) {
+				++it;
+				continue;
+			}
+
+#ifdef _WIN32
+			::shutdown(fd, SD_SEND);
+#else
+			::shutdown(fd, SHUT_WR);
+#endif
+			connection.half_closed = true;
+			++it;
+		}
+
+		return !connections_.empty();
+	}
+
+	/// <summary>
+	/// One write per connection for everything answered since the last flush
+	/// </summary>
+	auto FlushDirty(void) -> void
+	{
+		for (const auto fd : dirty_) {
+			const auto it = connections_.find(fd);
+			if (it == connections_.end() || !it->second.dirty)
+				continue;
+
+			it->second.dirty = false;
+			if (!this->Flush(it->second))
+				this->Close(it);
+		}
+
+		dirty_.clear();
+	}
+
+	auto Close(std::unordered_map<SOCKET, Connection>::iterator it) -> std::unordered_map<SOCKET, Connection>::iterator
+	{
+		metrics_.Segments(SegmentsOut(it->first));
+
+		if (config_.Verbose())
+			std::cout << "detected disconnect from " << it->second.from.address << ':' << it->second.from.port << " (worker " << id_ << ")" << '\n';
+
+		if (const auto& session = it->second.session; session && session->upstream != INVALID_SOCKET) {
+			poller_.Remove(session->upstream);
+			upstreams_.erase(session->upstream);
+			closesocket(session->upstream);
+		}
+
+		poller_.Remove(it->first);
+		load_.fetch_sub(1, std::memory_order_relaxed);
+		return connections_.erase(it);
+	}
+
+	static auto SegmentsOut([[maybe_unused]] SOCKET fd) -> std::uint64_t
+	{
+#ifdef __linux__
+		// glibc's tcp_info stops before the segment counters the kernel fills in
+		struct
+		{
+			tcp_info base;
+			std::uint64_t pacing_rate;
+			std::uint64_t max_pacing_rate;
+			std::uint64_t bytes_acked;
+			std::uint64_t bytes_received;
+			std::uint32_t segs_out;
+			std::uint32_t segs_in;
+		} info{};
+
+		socklen_t length = sizeof info;
+		if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 &&
+			length >= offsetof(decltype(info), segs_in))
+			return info.segs_out;
+#endif
+		return 0;
+	}
+
+private:
+	std::size_t id_;
+	Configuration& config_;
+	Metrics& metrics_;
+
+	std::thread thread_;
+	std::atomic<bool> running_{ false };
+	std::atomic<bool> draining_{ false };
+	std::chrono::steady_clock::time_point deadline_;
+	std::atomic<std::size_t> load_{ 0 };
+
+	Poller poller_;
+	Notifier notifier_;
+	MpscQueue<Accepted, 1024> queue_;
+
+	std::unordered_map<SOCKET, Connection> connections_;
+	// destination side of the SOCKS connections to the client side
+	std::unordered_map<SOCKET, SOCKET> upstreams_;
+	std::shared_ptr<Guard> guard_;
+	std::uint64_t sessions_ = 0;
+	std::vector<SOCKET> dirty_;
+	kissnet::buffer<4096> buffer_;
+	// UDP echo socket, and the batch and buffer every datagram of this worker goes through
+	SOCKET echo_ = INVALID_SOCKET;
+	std::array<Datagram, Datagrams::kBatch> datagrams_;
+	std::vector<std::byte> slots_;
+	std::size_t last_read_ = 0;
+};
+
+#endif // !WORKER_HPP
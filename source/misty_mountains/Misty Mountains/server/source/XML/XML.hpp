@@ -4,13 +4,19 @@
 #pragma once
 
 #include <csignal>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 #include <tinyxml2.h>
 #include <filesystem>
 #include <iostream>
+#include <system_error>
 #include <thread>
+#include <unordered_map>
 
+#ifdef _MSC_VER
 #pragma comment(lib, "tinyxml2.lib")
+#endif
 
 namespace xml2 = tinyxml2;
 
@@ -52,6 +58,49 @@ public:
 	{
 		return m_sz_suffix_;
 	}
+
+	auto Workers(void) -> std::string&
+	{
+		return m_sz_workers_;
+	}
+
+	auto Placement(void) -> std::string&
+	{
+		return m_sz_placement_;
+	}
+
+	auto Framing(void) -> std::string&
+	{
+		return m_sz_framing_;
+	}
+
+	auto Coalesce(void) -> std::string&
+	{
+		return m_sz_coalesce_;
+	}
+
+	auto CoalesceCap(void) -> std::string&
+	{
+		return m_sz_coalesce_cap_;
+	}
+
+	/// <summary>
+	/// Attribute of the optional listener element, empty if not set
+	/// </summary>
+	auto Listener(const std::string& name) -> std::string
+	{
+		const auto it = m_listener_.find(name);
+		return it != m_listener_.end() ? it->second : std::string{};
+	}
+
+	/// <summary>
+	/// Attribute of the optional socks element, empty if not set
+	/// </summary>
+	auto Socks(const std::string& name) -> std::string
+	{
+		const auto it = m_socks_.find(name);
+		return it != m_socks_.end() ? it->second : std::string{};
+	}
 	
 private:
 	auto InitCwd(void) -> void
@@ -60,6 +109,7 @@ private:
 		auto cwd = std::filesystem::current_path();
 
 		// get process path
+#ifdef _WIN32
 		char sz_exe_path[MAX_PATH];
 
 		auto* const h_handle = GetModuleHandle(nullptr);
@@ -67,6 +117,13 @@ private:
 		GetModuleFileNameA(h_handle, sz_exe_path, MAX_PATH);
 
 		m_fl_cwd_ = sz_exe_path;
+#else
+		// linux links the executable there, elsewhere the config is looked for in the working directory
+		std::error_code error;
+		m_fl_cwd_ = std::filesystem::read_symlink("/proc/self/exe", error);
+		if (error)
+			m_fl_cwd_ = cwd / "";
+#endif
 
 		m_fl_cwd_.remove_filename();
 	}
@@ -85,6 +142,7 @@ private:
 
 		auto* port = m_xml_doc_.NewElement("connection");
 		port->SetAttribute("port", "1337");
+		port->SetAttribute("framing", "");
 		configuration->InsertFirstChild(port);
 
 		auto* prefix = m_xml_doc_.NewElement("echo-prefix");
@@ -97,6 +155,32 @@ private:
 		suffix->InsertEndChild(e_suffix);
 		configuration->InsertEndChild(suffix);
 
+		auto* workers = m_xml_doc_.NewElement("workers");
+		workers->SetAttribute("count", "");
+		workers->SetAttribute("placement", "round-robin");
+		workers->SetAttribute("coalesce", "");
+		workers->SetAttribute("coalesce-cap", "");
+		configuration->InsertEndChild(workers);
+
+		auto* listener = m_xml_doc_.NewElement("listener");
+		listener->SetAttribute("backlog", "");
+		listener->SetAttribute("defer-accept", "");
+		listener->SetAttribute("fastopen", "");
+		listener->SetAttribute("rcvbuf", "");
+		listener->SetAttribute("sndbuf", "");
+		listener->SetAttribute("nodelay", "");
+		listener->SetAttribute("quickack", "");
+		listener->SetAttribute("upgrade-socket", "");
+		listener->SetAttribute("ipv6", "");
+		listener->SetAttribute("udp", "");
+		configuration->InsertEndChild(listener);
+
+		auto* socks = m_xml_doc_.NewElement("socks");
+		socks->SetAttribute("port", "");
+		socks->SetAttribute("username", "");
+		socks->SetAttribute("password", "");
+		configuration->InsertEndChild(socks);
+
 		m_xml_doc_.InsertEndChild(configuration);
 
 		if (m_xml_doc_.SaveFile(sz_path) != xml2::XML_SUCCESS) {
@@ -114,6 +198,9 @@ private:
 			std::cout << "XML Port: " << connection->Attribute("port") << '\n';
 			m_sz_port_ = connection->Attribute("port");
 
+			if (const auto* framing = connection->Attribute("framing"))
+				m_sz_framing_ = framing;
+
 			auto* prefix = root_element->FirstChildElement("echo-prefix");
 			std::cout << "XML Prefix: " << prefix->GetText() << '\n';
 			m_sz_prefix_ = prefix->GetText();
@@ -121,6 +208,29 @@ private:
 			auto* suffix = root_element->FirstChildElement("echo-suffix");
 			std::cout << "XML Suffix: " << suffix->GetText() << '\n';
 			m_sz_suffix_ = suffix->GetText();
+
+			// optional since older configuration files don't have it
+			if (auto* workers = root_element->FirstChildElement("workers")) {
+				if (const auto* count = workers->Attribute("count"))
+					m_sz_workers_ = count;
+				if (const auto* placement = workers->Attribute("placement"))
+					m_sz_placement_ = placement;
+				if (const auto* coalesce = workers->Attribute("coalesce"))
+					m_sz_coalesce_ = coalesce;
+				if (const auto* coalesce_cap = workers->Attribute("coalesce-cap"))
+					m_sz_coalesce_cap_ = coalesce_cap;
+				std::cout << "XML Workers: " << m_sz_workers_ << " (" << m_sz_placement_ << ")" << '\n';
+			}
+
+			if (auto* listener = root_element->FirstChildElement("listener")) {
+				for (const auto* attribute = listener->FirstAttribute(); attribute; attribute = attribute->Next())
+					m_listener_[attribute->Name()] = attribute->Value();
+			}
+
+			if (auto* socks = root_element->FirstChildElement("socks")) {
+				for (const auto* attribute = socks->FirstAttribute(); attribute; attribute = attribute->Next())
+					m_socks_[attribute->Name()] = attribute->Value();
+			}
 		}
 	}
 	
@@ -132,6 +242,13 @@ private:
 	std::string m_sz_port_;
 	std::string m_sz_prefix_;
 	std::string m_sz_suffix_;
+	std::string m_sz_workers_;
+	std::string m_sz_placement_;
+	std::string m_sz_framing_;
+	std::string m_sz_coalesce_;
+	std::string m_sz_coalesce_cap_;
+	std::unordered_map<std::string, std::string> m_listener_;
+	std::unordered_map<std::string, std::string> m_socks_;
 };
 
 #endif // !XML_HPP
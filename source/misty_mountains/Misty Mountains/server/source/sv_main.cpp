@@ -15,6 +15,12 @@ using namespace std::chrono_literals;
 #include "Configuration/Configuration.hpp"
 #include "Args/Args.hpp"
 #include "XML/XML.hpp"
+#include "Metrics/Metrics.hpp"
+#include "Worker/Worker.hpp"
+#include "Acceptor/Acceptor.hpp"
+#include "Listener/Listener.hpp"
+#include "Shutdown/Shutdown.hpp"
+#include "Handover/Handover.hpp"
 
 //std::mutex g_lock;
 
@@ -29,11 +35,8 @@ auto main(const int argc, char* argv[]) -> int
 	//Configuration (by default)
 	config->Port(1337);
 
-	//close program upon ctrl+c or other signals
-	std::signal(SIGINT, [](int) {
-		std::cout << "Got sigint signal...\n";
-		std::exit(EXIT_SUCCESS);
-		});
+	//ctrl+c or other signals start a graceful shutdown, has to exist before any thread does
+	auto shutdown = std::make_unique<Shutdown>();
 
 	// Initialize XML
 	xml->Initialize( std::move( args->Path() ) );
@@ -74,98 +77,260 @@ auto main(const int argc, char* argv[]) -> int
 		std::exit(EXIT_FAILURE);
 	}
 
-	//We need to store thread objects somewhere
-	std::vector<std::thread> threads;
-	//We need to store socket objects somewhere
-	std::vector<kn::tcp_socket> sockets;
+	// xml is preferred over cmdline here as well, by default one worker per hardware thread
+	try
+	{
+		const auto& workers = !xml->Workers().empty() ? xml->Workers() : args->Workers();
+		if (!workers.empty()) {
+			config->Workers(std::stoul(workers, nullptr, 10));
+		}
+		else {
+			config->Workers(std::max(1u, std::thread::hardware_concurrency()));
+		}
+
+		if (!args->Stats().empty()) {
+			config->StatsInterval(std::stoul(args->Stats(), nullptr, 10));
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong workers or stats variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (!config->Workers()) {
+		std::cerr << "At least one worker is required" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	const auto& placement = !xml->Placement().empty() ? xml->Placement() : args->Placement();
+	if (placement == "least-loaded") {
+		config->PlacementPolicy(Placement::kLeastLoaded);
+	}
+	else if (!placement.empty() && placement != "round-robin") {
+		std::cerr << "Unknown placement " << placement << ", using round-robin" << '\n';
+	}
+
+	config->Verbose(args->Verbose());
+	config->UpgradeSocket(std::string(!xml->Listener("upgrade-socket").empty() ? xml->Listener("upgrade-socket") : args->UpgradeSocket()));
+
+	try
+	{
+		if (!args->DrainTimeout().empty()) {
+			config->DrainTimeout(std::stoul(args->DrainTimeout(), nullptr, 10));
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong drain variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	// listener tuning, xml attribute first then cmdline
+	try
+	{
+		const auto number = [](const std::string& xml_value, const std::string& arg_value) -> int {
+			const auto& value = !xml_value.empty() ? xml_value : arg_value;
+			return value.empty() ? 0 : std::stoi(value, nullptr, 10);
+		};
+
+		config->Backlog(number(xml->Listener("backlog"), args->Backlog()));
+		config->DeferAccept(number(xml->Listener("defer-accept"), args->DeferAccept()));
+		config->FastOpen(number(xml->Listener("fastopen"), args->FastOpen()));
+		config->RecvBuffer(number(xml->Listener("rcvbuf"), args->RecvBuffer()));
+		config->SendBuffer(number(xml->Listener("sndbuf"), args->SendBuffer()));
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong listener variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	const auto flag = [](const std::string& xml_value, const bool arg_value) -> bool {
+		return !xml_value.empty() ? xml_value == "true" || xml_value == "1" : arg_value;
+	};
+
+	config->NoDelay(flag(xml->Listener("nodelay"), args->NoDelay()));
+	config->QuickAck(flag(xml->Listener("quickack"), args->QuickAck()));
+	config->Ipv6(flag(xml->Listener("ipv6"), args->Ipv6()));
+	config->Udp(flag(xml->Listener("udp"), args->Udp()));
+
+	const auto& framing = !xml->Framing().empty() ? xml->Framing() : args->Framing();
+	if (framing == "line") {
+		config->MessageFraming(Framing::kLine);
+	}
+	else if (framing == "length") {
+		config->MessageFraming(Framing::kLength);
+	}
+	else if (!framing.empty() && framing != "raw") {
+		std::cerr << "Unknown framing " << framing << ", using raw" << '\n';
+	}
+
+	config->Coalesce(flag(xml->Coalesce(), args->Coalesce()));
+
+	try
+	{
+		const auto& cap = !xml->CoalesceCap().empty() ? xml->CoalesceCap() : args->CoalesceCap();
+		if (!cap.empty()) {
+			config->CoalesceCap(std::stoul(cap, nullptr, 10));
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong coalesce-cap variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	// SOCKS proxy next to the echo, xml attribute first then cmdline
+	try
+	{
+		const auto& socks = !xml->Socks("port").empty() ? xml->Socks("port") : args->Socks();
+		if (!socks.empty()) {
+			config->SocksPort(kn::port_t(std::stoi(socks, nullptr, 10)));
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		std::cerr << "Wrong socks port variable" << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+
+	config->SocksUsername(std::string(!xml->Socks("username").empty() ? xml->Socks("username") : args->SocksUsername()));
+	config->SocksPassword(std::string(!xml->Socks("password").empty() ? xml->Socks("password") : args->SocksPassword()));
+
+#ifdef SIGPIPE
+	// splice() has no MSG_NOSIGNAL, a relayed peer that hung up must not take the server down
+	if (config->SocksPort()) {
+		std::signal(SIGPIPE, SIG_IGN);
+	}
+#endif
+
+	auto metrics = std::make_unique<Metrics>();
+
+	//Worker event loops, each one owns a share of the connections
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (std::size_t i = 0; i < config->Workers(); ++i) {
+		workers.emplace_back(std::make_unique<Worker>(i, *config, *metrics));
+	}
+
+	//Datagrams to the port are echoed by the first worker, in batches
+	std::unique_ptr<kn::udp_socket> udp;
+	if (config->Udp()) {
+		udp = std::make_unique<kn::udp_socket>(kn::endpoint{ "0.0.0.0", config->Port() });
+		Listener::Prepare(udp->get_handle());
+		udp->bind();
+		workers.front()->Echo(udp->get_handle());
+		std::cout << "Echoing datagrams on 0.0.0.0:" << config->Port() << '\n';
+	}
+
+	for (auto& worker : workers) {
+		worker->Start();
+	}
 	
-	//Create a listening TCP socket on requested port
-	kn::tcp_socket listen_socket({ "0.0.0.0", config->Port() });
-	listen_socket.bind();
-	listen_socket.listen();
+	//Listening sockets come from socket activation, the server we replace, or are created here
+	auto handover = std::make_unique<Handover>();
+	auto inherited = Handover::Inherited();
+	if (inherited.empty() && !config->UpgradeSocket().empty()) {
+		inherited = handover->Takeover(config->UpgradeSocket());
+	}
+
+	std::vector<kn::tcp_socket> listeners;
+	for (const auto fd : inherited) {
+		sockaddr_storage address{};
+		socklen_t length = sizeof address;
+		getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+		listeners.emplace_back(fd, kn::endpoint(reinterpret_cast<SOCKADDR*>(&address)));
+	}
+
+	const auto listen = [&listeners, &config](const kn::port_t port) {
+		//Create a listening TCP socket on requested port
+		kn::tcp_socket listen_socket({ "0.0.0.0", port });
+		Listener::Prepare(listen_socket.get_handle());
+		listen_socket.bind();
+		Listener::Tune(listen_socket.get_handle(), *config);
+		listen_socket.listen(config->Backlog() > 0 ? config->Backlog() : SOMAXCONN);
+		listeners.emplace_back(std::move(listen_socket));
+
+		if (config->Ipv6()) {
+			kn::tcp_socket_v6 listen_socket_v6({ "::", port });
+			Listener::Prepare(listen_socket_v6.get_handle());
+			Listener::V6Only(listen_socket_v6.get_handle());
+			listen_socket_v6.bind();
+			Listener::Tune(listen_socket_v6.get_handle(), *config);
+			listen_socket_v6.listen(config->Backlog() > 0 ? config->Backlog() : SOMAXCONN);
+
+			// the rest of the server only needs the handle, it goes in with the IPv4 listeners
+			const auto fd = listen_socket_v6.get_handle();
+			sockaddr_storage address{};
+			socklen_t length = sizeof address;
+			getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+			listeners.emplace_back(fd, kn::endpoint(reinterpret_cast<SOCKADDR*>(&address)));
+			listen_socket_v6.release();
+		}
+	};
+
+	if (listeners.empty()) {
+		listen(config->Port());
+	}
+
+	// inherited listeners are told apart by their port, the SOCKS one may be new with this server
+	const auto socks = [&config](const kn::tcp_socket& listener) {
+		return config->SocksPort() && listener.get_bind_loc().port == config->SocksPort();
+	};
+
+	if (config->SocksPort() && std::none_of(listeners.begin(), listeners.end(), socks)) {
+		listen(config->SocksPort());
+	}
+
+	//Dedicated thread that only accepts and hands sockets over to the workers
+	auto acceptor = std::make_unique<Acceptor>(workers, config->PlacementPolicy(), *metrics);
+	std::vector<SOCKET> handles;
+	for (const auto& listener : listeners) {
+		acceptor->Listen(listener.get_handle(), socks(listener));
+		handles.push_back(listener.get_handle());
+		std::cout << "Listening on " << listener.get_bind_loc().address << ':' << listener.get_bind_loc().port << (socks(listener) ? " (SOCKS)" : "") << '\n';
+	}
+	acceptor->Start();
+
+	std::cout << "Running with " << config->Workers() << " worker(s)" << '\n';
+
+	//The previous server drains once we accept, then we wait for the next upgrade
+	handover->Confirm();
+	if (!config->UpgradeSocket().empty()) {
+		handover->Serve(config->UpgradeSocket(), handles);
+	}
 
 	//Send the SIGINT signal to our self if user press return on "server" terminal
-	std::thread run_th([] {
-		std::cout << "press return to close server...\n";
-		std::cin.get(); //This call only returns when user hit RETURN
-		std::cin.clear();
-		std::raise(SIGINT);
-		});
-
-	//Let that thread run alone
-	run_th.detach();
-
-	//Loop that continuously accept connections
-	while (true)
-	{
-		std::cout << "Waiting for a client on port " << config->Port() << '\n';
-		sockets.emplace_back(listen_socket.accept());
-		auto& client = sockets.back();
-		const auto client_info = client.get_recv_endpoint();
-
-		//Create thread that will echo bytes received to the client
-		threads.emplace_back([&] {
-			std::cout << "Started thread for " << client_info.address << ':' << client_info.port << " (thread id: " << std::this_thread::get_id() << ") " << '\n';
-			
-			//Internal loop
-			auto continue_receiving = true;
-
-			kn::buffer<4096> static_buffer;
-			
-			//While connection is alive
-			while (continue_receiving)
-			{				
-				//attept to receive data
-				if (auto [data_size, valid] = client.recv(static_buffer); valid)
-				{					
-					if (valid.value == kn::socket_status::cleanly_disconnected)
-					{
-						continue_receiving = false;
-					}
-					else
-					{
-						if (data_size < static_buffer.size()) 
-							static_buffer[data_size] = std::byte{ '\0' };
-						
-						std::string message(reinterpret_cast<const char*>(static_buffer.data()), data_size);
-						
-						std::cout << "Incoming from " << client_info.address << ":" << client_info.port << '\n';
-						std::cout << "Data: " << message << '\n';
-
-						// add prefix if non empty
-						if (!config->Prefix().empty()) {
-							message.insert(0, config->Prefix());
-						}
-
-						// add suffix if non empty
-						if (!config->Suffix().empty()) {
-							message.insert(message.length(), config->Suffix());
-						}
-						
-						auto* const data_byte = reinterpret_cast<const std::byte*>(message.c_str());
-						const auto data_length = message.length();
-						
-						client.send(data_byte, data_length);
-					}
-				}
-				//If not valid remote host closed connection
-				else
-				{
-					continue_receiving = false;
-				}
-			}
-
-			//Now that we are outside the loop, erase this socket from the "sockets" list:
-			std::cout << "detected disconnect from " << client_info.address << ':' << client_info.port << " (thread id: " << std::this_thread::get_id() << ") " << '\n';
-			if (const auto me_iterator = std::find(sockets.begin(), sockets.end(), std::ref(client)); me_iterator != sockets.end())
-			{
-				std::cout << "closing socket...\n";
-				sockets.erase(me_iterator);
-			}
+	if (!args->Daemon()) {
+		std::thread run_th([] {
+			std::cout << "press return to close server...\n";
+			std::cin.get(); //This call only returns when user hit RETURN
+			if (!std::cin.eof())
+				Shutdown::Raise();
 			});
 
-		threads.back().detach();
+		//Let that thread run alone
+		run_th.detach();
+	}
+
+	//Report metrics periodically if asked to, otherwise just idle until a signal arrives
+	const auto interval = config->StatsInterval() ? std::chrono::milliseconds(std::chrono::seconds(config->StatsInterval())) : 1h;
+	while (!shutdown->Wait(interval))
+	{
+		if (config->StatsInterval())
+			metrics->Report(std::cout);
 	}
 
+	std::cout << "Got signal " << shutdown->Signal() << ", draining connections for up to " << config->DrainTimeout() << "ms" << '\n';
+
+	//Stop accepting first, new clients get refused instead of cut off later
+	acceptor->Stop();
+	for (auto& listener : listeners)
+		listener.close();
+
+	for (auto& worker : workers)
+		worker->Drain(std::chrono::milliseconds(config->DrainTimeout()));
+
+	for (auto& worker : workers)
+		worker->Join();
+
+	metrics->Report(std::cout);
+	std::cout << std::flush;
+
 	return EXIT_SUCCESS;
 }